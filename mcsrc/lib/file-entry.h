@@ -16,10 +16,10 @@
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
-/* keys are set only during sorting */
+/* keys are created by sorting and kept until the entry is freed */
 typedef struct
 {
-    /* File name */
+    /* File name, it is owned by the directory list and must not be changed */
     GString *fname;
     /* File attributes */
     mc_stat_t st;
@@ -66,6 +66,8 @@
 #define MC_TREESTORE_FILE       "Tree"
 #define MC_PANELS_FILE          "panels.ini"
 #define MC_FHL_INI_FILE         "filehighlight.ini"
+#define MC_COPY_JOURNAL_FILE    "copyjournal"
+#define MC_ERASE_STAGE_FILE     "erasestage"
 
 #define MC_SKINS_DIR            "skins"
 
@@ -168,6 +168,9 @@ typedef struct mc_search_struct
     gchar *error_str;
 } mc_search_t;
 
+/* Replace string compiled once to be applied to many matches */
+typedef struct mc_search_replace_struct mc_search_replace_t;
+
 typedef struct mc_search_type_str_struct
 {
     const char *str;
@@ -203,6 +206,11 @@ const mc_search_type_str_t *mc_search_types_list_get (size_t *num);
 GString *mc_search_prepare_replace_str (mc_search_t * mc_search, GString * replace_str);
 char *mc_search_prepare_replace_str2 (mc_search_t * lc_mc_search, const char *replace_str);
 
+mc_search_replace_t *mc_search_replace_new (const mc_search_t * lc_mc_search,
+                                           const char *replace_str);
+char *mc_search_replace_apply (mc_search_t * lc_mc_search, const mc_search_replace_t * replace);
+void mc_search_replace_free (mc_search_replace_t * replace);
+
 gboolean mc_search_is_fixed_search_str (const mc_search_t * lc_mc_search);
 
 gchar **mc_search_get_types_strings_array (size_t *num);
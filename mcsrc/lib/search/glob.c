@@ -208,3 +208,12 @@ mc_search_glob_prepare_replace_str (mc_search_t *lc_mc_search, GString *replace_
 }
 
 /* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search_glob_replace_compile (mc_search_replace_t *replace, const char *replace_str)
+{
+    replace->str = mc_search__translate_replace_glob_to_regex (replace_str);
+    mc_search_regex_replace_compile (replace);
+}
+
+/* --------------------------------------------------------------------------------------------- */
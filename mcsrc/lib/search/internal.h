@@ -25,6 +25,15 @@ typedef enum
     COND__FOUND_ERROR
 } mc_search__found_cond_t;
 
+/* Step of compiled replace string */
+typedef enum
+{
+    MC_SEARCH_REPLACE_OP_TEXT,  /* part of replace string */
+    MC_SEARCH_REPLACE_OP_ESCAPE,        /* escape sequence without leading backslash */
+    MC_SEARCH_REPLACE_OP_FLAG,  /* case transformation flag */
+    MC_SEARCH_REPLACE_OP_TOKEN  /* captured group */
+} mc_search_replace_op_type_t;
+
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 typedef struct mc_search_cond_struct
@@ -36,6 +45,26 @@ typedef struct mc_search_cond_struct
     gchar *charset;
 } mc_search_cond_t;
 
+typedef struct
+{
+    mc_search_replace_op_type_t type;
+    /* position of text, escape sequence or flag in replace string */
+    gsize offset;
+    gsize len;
+    /* number of captured group */
+    int index;
+} mc_search_replace_op_t;
+
+struct mc_search_replace_struct
+{
+    /* replace string. Glob is already translated to regex */
+    GString *str;
+    /* array of mc_search_replace_op_t, NULL if replace string is used as is */
+    GArray *ops;
+    /* maximum number of captured group used in replace string */
+    int max_token;
+};
+
 /*** global variables defined in .c file *********************************************************/
 
 /*** declarations of public functions ************************************************************/
@@ -56,6 +85,9 @@ void mc_search__cond_struct_new_init_regex (const char *charset, mc_search_t * l
 gboolean mc_search__run_regex (mc_search_t * lc_mc_search, const void *user_data,
                                off_t start_search, off_t end_search, gsize * found_len);
 GString *mc_search_regex_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str);
+void mc_search_regex_replace_compile (mc_search_replace_t * replace);
+GString *mc_search_regex_replace_apply (mc_search_t * lc_mc_search,
+                                        const mc_search_replace_t * replace);
 
 /* search/normal.c : */
 
@@ -72,6 +104,7 @@ void mc_search__cond_struct_new_init_glob (const char *charset, mc_search_t * lc
 gboolean mc_search__run_glob (mc_search_t * lc_mc_search, const void *user_data,
                               off_t start_search, off_t end_search, gsize * found_len);
 GString *mc_search_glob_prepare_replace_str (mc_search_t * lc_mc_search, GString * replace_str);
+void mc_search_glob_replace_compile (mc_search_replace_t * replace, const char *replace_str);
 
 /* search/hex.c : */
 
@@ -533,6 +533,42 @@ mc_search_regex__replace_handle_esc_seq (const GString *replace_str, const gsize
     return TRUE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply case transformation flag of replace string: U, u, L, l or E after backslash.
+ *
+ * @return TRUE if @c is a transformation flag, FALSE otherwise
+ */
+
+static gboolean
+mc_search_regex__set_replace_flag (char c, replace_transform_type_t *replace_flags)
+{
+    switch (c)
+    {
+    case 'U':
+        *replace_flags |= REPLACE_T_UPP_TRANSFORM;
+        *replace_flags &= ~REPLACE_T_LOW_TRANSFORM;
+        break;
+    case 'u':
+        *replace_flags |= REPLACE_T_UPP_TRANSFORM_CHAR;
+        break;
+    case 'L':
+        *replace_flags |= REPLACE_T_LOW_TRANSFORM;
+        *replace_flags &= ~REPLACE_T_UPP_TRANSFORM;
+        break;
+    case 'l':
+        *replace_flags |= REPLACE_T_LOW_TRANSFORM_CHAR;
+        break;
+    case 'E':
+        *replace_flags = REPLACE_T_NO_TRANSFORM;
+        break;
+    default:
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -595,32 +631,12 @@ mc_search_regex__process_replace_str (const GString *replace_str, const gsize cu
         if (!mc_search_regex__replace_handle_esc_seq (replace_str, current_pos, skip_len, &ret))
             return ret;
 
-        ret = REPLACE_PREPARE_T_REPLACE_FLAG;
         *skip_len += 2;
 
-        switch (curr_str[1])
-        {
-        case 'U':
-            *replace_flags |= REPLACE_T_UPP_TRANSFORM;
-            *replace_flags &= ~REPLACE_T_LOW_TRANSFORM;
-            break;
-        case 'u':
-            *replace_flags |= REPLACE_T_UPP_TRANSFORM_CHAR;
-            break;
-        case 'L':
-            *replace_flags |= REPLACE_T_LOW_TRANSFORM;
-            *replace_flags &= ~REPLACE_T_UPP_TRANSFORM;
-            break;
-        case 'l':
-            *replace_flags |= REPLACE_T_LOW_TRANSFORM_CHAR;
-            break;
-        case 'E':
-            *replace_flags = REPLACE_T_NO_TRANSFORM;
-            break;
-        default:
+        if (mc_search_regex__set_replace_flag (curr_str[1], replace_flags))
+            ret = REPLACE_PREPARE_T_REPLACE_FLAG;
+        else
             ret = REPLACE_PREPARE_T_NOTHING_SPECIAL;
-            break;
-        }
     }
     return ret;
 }
@@ -782,6 +798,45 @@ mc_search_regex__process_escape_sequence (GString *dest_str, const char *from, g
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search_regex__append_token (GString *dest_str, const mc_search_t *lc_mc_search, gsize lc_index,
+                               replace_transform_type_t *replace_flags)
+{
+    int fnd_start = 0, fnd_end = 0;
+
+#ifdef SEARCH_TYPE_GLIB
+    g_match_info_fetch_pos (lc_mc_search->regex_match_info, lc_index, &fnd_start, &fnd_end);
+#else /* SEARCH_TYPE_GLIB */
+    fnd_start = lc_mc_search->iovector[lc_index * 2 + 0];
+    fnd_end = lc_mc_search->iovector[lc_index * 2 + 1];
+#endif /* SEARCH_TYPE_GLIB */
+
+    if (fnd_end != fnd_start)
+        mc_search_regex__process_append_str (dest_str, lc_mc_search->regex_buffer->str + fnd_start,
+                                             fnd_end - fnd_start, replace_flags);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+mc_search_regex__replace_add_op (mc_search_replace_t *replace, mc_search_replace_op_type_t type,
+                                 gsize offset, gsize len)
+{
+    mc_search_replace_op_t op;
+
+    /* empty text changes nothing */
+    if (type == MC_SEARCH_REPLACE_OP_TEXT && len == 0)
+        return;
+
+    op.type = type;
+    op.offset = offset;
+    op.len = len;
+    op.index = 0;
+    g_array_append_val (replace->ops, op);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1115,6 +1170,153 @@ mc_search_regex_prepare_replace_str (mc_search_t *lc_mc_search, GString *replace
     return ret;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Split replace string to steps once to apply it to many matches. Steps are made in the same
+ * order as mc_search_regex_prepare_replace_str() processes the string.
+ *
+ * @param replace compiled replace string with str member set
+ */
+
+void
+mc_search_regex_replace_compile (mc_search_replace_t *replace)
+{
+    const GString *replace_str = replace->str;
+    gsize loop;
+    gsize prev = 0;
+    replace_transform_type_t replace_flags = REPLACE_T_NO_TRANSFORM;
+
+    replace->ops = g_array_new (FALSE, FALSE, sizeof (mc_search_replace_op_t));
+
+    if (replace_str->len == 0)
+        return;
+
+    replace->max_token =
+        mc_search_regex__get_max_num_of_replace_tokens (replace_str->str, replace_str->len);
+
+    for (loop = 0; loop < replace_str->len - 1; loop++)
+    {
+        int lc_index;
+        gsize len = 0;
+
+        lc_index = mc_search_regex__process_replace_str (replace_str, loop, &len, &replace_flags);
+
+        if (lc_index == REPLACE_PREPARE_T_NOTHING_SPECIAL)
+        {
+            if (len != 0)
+            {
+                mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_TEXT, prev,
+                                                 loop - prev);
+                mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_TEXT, loop + 1,
+                                                 len - 1);
+                prev = loop + len;
+                loop = prev - 1;        /* prepare to loop++ */
+            }
+
+            continue;
+        }
+
+        if (lc_index == REPLACE_PREPARE_T_REPLACE_FLAG)
+        {
+            /* flag is applied to the text before it as well */
+            mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_FLAG, loop + 1, 1);
+            mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_TEXT, prev, loop - prev);
+            prev = loop + len;
+            loop = prev - 1;    /* prepare to loop++ */
+            continue;
+        }
+
+        mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_TEXT, prev, loop - prev);
+
+        if (lc_index == REPLACE_PREPARE_T_ESCAPE_SEQ)
+            mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_ESCAPE, loop + 1,
+                                             len - 1);
+        else
+        {
+            mc_search_replace_op_t op = { MC_SEARCH_REPLACE_OP_TOKEN, 0, 0, lc_index };
+
+            g_array_append_val (replace->ops, op);
+        }
+
+        prev = loop + len;
+        loop = prev - 1;        /* prepare to loop++ */
+    }
+
+    mc_search_regex__replace_add_op (replace, MC_SEARCH_REPLACE_OP_TEXT, prev,
+                                     replace_str->len - prev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply compiled replace string to the last match. Result is the same as of
+ * mc_search_regex_prepare_replace_str() for the source replace string.
+ *
+ * @param lc_mc_search search object with the last match
+ * @param replace replace string compiled by mc_search_regex_replace_compile()
+ *
+ * @return new string, NULL on error
+ */
+
+GString *
+mc_search_regex_replace_apply (mc_search_t *lc_mc_search, const mc_search_replace_t *replace)
+{
+    GString *ret;
+    guint i;
+    replace_transform_type_t replace_flags = REPLACE_T_NO_TRANSFORM;
+
+    if (lc_mc_search->num_results < 0)
+        return mc_g_string_dup (replace->str);
+
+    if (replace->max_token > lc_mc_search->num_results - 1
+        || replace->max_token > MC_SEARCH__NUM_REPLACE_ARGS)
+    {
+        mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_REPLACE, "%s",
+                             _(STR_E_RPL_NOT_EQ_TO_FOUND));
+        return NULL;
+    }
+
+    ret = g_string_sized_new (64);
+
+    for (i = 0; i < replace->ops->len; i++)
+    {
+        const mc_search_replace_op_t *op =
+            &g_array_index (replace->ops, mc_search_replace_op_t, i);
+        const char *from = replace->str->str + op->offset;
+
+        switch (op->type)
+        {
+        case MC_SEARCH_REPLACE_OP_TEXT:
+            mc_search_regex__process_append_str (ret, from, op->len, &replace_flags);
+            break;
+
+        case MC_SEARCH_REPLACE_OP_ESCAPE:
+            mc_search_regex__process_escape_sequence (ret, from, op->len, &replace_flags,
+                                                      lc_mc_search->is_utf8);
+            break;
+
+        case MC_SEARCH_REPLACE_OP_FLAG:
+            mc_search_regex__set_replace_flag (*from, &replace_flags);
+            break;
+
+        case MC_SEARCH_REPLACE_OP_TOKEN:
+        default:
+            /* invalid capture buffer number */
+            if (op->index > lc_mc_search->num_results)
+            {
+                g_string_free (ret, TRUE);
+                mc_search_set_error (lc_mc_search, MC_SEARCH_E_REGEX_REPLACE,
+                                     _(STR_E_RPL_INVALID_TOKEN), op->index);
+                return NULL;
+            }
+
+            mc_search_regex__append_token (ret, lc_mc_search, op->index, &replace_flags);
+            break;
+        }
+    }
+
+    return ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Checks whether search condition has BOL (^) or EOL ($) regexp special characters.
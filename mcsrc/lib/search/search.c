@@ -395,6 +395,85 @@ mc_search_prepare_replace_str2 (mc_search_t *lc_mc_search, const char *replace_s
     return (ret != NULL) ? g_string_free (ret, FALSE) : NULL;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compile replace string to apply it to many matches, e.g. to build names of many files
+ * by a mask. The string is parsed only once instead of on every
+ * mc_search_prepare_replace_str2() call.
+ *
+ * @param lc_mc_search search object which matches will be used
+ * @param replace_str replace string
+ *
+ * @return compiled replace string to free with mc_search_replace_free()
+ */
+
+mc_search_replace_t *
+mc_search_replace_new (const mc_search_t *lc_mc_search, const char *replace_str)
+{
+    mc_search_replace_t *replace;
+
+    replace = g_new0 (mc_search_replace_t, 1);
+
+    if (replace_str == NULL || *replace_str == '\0' || lc_mc_search == NULL)
+    {
+        replace->str = g_string_new (replace_str);
+        return replace;
+    }
+
+    switch (lc_mc_search->search_type)
+    {
+    case MC_SEARCH_T_REGEX:
+        replace->str = g_string_new (replace_str);
+        mc_search_regex_replace_compile (replace);
+        break;
+    case MC_SEARCH_T_GLOB:
+        mc_search_glob_replace_compile (replace, replace_str);
+        break;
+    default:
+        replace->str = g_string_new (replace_str);
+        break;
+    }
+
+    return replace;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Build replacement for the last match.
+ *
+ * @param lc_mc_search search object with the last match
+ * @param replace compiled replace string
+ *
+ * @return newly allocated string, NULL on error
+ */
+
+char *
+mc_search_replace_apply (mc_search_t *lc_mc_search, const mc_search_replace_t *replace)
+{
+    GString *ret;
+
+    if (lc_mc_search == NULL || replace->ops == NULL)
+        ret = mc_g_string_dup (replace->str);
+    else
+        ret = mc_search_regex_replace_apply (lc_mc_search, replace);
+
+    return (ret != NULL) ? g_string_free (ret, FALSE) : NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+mc_search_replace_free (mc_search_replace_t *replace)
+{
+    if (replace == NULL)
+        return;
+
+    if (replace->ops != NULL)
+        g_array_free (replace->ops, TRUE);
+    g_string_free (replace->str, TRUE);
+    g_free (replace);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 gboolean
@@ -44,6 +44,7 @@
 #include <config.h>
 
 #include <errno.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #if defined(WIN32) //WIN32, drive
 #include <ctype.h>
@@ -56,6 +57,9 @@
 #ifdef HAVE_SYS_IOCTL_H
 #include <sys/ioctl.h>
 #endif /* HAVE_SYS_IOCTL_H */
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif /* HAVE_SYS_SENDFILE_H */
 #endif /* __linux__ */
 
 #include "lib/global.h"
@@ -89,6 +93,10 @@ MC_MOCKABLE vfs_class *current_vfs = NULL;
 
 #define VFS_FIRST_HANDLE 100
 
+#if defined(HAVE_COPY_FILE_RANGE) || (defined(__linux__) && defined(HAVE_SYS_SENDFILE_H))
+#define VFS_KERNEL_COPY 1
+#endif
+
 /*** file scope type declarations ****************************************************************/
 
 struct vfs_openfile
@@ -231,6 +239,22 @@ vfs_test_current_dir (const vfs_path_t *vpath)
             && my_stat.st_ino == my_stat2.st_ino && my_stat.st_dev == my_stat2.st_dev);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef VFS_KERNEL_COPY
+/**
+ * Check whether error of in-kernel copy means that the kernel cannot copy these files
+ * (too old kernel, cross-filesystem copy, O_APPEND destination, etc).
+ */
+
+static inline gboolean
+vfs_kernel_copy_unsupported (const int e)
+{
+    return (e == ENOSYS || e == EXDEV || e == EINVAL || e == EBADF || e == ENOTSUP
+            || e == EOPNOTSUPP);
+}
+#endif /* VFS_KERNEL_COPY */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -786,3 +810,256 @@ vfs_clone_file (int dest_vfs_fd, int src_vfs_fd)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Share data blocks of part of the source file with the target file on copy-on-write
+ * file systems. Offsets and length should be aligned to the file system block size,
+ * except the length which reaches the end of the source file.
+ *
+ * @param dest_vfs_fd mc VFS handler of target file, shouldn't be opened with O_APPEND
+ * @param dest_offset offset in the target file
+ * @param src_vfs_fd mc VFS handler of source file
+ * @param src_offset offset in the source file
+ * @param len length of part to share, 0 to share up to the end of the source file
+ *
+ * @return 0 if success and -1 otherwise with errno set.
+ */
+
+int
+vfs_clone_file_range (int dest_vfs_fd, mc_off_t dest_offset, int src_vfs_fd, mc_off_t src_offset,
+                      mc_off_t len)
+{
+#ifdef FICLONERANGE
+    struct file_clone_range range;
+    int dest_fd, src_fd;
+
+    dest_fd = vfs_get_local_fd (dest_vfs_fd);
+    if (dest_fd == -1)
+        return (-1);
+
+    src_fd = vfs_get_local_fd (src_vfs_fd);
+    if (src_fd == -1)
+        return (-1);
+
+    range.src_fd = src_fd;
+    range.src_offset = (uint64_t) src_offset;
+    range.src_length = (uint64_t) len;
+    range.dest_offset = (uint64_t) dest_offset;
+
+    return ioctl (dest_fd, FICLONERANGE, &range);
+#else
+    (void) dest_vfs_fd;
+    (void) dest_offset;
+    (void) src_vfs_fd;
+    (void) src_offset;
+    (void) len;
+    errno = ENOTSUP;
+    return (-1);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get descriptor of local file.
+ *
+ * @param vfs_fd mc VFS file handler
+ *
+ * @return file descriptor if the file belongs to the local VFS, -1 otherwise (errno is set).
+ */
+
+int
+vfs_get_local_fd (int vfs_fd)
+{
+    void *fd = NULL;
+    struct vfs_class *class;
+
+    class = vfs_class_find_by_handle (vfs_fd, &fd);
+    if (class == NULL || fd == NULL)
+    {
+        errno = EBADF;
+        return (-1);
+    }
+
+    if ((class->flags & VFSF_LOCAL) == 0)
+    {
+        errno = ENOTSUP;
+        return (-1);
+    }
+
+    return *(int *) fd;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Copy data from one local file to another one in the kernel, without bouncing it through
+ * the userspace buffer. Like read()/write() pair, the current offsets of both files are used
+ * and advanced.
+ *
+ * @param dest_vfs_fd mc VFS file handler of target file
+ * @param src_vfs_fd mc VFS file handler of source file
+ * @param count maximum number of bytes to copy
+ *
+ * @return number of copied bytes, 0 at end of source file, -1 on error.
+ * If these files cannot be copied in the kernel, errno is set to ENOTSUP.
+ */
+
+ssize_t
+vfs_copy_file_chunk (int dest_vfs_fd, int src_vfs_fd, size_t count)
+{
+#ifdef VFS_KERNEL_COPY
+    int dest_fd, src_fd;
+    ssize_t ret = -1;
+
+    dest_fd = vfs_get_local_fd (dest_vfs_fd);
+    if (dest_fd == -1)
+        return (-1);
+
+    src_fd = vfs_get_local_fd (src_vfs_fd);
+    if (src_fd == -1)
+        return (-1);
+
+#ifdef HAVE_COPY_FILE_RANGE
+    ret = copy_file_range (src_fd, NULL, dest_fd, NULL, count, 0);
+    if (ret >= 0 || !vfs_kernel_copy_unsupported (errno))
+        return ret;
+#endif
+
+#if defined(__linux__) && defined(HAVE_SYS_SENDFILE_H)
+    /* Since Linux 2.6.33 target of sendfile() can be any file */
+    ret = sendfile (dest_fd, src_fd, NULL, count);
+    if (ret >= 0 || !vfs_kernel_copy_unsupported (errno))
+        return ret;
+#endif
+
+    errno = ENOTSUP;
+    return ret;
+#else
+    (void) dest_vfs_fd;
+    (void) src_vfs_fd;
+    (void) count;
+    errno = ENOTSUP;
+    return (-1);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give the kernel a hint about future access to the range of local file.
+ *
+ * @param vfs_fd mc VFS file handler
+ * @param offset start of the range
+ * @param len length of the range, 0 means up to the end of file
+ * @param advice hint
+ *
+ * @return 0 if success or hint is not supported by the file system, errno value otherwise.
+ * Note: function doesn't touch errno global variable.
+ */
+
+int
+vfs_advise (int vfs_fd, mc_off_t offset, mc_off_t len, vfs_advice_t advice)
+{
+#ifdef HAVE_POSIX_FADVISE
+    void *fd = NULL;
+    struct vfs_class *class;
+    int posix_advice;
+
+    class = vfs_class_find_by_handle (vfs_fd, &fd);
+    if (class == NULL || (class->flags & VFSF_LOCAL) == 0 || fd == NULL)
+        return 0;
+
+    switch (advice)
+    {
+    case VFS_ADVISE_SEQUENTIAL:
+        posix_advice = POSIX_FADV_SEQUENTIAL;
+        break;
+    case VFS_ADVISE_DONTNEED:
+        posix_advice = POSIX_FADV_DONTNEED;
+        break;
+    default:
+        return 0;
+    }
+
+    return posix_fadvise (*(int *) fd, offset, len, posix_advice);
+#else
+    (void) vfs_fd;
+    (void) offset;
+    (void) len;
+    (void) advice;
+    return 0;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Write dirty pages of the range of local file to the disk.
+ *
+ * @param vfs_fd mc VFS file handler
+ * @param offset start of the range
+ * @param len length of the range, 0 means up to the end of file
+ * @param wait FALSE to start write-out only, TRUE to wait for it as well
+ *
+ * @return 0 if success or not supported, -1 otherwise (errno is set)
+ */
+
+int
+vfs_sync_range (int vfs_fd, mc_off_t offset, mc_off_t len, gboolean wait)
+{
+#ifdef HAVE_SYNC_FILE_RANGE
+    void *fd = NULL;
+    struct vfs_class *class;
+    unsigned int flags = SYNC_FILE_RANGE_WRITE;
+
+    class = vfs_class_find_by_handle (vfs_fd, &fd);
+    if (class == NULL || (class->flags & VFSF_LOCAL) == 0 || fd == NULL)
+        return 0;
+
+    if (wait)
+        flags |= SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WAIT_AFTER;
+
+    return sync_file_range (*(int *) fd, offset, len, flags);
+#else
+    (void) vfs_fd;
+    (void) offset;
+    (void) len;
+    (void) wait;
+    return 0;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Turn on or off direct I/O for local file: data are transferred between buffer and disk
+ * bypassing the page cache. Buffer, file offset and size of I/O should be aligned to
+ * the logical block size of file system.
+ *
+ * @param vfs_fd mc VFS file handler
+ * @param direct TRUE to turn direct I/O on, FALSE to turn it off
+ *
+ * @return 0 if success, -1 otherwise (errno is set)
+ */
+
+int
+vfs_set_direct_io (int vfs_fd, gboolean direct)
+{
+#ifdef O_DIRECT
+    int fd, flags;
+
+    fd = vfs_get_local_fd (vfs_fd);
+    if (fd == -1)
+        return (-1);
+
+    flags = fcntl (fd, F_GETFL);
+    if (flags == -1)
+        return (-1);
+
+    flags = direct ? (flags | O_DIRECT) : (flags & ~O_DIRECT);
+
+    return fcntl (fd, F_SETFL, flags);
+#else
+    (void) vfs_fd;
+    (void) direct;
+    errno = ENOTSUP;
+    return (-1);
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
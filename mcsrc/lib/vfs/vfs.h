@@ -114,10 +114,22 @@ typedef enum
     VFSF_USETMP = 1 << 4
 } vfs_flags_t;
 
+/* Page cache hints for vfs_advise() */
+typedef enum
+{
+    VFS_ADVISE_SEQUENTIAL,      /* file will be read sequentially */
+    VFS_ADVISE_DONTNEED         /* data will not be accessed in the near future */
+} vfs_advice_t;
+
 /* Operations for mc_ctl - on open file */
 enum
 {
-    VFS_CTL_IS_NOTREADY
+    VFS_CTL_IS_NOTREADY,
+    /* Find the next data or hole of a sparse file starting at offset pointed by mc_off_t *arg.
+       Return 1 and store found offset in arg, 0 if not supported, -1 on error
+       (errno is ENXIO if there is no more data after the offset) */
+    VFS_CTL_SEEK_DATA,
+    VFS_CTL_SEEK_HOLE
 };
 
 /* Operations for mc_setctl - on path */
@@ -305,6 +317,15 @@ char *vfs_get_cwd (void);
 int vfs_preallocate (int dest_desc, mc_off_t src_fsize, mc_off_t dest_fsize);
 
 int vfs_clone_file (int dest_vfs_fd, int src_vfs_fd);
+int vfs_clone_file_range (int dest_vfs_fd, mc_off_t dest_offset, int src_vfs_fd,
+                          mc_off_t src_offset, mc_off_t len);
+
+int vfs_get_local_fd (int vfs_fd);
+ssize_t vfs_copy_file_chunk (int dest_vfs_fd, int src_vfs_fd, size_t count);
+
+int vfs_advise (int vfs_fd, mc_off_t offset, mc_off_t len, vfs_advice_t advice);
+int vfs_sync_range (int vfs_fd, mc_off_t offset, mc_off_t len, gboolean wait);
+int vfs_set_direct_io (int vfs_fd, gboolean direct);
 
 /**
  * Interface functions described in interface.c
@@ -51,6 +51,9 @@
 #include "lib/event-types.h"
 #include "lib/util.h"           /* my_fork() */
 
+#include "src/setup.h"          /* background_jobs_per_device */
+#include "src/filemanager/boxes.h"      /* jobs_box_update() */
+
 #include "background.h"
 
 /*** global variables ****************************************************************************/
@@ -59,14 +62,27 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* Progress of the background job is reported to the parent not more often than this */
+#define PROGRESS_INTERVAL_US G_USEC_PER_SEC
+
 /*** file scope type declarations ****************************************************************/
 
 enum ReturnType
 {
     Return_String,
-    Return_Integer
+    Return_Integer,
+    /* one-way message with the job progress, parent doesn't reply */
+    Report_Progress
 };
 
+/* Payload of Report_Progress message */
+typedef struct
+{
+    uintmax_t done_bytes;
+    uintmax_t total_bytes;
+    long bps;
+} progress_report_t;
+
 /*** forward declarations (file scope functions) *************************************************/
 
 static int background_attention (int fd, void *closure);
@@ -85,23 +101,92 @@ TaskList *task_list = NULL;
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * Get number of jobs which are not queued and read or write the device.
+ */
+static int
+count_device_tasks (dev_t dev)
+{
+    const TaskList *p;
+    int count = 0;
+
+    for (p = task_list; p != NULL; p = p->next)
+        if ((p->dev == dev || p->src_dev == dev) && p->state != Task_Queued)
+            count++;
+
+    return count;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether the job which is not running can be started without exceeding the limit
+ * of jobs on its source and target devices.
+ */
+static gboolean
+task_has_room (const TaskList *task)
+{
+    if (background_jobs_per_device <= 0)
+        return TRUE;
+
+    return (task->dev == 0 || count_device_tasks (task->dev) < background_jobs_per_device)
+        && (task->src_dev == 0 || task->src_dev == task->dev
+            || count_device_tasks (task->src_dev) < background_jobs_per_device);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static void
-register_task_running (file_op_context_t *ctx, pid_t pid, int fd, int to_child, char *info)
+register_task_running (file_op_context_t *ctx, pid_t pid, int fd, int to_child, char *info,
+                       dev_t src_dev, dev_t dev)
 {
     TaskList *new;
 
-    new = g_new (TaskList, 1);
+    new = g_new0 (TaskList, 1);
     new->pid = pid;
     new->info = info;
     new->state = Task_Running;
-    new->next = task_list;
+    new->src_dev = src_dev;
+    new->dev = dev;
     new->fd = fd;
     new->to_child_fd = to_child;
+
+    /* too many jobs on these devices: stop the new one until others are finished */
+    if (!task_has_room (new) && kill (pid, SIGSTOP) == 0)
+        new->state = Task_Queued;
+
+    new->next = task_list;
     task_list = new;
 
     add_select_channel (fd, background_attention, ctx);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start queued jobs in the order they were queued while there is room for them.
+ * Jobs on other devices are not blocked by a job which still waits.
+ */
+static void
+start_queued_tasks (void)
+{
+    TaskList *p;
+    GSList *queued = NULL, *q;
+
+    /* new jobs are added to the list head */
+    for (p = task_list; p != NULL; p = p->next)
+        if (p->state == Task_Queued)
+            queued = g_slist_prepend (queued, p);
+
+    for (q = queued; q != NULL; q = g_slist_next (q))
+    {
+        p = (TaskList *) q->data;
+
+        if (task_has_room (p) && kill (p->pid, SIGCONT) == 0)
+            p->state = Task_Running;
+    }
+
+    g_slist_free (queued);
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -122,6 +207,7 @@ destroy_task (pid_t pid)
                 task_list = p->next;
             g_free (p->info);
             g_free (p);
+            start_queued_tasks ();
             return fd;
         }
         prev = p;
@@ -145,6 +231,9 @@ destroy_task (pid_t pid)
  * If the routine is zero, then it is a way to tell the parent
  * that the process is dying.
  *
+ * If the type is Report_Progress, the header is followed by
+ * progress_report_t and the parent doesn't reply.
+ *
  * nargc arguments in the following format:
  * int size of the coming block
  * size bytes with the block
@@ -249,6 +338,26 @@ background_attention (int fd, void *closure)
         read (fd, &have_ctx, sizeof (have_ctx)) != sizeof (have_ctx))
         return reading_failed (-1, data);
 
+    if (type == Report_Progress)
+    {
+        progress_report_t report;
+
+        if (read (fd, &report, sizeof (report)) != sizeof (report))
+            return reading_failed (-1, data);
+
+        for (p = task_list; p != NULL; p = p->next)
+            if (p->fd == fd)
+            {
+                p->done_bytes = report.done_bytes;
+                p->total_bytes = report.total_bytes;
+                p->bps = report.bps;
+                jobs_box_update ();
+                break;
+            }
+
+        return 0;
+    }
+
     if (argc > MAXCALLARGS)
         message (D_ERROR, _("Background protocol error"), "%s",
                  _("Background process sent us a request for more arguments\n"
@@ -509,7 +618,8 @@ unregister_task_with_pid (pid_t pid)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * Try to make the Midnight Commander a background job
+ * Try to make the Midnight Commander a background job. The job is queued if there are too
+ * many jobs on its source or target device.
  *
  * Returns:
  *  1 for parent
@@ -517,7 +627,7 @@ unregister_task_with_pid (pid_t pid)
  * -1 on failure
  */
 int
-do_background (file_op_context_t *ctx, char *info)
+do_background (file_op_context_t *ctx, char *info, dev_t src_dev, dev_t dev)
 {
     int comm[2];                /* control connection stream */
     int back_comm[2];           /* back connection */
@@ -585,7 +695,7 @@ do_background (file_op_context_t *ctx, char *info)
         (void) close (comm[1]);
         (void) close (back_comm[0]);
         ctx->pid = pid;
-        register_task_running (ctx, pid, comm[0], back_comm[1], info);
+        register_task_running (ctx, pid, comm[0], back_comm[1], info, src_dev, dev);
         return 1;
     }
 }
@@ -620,6 +730,37 @@ parent_call_string (void *routine, int argc, ...)
     return str;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Report progress of the background job to show it in the Jobs dialog. Called by the job
+ * as often as it wants, the report is sent not more often than once per second.
+ */
+
+void
+background_report_progress (uintmax_t done_bytes, uintmax_t total_bytes, long bps)
+{
+    static gint64 last_report = 0;
+    progress_report_t report;
+    gint64 now;
+    ssize_t ret;
+
+    if (!mc_global.we_are_background)
+        return;
+
+    now = g_get_monotonic_time ();
+    if (now - last_report < PROGRESS_INTERVAL_US)
+        return;
+    last_report = now;
+
+    report.done_bytes = done_bytes;
+    report.total_bytes = total_bytes;
+    report.bps = bps;
+
+    parent_call_header (NULL, 0, Report_Progress, NULL);
+    ret = write (parent_fd, &report, sizeof (report));
+    (void) ret;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 /* event callback */
@@ -5,7 +5,8 @@
 #ifndef MC__BACKGROUND_H
 #define MC__BACKGROUND_H
 
-#include <sys/types.h>          /* pid_t */
+#include <sys/types.h>          /* pid_t, dev_t */
+#include <inttypes.h>           /* uintmax_t */
 #include "filemanager/filegui.h"
 
 /*** typedefs(not structures) and defined constants **********************************************/
@@ -13,7 +14,9 @@
 enum TaskState
 {
     Task_Running,
-    Task_Stopped
+    Task_Stopped,
+    /* waits for other jobs on the same device */
+    Task_Queued
 };
 
 typedef struct TaskList
@@ -23,6 +26,13 @@ typedef struct TaskList
     pid_t pid;
     int state;
     char *info;
+    /* devices the job reads and writes, 0 if unknown */
+    dev_t src_dev;
+    dev_t dev;
+    /* progress reported by the job */
+    uintmax_t done_bytes;
+    uintmax_t total_bytes;
+    long bps;
     struct TaskList *next;
 } TaskList;
 
@@ -36,7 +46,8 @@ extern TaskList *task_list;
 
 /*** declarations of public functions ************************************************************/
 
-int do_background (file_op_context_t * ctx, char *info);
+int do_background (file_op_context_t * ctx, char *info, dev_t src_dev, dev_t dev);
+void background_report_progress (uintmax_t done_bytes, uintmax_t total_bytes, long bps);
 int parent_call (void *routine, file_op_context_t * ctx, int argc, ...);
 char *parent_call_string (void *routine, int argc, ...);
 
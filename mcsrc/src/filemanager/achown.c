@@ -46,6 +46,7 @@
 #include "lib/widget.h"
 
 #include "cmd.h"                /* advanced_chown_cmd() */
+#include "bulkattr.h"
 
 /*** global variables ****************************************************************************/
 
@@ -832,20 +833,19 @@ advanced_chown_done (gboolean need_update)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-try_advanced_chown (const vfs_path_t *p, mode_t m, uid_t u, gid_t g)
+try_advanced_chown (bulk_attr_t *ba, const char *fname, const mc_stat_t *sf, mode_t m, uid_t u,
+                    gid_t g)
 {
     int chmod_result;
-    const char *fname = NULL;
 
-    while ((chmod_result = mc_chmod (p, m)) == -1 && !ignore_all)
+    while ((chmod_result = bulk_attr_chmod (ba, fname, sf, m)) == -1 && !ignore_all)
     {
         int my_errno = errno;
         int result;
         char *msg;
 
-        if (fname == NULL)
-            fname = x_basename (vfs_path_as_str (p));
-        msg = g_strdup_printf (_("Cannot chmod \"%s\"\n%s"), fname, unix_error_string (my_errno));
+        msg = g_strdup_printf (_("Cannot chmod \"%s\"\n%s"), x_basename (fname),
+                               unix_error_string (my_errno));
         result =
             query_dialog (MSG_ERROR, msg, D_ERROR, 4, _("&Ignore"), _("Ignore &all"), _("&Retry"),
                           _("&Cancel"));
@@ -874,15 +874,14 @@ try_advanced_chown (const vfs_path_t *p, mode_t m, uid_t u, gid_t g)
     }
 
     /* call mc_chown() only, if mc_chmod didn't fail */
-    while (chmod_result != -1 && mc_chown (p, u, g) == -1 && !ignore_all)
+    while (chmod_result != -1 && bulk_attr_chown (ba, fname, sf, u, g) == -1 && !ignore_all)
     {
         int my_errno = errno;
         int result;
         char *msg;
 
-        if (fname == NULL)
-            fname = x_basename (vfs_path_as_str (p));
-        msg = g_strdup_printf (_("Cannot chown \"%s\"\n%s"), fname, unix_error_string (my_errno));
+        msg = g_strdup_printf (_("Cannot chown \"%s\"\n%s"), x_basename (fname),
+                               unix_error_string (my_errno));
         result =
             query_dialog (MSG_ERROR, msg, D_ERROR, 4, _("&Ignore"), _("Ignore &all"), _("&Retry"),
                           _("&Cancel"));
@@ -917,11 +916,12 @@ try_advanced_chown (const vfs_path_t *p, mode_t m, uid_t u, gid_t g)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-do_advanced_chown (WPanel *panel, const vfs_path_t *p, mode_t m, uid_t u, gid_t g)
+do_advanced_chown (WPanel *panel, bulk_attr_t *ba, const char *fname, const mc_stat_t *sf,
+                   mode_t m, uid_t u, gid_t g)
 {
     gboolean ret;
 
-    ret = try_advanced_chown (p, m, u, g);
+    ret = try_advanced_chown (ba, fname, sf, m, u, g);
 
     do_file_mark (panel, current_file, 0);
 
@@ -931,24 +931,22 @@ do_advanced_chown (WPanel *panel, const vfs_path_t *p, mode_t m, uid_t u, gid_t
  /* --------------------------------------------------------------------------------------------- */
 
 static void
-apply_advanced_chowns (WPanel *panel, vfs_path_t *vpath, mc_stat_t *sf)
+apply_advanced_chowns (WPanel *panel, bulk_attr_t *ba, const char *fname, mc_stat_t *sf)
 {
     gid_t a_gid = sf->st_gid;
     uid_t a_uid = sf->st_uid;
     gboolean ok;
 
-    if (!do_advanced_chown (panel, vpath, get_mode (),
+    /* owner in sf is the selected one, not the current one */
+    if (!do_advanced_chown (panel, ba, fname, NULL, get_mode (),
                             (ch_flags[9] == '+') ? a_uid : (uid_t) (-1),
                             (ch_flags[10] == '+') ? a_gid : (gid_t) (-1)))
         return;
 
     do
     {
-        const GString *fname;
-
-        fname = panel_find_marked_file (panel, &current_file);
-        vpath = vfs_path_from_str (fname->str);
-        ok = (mc_stat (vpath, sf) == 0);
+        fname = panel_find_marked_file (panel, &current_file)->str;
+        ok = (bulk_attr_stat (ba, fname, sf) == 0);
 
         if (!ok)
         {
@@ -963,12 +961,10 @@ apply_advanced_chowns (WPanel *panel, vfs_path_t *vpath, mc_stat_t *sf)
         {
             ch_cmode = sf->st_mode;
 
-            ok = do_advanced_chown (panel, vpath, get_mode (),
+            ok = do_advanced_chown (panel, ba, fname, sf, get_mode (),
                                     (ch_flags[9] == '+') ? a_uid : (uid_t) (-1),
                                     (ch_flags[10] == '+') ? a_gid : (gid_t) (-1));
         }
-
-        vfs_path_free (vpath, TRUE);
     }
     while (ok && panel->marked != 0);
 }
@@ -982,6 +978,7 @@ advanced_chown_cmd (WPanel *panel)
 {
     gboolean need_update;
     gboolean end_chown;
+    bulk_attr_t *ba;
 
     /* Number of files at startup */
     int files_on_begin;
@@ -989,6 +986,7 @@ advanced_chown_cmd (WPanel *panel)
     files_on_begin = MAX (1, panel->marked);
 
     advanced_chown_init ();
+    ba = bulk_attr_new (vfs_get_raw_current_dir ());
 
     current_file = 0;
     ignore_all = FALSE;
@@ -1054,7 +1052,7 @@ advanced_chown_cmd (WPanel *panel)
 
                     end_chown = TRUE;
                 }
-                else if (!try_advanced_chown (vpath, get_mode (), uid, gid))
+                else if (!try_advanced_chown (ba, fname->str, NULL, get_mode (), uid, gid))
                 {
                     /* stop multiple files processing */
                     result = B_CANCEL;
@@ -1066,7 +1064,7 @@ advanced_chown_cmd (WPanel *panel)
             }
 
         case B_SETALL:
-            apply_advanced_chowns (panel, vpath, &sf_stat);
+            apply_advanced_chowns (panel, ba, fname->str, &sf_stat);
             need_update = TRUE;
             end_chown = TRUE;
             break;
@@ -1088,6 +1086,7 @@ advanced_chown_cmd (WPanel *panel)
     }
     while (panel->marked != 0 && !end_chown);
 
+    bulk_attr_free (ba);
     advanced_chown_done (need_update);
 }
 
@@ -461,20 +461,34 @@ confvfs_callback (Widget *w, Widget *sender, widget_msg_t msg, int parm, void *d
 static void
 jobs_fill_listbox (WListbox *list)
 {
-    static const char *state_str[2] = { "", "" };
+    static const char *state_str[3] = { "", "", "" };
     TaskList *tl;
 
     if (state_str[0][0] == '\0')
     {
         state_str[0] = _("Running");
         state_str[1] = _("Stopped");
+        state_str[2] = _("Queued");
     }
 
     for (tl = task_list; tl != NULL; tl = tl->next)
     {
         char *s;
 
-        s = g_strconcat (state_str[tl->state], " ", tl->info, (char *) NULL);
+        if (tl->total_bytes != 0 || tl->bps != 0)
+        {
+            char bps[BUF_TINY];
+            int percent;
+
+            /* live progress reported by the job */
+            size_trunc_len (bps, 5, (uintmax_t) tl->bps, 0, panels_options.kilobyte_si);
+            percent = tl->total_bytes == 0 ? 0
+                : (int) MIN (tl->done_bytes * 100 / tl->total_bytes, 100);
+            s = g_strdup_printf ("%s %3d%% %s/s %s", state_str[tl->state], percent, bps,
+                                 tl->info);
+        }
+        else
+            s = g_strconcat (state_str[tl->state], " ", tl->info, (char *) NULL);
         listbox_add_item_take (list, LISTBOX_APPEND_AT_END, 0, s, (void *) tl, FALSE);
     }
 }
@@ -547,7 +561,7 @@ configure_box (void)
         char *time_out_new = NULL;
 
 #if defined(WIN32)  //WIN32, quick
-        quick_widget_t quick_widgets[36 + 2] = {0},
+        quick_widget_t quick_widgets[37 + 2] = {0},
             *qc = quick_widgets;
 
 #else
@@ -561,6 +575,7 @@ configure_box (void)
                     QUICK_CHECKBOX (N_("Mkdi&r autoname"), &auto_fill_mkdir_name, NULL),
                     QUICK_CHECKBOX (N_("&Preallocate space"), &mc_global.vfs.preallocate_space,
                                     NULL),
+                    QUICK_CHECKBOX (N_("Streami&ng copy"), &copymove_streaming, NULL),
                 QUICK_STOP_GROUPBOX,
                 QUICK_START_GROUPBOX (N_("Esc key mode")),
                     QUICK_CHECKBOX (N_("S&ingle press"), &old_esc_mode, &configure_old_esc_mode_id),
@@ -614,6 +629,7 @@ configure_box (void)
         qc =         XQUICK_CHECKBOX (qc, N_("Mkdi&r autoname"), &auto_fill_mkdir_name, NULL),
         qc =         XQUICK_CHECKBOX (qc, N_("&Preallocate space"), &mc_global.vfs.preallocate_space,
                                  NULL),
+        qc =         XQUICK_CHECKBOX (qc, N_("Streami&ng copy"), &copymove_streaming, NULL),
         qc =     XQUICK_STOP_GROUPBOX (qc),
         qc =     XQUICK_START_GROUPBOX (qc, N_("Esc key mode")),
         qc =         XQUICK_CHECKBOX (qc, N_("S&ingle press"), &old_esc_mode, &configure_old_esc_mode_id),
@@ -654,17 +670,22 @@ configure_box (void)
         g_snprintf (time_out, sizeof (time_out), "%d", old_esc_mode_timeout);
 
 #ifndef USE_INTERNAL_EDIT
-        quick_widgets[17].state = WST_DISABLED;
+        quick_widgets[18].state = WST_DISABLED;
 #endif
 
         if (!old_esc_mode)
-            quick_widgets[10].state = quick_widgets[11].state = WST_DISABLED;
+            quick_widgets[11].state = quick_widgets[12].state = WST_DISABLED;
 
 #ifndef HAVE_POSIX_FALLOCATE
         mc_global.vfs.preallocate_space = FALSE;
         quick_widgets[6].state = WST_DISABLED; //WIN32/bug-fix
 #endif
 
+#ifndef HAVE_POSIX_FADVISE
+        copymove_streaming = FALSE;
+        quick_widgets[7].state = WST_DISABLED;
+#endif
+
         if (quick_dialog (&qdlg) == B_ENTER)
         {
             if (time_out_new[0] == '\0')
@@ -1728,6 +1749,27 @@ jobs_box (void)
 
     (void) dlg_run (jobs_dlg);
     widget_destroy (WIDGET (jobs_dlg));
+    bg_list = NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Show new state and progress of background jobs if the Jobs dialog is open.
+ */
+
+void
+jobs_box_update (void)
+{
+    int current;
+
+    if (bg_list == NULL)
+        return;
+
+    current = bg_list->current;
+    listbox_remove_list (bg_list);
+    jobs_fill_listbox (bg_list);
+    listbox_set_current (bg_list, current);
+    widget_draw (WIDGET (bg_list));
 }
 #endif /* ENABLE_BACKGROUND */
 
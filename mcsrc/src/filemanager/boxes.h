@@ -28,6 +28,7 @@ void confirm_box (void);
 void display_bits_box (void);
 void configure_vfs_box (void);
 void jobs_box (void);
+void jobs_box_update (void);
 char *cd_box (const WPanel * panel);
 void symlink_box (const vfs_path_t * existing_vpath, const vfs_path_t * new_vpath,
                   char **ret_existing, char **ret_new);
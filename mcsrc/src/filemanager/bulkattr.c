@@ -0,0 +1,208 @@
+/*
+   Change of attributes of many files in one directory.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  bulkattr.c
+ *  \brief Source: change of attributes of many files in one directory
+ *
+ *  Used by chmod, chown and advanced chown commands to process marked files of panel.
+ *  Files which already have requested mode or owner are skipped without any system call.
+ *  In local directory, files are accessed by name relative to the open directory descriptor,
+ *  so neither VFS path is built nor full path is resolved by the kernel for each file.
+ *  Other directories are processed by VFS.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+#include "bulkattr.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define BULK_ATTR_MODE_MASK (S_ISUID | S_ISGID | S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO)
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct bulk_attr_t
+{
+    /* open local directory, -1 to use VFS */
+    int fd;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start processing of files.
+ *
+ * @param dir_vpath directory which relative file names are resolved against. It should be
+ *                  the current directory
+ *
+ * @return new object
+ */
+
+bulk_attr_t *
+bulk_attr_new (const vfs_path_t *dir_vpath)
+{
+    bulk_attr_t *ba;
+
+    ba = g_new (bulk_attr_t, 1);
+    ba->fd = -1;
+
+#ifdef ENABLE_BULK_ATTR_AT
+    if (vfs_file_is_local (dir_vpath))
+        ba->fd = open (vfs_path_as_str (dir_vpath), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+#else
+    (void) dir_vpath;
+#endif
+
+    return ba;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+bulk_attr_free (bulk_attr_t *ba)
+{
+    if (ba == NULL)
+        return;
+
+    if (ba->fd != -1)
+        close (ba->fd);
+    g_free (ba);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get status of file following symbolic links like mc_stat().
+ *
+ * @param name file name as it is shown in panel
+ *
+ * @return 0 on success, -1 on error with errno set
+ */
+
+int
+bulk_attr_stat (bulk_attr_t *ba, const char *name, mc_stat_t *st)
+{
+    vfs_path_t *vpath;
+    int ret;
+
+#ifdef ENABLE_BULK_ATTR_AT
+    if (ba->fd != -1)
+        return fstatat (ba->fd, name, st, 0);
+#endif
+
+    vpath = vfs_path_from_str (name);
+    ret = mc_stat (vpath, st);
+    vfs_path_free (vpath, TRUE);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Change mode of file following symbolic links like mc_chmod().
+ *
+ * @param name file name as it is shown in panel
+ * @param st current status of file, NULL if unknown
+ * @param mode new mode
+ *
+ * @return 0 on success or if file already has this mode, -1 on error with errno set
+ */
+
+int
+bulk_attr_chmod (bulk_attr_t *ba, const char *name, const mc_stat_t *st, mode_t mode)
+{
+    vfs_path_t *vpath;
+    int ret;
+
+    if (st != NULL && (st->st_mode & BULK_ATTR_MODE_MASK) == (mode & BULK_ATTR_MODE_MASK))
+        return 0;
+
+#ifdef ENABLE_BULK_ATTR_AT
+    if (ba->fd != -1)
+        return fchmodat (ba->fd, name, mode & BULK_ATTR_MODE_MASK, 0);
+#endif
+
+    vpath = vfs_path_from_str (name);
+    ret = mc_chmod (vpath, mode);
+    vfs_path_free (vpath, TRUE);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Change owner and group of file following symbolic links like mc_chown().
+ *
+ * @param name file name as it is shown in panel
+ * @param st current status of file, NULL if unknown
+ * @param uid new owner, (uid_t) -1 to keep it
+ * @param gid new group, (gid_t) -1 to keep it
+ *
+ * @return 0 on success or if file already has this owner and group, -1 on error with errno set
+ */
+
+int
+bulk_attr_chown (bulk_attr_t *ba, const char *name, const mc_stat_t *st, uid_t uid, gid_t gid)
+{
+    vfs_path_t *vpath;
+    int ret;
+
+    if (st != NULL && (uid == (uid_t) (-1) || uid == st->st_uid)
+        && (gid == (gid_t) (-1) || gid == st->st_gid))
+        return 0;
+
+#ifdef ENABLE_BULK_ATTR_AT
+    if (ba->fd != -1)
+        return fchownat (ba->fd, name, uid, gid, 0);
+#endif
+
+    vpath = vfs_path_from_str (name);
+    ret = mc_chown (vpath, uid, gid);
+    vfs_path_free (vpath, TRUE);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
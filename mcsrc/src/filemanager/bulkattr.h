@@ -0,0 +1,38 @@
+/** \file  bulkattr.h
+ *  \brief Header: change of attributes of many files in one directory
+ */
+
+#ifndef MC__BULKATTR_H
+#define MC__BULKATTR_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Local files are changed by calls relative to directory descriptor */
+#if !defined(WIN32) && defined(HAVE_FCHMODAT) && defined(HAVE_FCHOWNAT)
+#define ENABLE_BULK_ATTR_AT 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct bulk_attr_t bulk_attr_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+bulk_attr_t *bulk_attr_new (const vfs_path_t * dir_vpath);
+void bulk_attr_free (bulk_attr_t * ba);
+
+int bulk_attr_stat (bulk_attr_t * ba, const char *name, mc_stat_t * st);
+int bulk_attr_chmod (bulk_attr_t * ba, const char *name, const mc_stat_t * st, mode_t mode);
+int bulk_attr_chown (bulk_attr_t * ba, const char *name, const mc_stat_t * st, uid_t uid,
+                     gid_t gid);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__BULKATTR_H */
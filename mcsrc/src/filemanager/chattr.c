@@ -1178,7 +1178,14 @@ chattr_apply_mask (WPanel *panel, vfs_path_t *vpath, unsigned long m)
         else
         {
             flags = m;
-            ok = do_chattr (panel, vpath, m);
+            /* file which already has requested attributes is not written */
+            if (((m & and_mask) | or_mask) == m)
+            {
+                do_file_mark (panel, current_file, 0);
+                ok = TRUE;
+            }
+            else
+                ok = do_chattr (panel, vpath, m);
             vfs_path_free (vpath, TRUE);
         }
     }
@@ -41,6 +41,7 @@
 #include "lib/widget.h"
 
 #include "cmd.h"                /* chmod_cmd() */
+#include "bulkattr.h"
 
 /*** global variables ****************************************************************************/
 
@@ -411,19 +412,16 @@ chmod_done (gboolean need_update)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-try_chmod (const vfs_path_t *p, mode_t m)
+try_chmod (bulk_attr_t *ba, const char *fname, const mc_stat_t *sf, mode_t m)
 {
-    const char *fname = NULL;
-
-    while (mc_chmod (p, m) == -1 && !ignore_all)
+    while (bulk_attr_chmod (ba, fname, sf, m) == -1 && !ignore_all)
     {
         int my_errno = errno;
         int result;
         char *msg;
 
-        if (fname == NULL)
-            fname = x_basename (vfs_path_as_str (p));
-        msg = g_strdup_printf (_("Cannot chmod \"%s\"\n%s"), fname, unix_error_string (my_errno));
+        msg = g_strdup_printf (_("Cannot chmod \"%s\"\n%s"), x_basename (fname),
+                               unix_error_string (my_errno));
         result =
             query_dialog (MSG_ERROR, msg, D_ERROR, 4, _("&Ignore"), _("Ignore &all"), _("&Retry"),
                           _("&Cancel"));
@@ -457,14 +455,13 @@ try_chmod (const vfs_path_t *p, mode_t m)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-do_chmod (WPanel *panel, const vfs_path_t *p, mc_stat_t *sf)
+do_chmod (WPanel *panel, bulk_attr_t *ba, const char *fname, mc_stat_t *sf)
 {
+    const mode_t m = (sf->st_mode & and_mask) | or_mask;
     gboolean ret;
 
-    sf->st_mode &= and_mask;
-    sf->st_mode |= or_mask;
-
-    ret = try_chmod (p, sf->st_mode);
+    ret = try_chmod (ba, fname, sf, m);
+    sf->st_mode = m;
 
     do_file_mark (panel, current_file, 0);
 
@@ -474,20 +471,17 @@ do_chmod (WPanel *panel, const vfs_path_t *p, mc_stat_t *sf)
 /* --------------------------------------------------------------------------------------------- */
 
 static void
-apply_mask (WPanel *panel, vfs_path_t *vpath, mc_stat_t *sf)
+apply_mask (WPanel *panel, bulk_attr_t *ba, const char *fname, mc_stat_t *sf)
 {
     gboolean ok;
 
-    if (!do_chmod (panel, vpath, sf))
+    if (!do_chmod (panel, ba, fname, sf))
         return;
 
     do
     {
-        const GString *fname;
-
-        fname = panel_find_marked_file (panel, &current_file);
-        vpath = vfs_path_from_str (fname->str);
-        ok = (mc_stat (vpath, sf) == 0);
+        fname = panel_find_marked_file (panel, &current_file)->str;
+        ok = (bulk_attr_stat (ba, fname, sf) == 0);
 
         if (!ok)
         {
@@ -502,10 +496,8 @@ apply_mask (WPanel *panel, vfs_path_t *vpath, mc_stat_t *sf)
         {
             ch_mode = sf->st_mode;
 
-            ok = do_chmod (panel, vpath, sf);
+            ok = do_chmod (panel, ba, fname, sf);
         }
-
-        vfs_path_free (vpath, TRUE);
     }
     while (ok && panel->marked != 0);
 }
@@ -519,8 +511,10 @@ chmod_cmd (WPanel *panel)
 {
     gboolean need_update;
     gboolean end_chmod;
+    bulk_attr_t *ba;
 
     chmod_init ();
+    ba = bulk_attr_new (vfs_get_raw_current_dir ());
 
     current_file = 0;
     ignore_all = FALSE;
@@ -572,7 +566,7 @@ chmod_cmd (WPanel *panel)
                                  unix_error_string (errno));
                     end_chmod = TRUE;
                 }
-                else if (!try_chmod (vpath, ch_mode))
+                else if (!try_chmod (ba, fname->str, &sf_stat, ch_mode))
                 {
                     /* stop multiple files processing */
                     result = B_CANCEL;
@@ -597,7 +591,7 @@ chmod_cmd (WPanel *panel)
                         and_mask &= ~check_perm[i].mode;
                 }
 
-            apply_mask (panel, vpath, &sf_stat);
+            apply_mask (panel, ba, fname->str, &sf_stat);
             need_update = TRUE;
             end_chmod = TRUE;
             break;
@@ -610,7 +604,7 @@ chmod_cmd (WPanel *panel)
                 if (check_perm[i].selected)
                     or_mask |= check_perm[i].mode;
 
-            apply_mask (panel, vpath, &sf_stat);
+            apply_mask (panel, ba, fname->str, &sf_stat);
             need_update = TRUE;
             end_chmod = TRUE;
             break;
@@ -623,7 +617,7 @@ chmod_cmd (WPanel *panel)
                 if (check_perm[i].selected)
                     and_mask &= ~check_perm[i].mode;
 
-            apply_mask (panel, vpath, &sf_stat);
+            apply_mask (panel, ba, fname->str, &sf_stat);
             need_update = TRUE;
             end_chmod = TRUE;
             break;
@@ -644,6 +638,7 @@ chmod_cmd (WPanel *panel)
     }
     while (panel->marked != 0 && !end_chmod);
 
+    bulk_attr_free (ba);
     chmod_done (need_update);
 }
 
@@ -47,6 +47,7 @@
 #include "src/setup.h"          /* panels_options */
 
 #include "cmd.h"                /* chown_cmd() */
+#include "bulkattr.h"
 
 /*** global variables ****************************************************************************/
 
@@ -283,19 +284,16 @@ chown_done (gboolean need_update)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-try_chown (const vfs_path_t *p, uid_t u, gid_t g)
+try_chown (bulk_attr_t *ba, const char *fname, const mc_stat_t *sf, uid_t u, gid_t g)
 {
-    const char *fname = NULL;
-
-    while (mc_chown (p, u, g) == -1 && !ignore_all)
+    while (bulk_attr_chown (ba, fname, sf, u, g) == -1 && !ignore_all)
     {
         int my_errno = errno;
         int result;
         char *msg;
 
-        if (fname == NULL)
-            fname = x_basename (vfs_path_as_str (p));
-        msg = g_strdup_printf (_("Cannot chown \"%s\"\n%s"), fname, unix_error_string (my_errno));
+        msg = g_strdup_printf (_("Cannot chown \"%s\"\n%s"), x_basename (fname),
+                               unix_error_string (my_errno));
         result =
             query_dialog (MSG_ERROR, msg, D_ERROR, 4, _("&Ignore"), _("Ignore &all"), _("&Retry"),
                           _("&Cancel"));
@@ -329,11 +327,11 @@ try_chown (const vfs_path_t *p, uid_t u, gid_t g)
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
-do_chown (WPanel *panel, const vfs_path_t *p, uid_t u, gid_t g)
+do_chown (WPanel *panel, bulk_attr_t *ba, const char *fname, const mc_stat_t *sf, uid_t u, gid_t g)
 {
     gboolean ret;
 
-    ret = try_chown (p, u, g);
+    ret = try_chown (ba, fname, sf, u, g);
 
     do_file_mark (panel, current_file, 0);
 
@@ -343,21 +341,20 @@ do_chown (WPanel *panel, const vfs_path_t *p, uid_t u, gid_t g)
 /* --------------------------------------------------------------------------------------------- */
 
 static void
-apply_chowns (WPanel *panel, vfs_path_t *vpath, uid_t u, gid_t g)
+apply_chowns (WPanel *panel, bulk_attr_t *ba, const char *fname, const mc_stat_t *sf, uid_t u,
+              gid_t g)
 {
     gboolean ok;
 
-    if (!do_chown (panel, vpath, u, g))
+    if (!do_chown (panel, ba, fname, sf, u, g))
         return;
 
     do
     {
-        const GString *fname;
-        mc_stat_t sf;
+        mc_stat_t st;
 
-        fname = panel_find_marked_file (panel, &current_file);
-        vpath = vfs_path_from_str (fname->str);
-        ok = (mc_stat (vpath, &sf) == 0);
+        fname = panel_find_marked_file (panel, &current_file)->str;
+        ok = (bulk_attr_stat (ba, fname, &st) == 0);
 
         if (!ok)
         {
@@ -369,9 +366,7 @@ apply_chowns (WPanel *panel, vfs_path_t *vpath, uid_t u, gid_t g)
             ok = TRUE;
         }
         else
-            ok = do_chown (panel, vpath, u, g);
-
-        vfs_path_free (vpath, TRUE);
+            ok = do_chown (panel, ba, fname, &st, u, g);
     }
     while (ok && panel->marked != 0);
 }
@@ -385,8 +380,10 @@ chown_cmd (WPanel *panel)
 {
     gboolean need_update;
     gboolean end_chown;
+    bulk_attr_t *ba;
 
     chown_init ();
+    ba = bulk_attr_new (vfs_get_raw_current_dir ());
 
     current_file = 0;
     ignore_all = FALSE;
@@ -465,7 +462,7 @@ chown_cmd (WPanel *panel)
                                      fname->str, unix_error_string (errno));
                         end_chown = TRUE;
                     }
-                    else if (!try_chown (vpath, new_user, new_group))
+                    else if (!try_chown (ba, fname->str, &sf_stat, new_user, new_group))
                     {
                         /* stop multiple files processing */
                         result = B_CANCEL;
@@ -474,7 +471,7 @@ chown_cmd (WPanel *panel)
                 }
                 else
                 {
-                    apply_chowns (panel, vpath, new_user, new_group);
+                    apply_chowns (panel, ba, fname->str, &sf_stat, new_user, new_group);
                     end_chown = TRUE;
                 }
 
@@ -492,7 +489,7 @@ chown_cmd (WPanel *panel)
                 if (user != NULL)
                 {
                     new_user = user->pw_uid;
-                    apply_chowns (panel, vpath, new_user, new_group);
+                    apply_chowns (panel, ba, fname->str, &sf_stat, new_user, new_group);
                     need_update = TRUE;
                     end_chown = TRUE;
                 }
@@ -509,7 +506,7 @@ chown_cmd (WPanel *panel)
                 if (grp != NULL)
                 {
                     new_group = grp->gr_gid;
-                    apply_chowns (panel, vpath, new_user, new_group);
+                    apply_chowns (panel, ba, fname->str, &sf_stat, new_user, new_group);
                     need_update = TRUE;
                     end_chown = TRUE;
                 }
@@ -532,6 +529,7 @@ chown_cmd (WPanel *panel)
     }
     while (panel->marked != 0 && !end_chown);
 
+    bulk_attr_free (ba);
     chown_done (need_update);
 }
 
@@ -86,6 +86,7 @@
 #include "ext.h"                /* regex_command() */
 #include "boxes.h"              /* cd_box() */
 #include "dir.h"
+#include "dirsize.h"
 #include "cd.h"
 #include "ioblksize.h"          /* IO_BUFSIZE */
 
@@ -95,6 +96,9 @@
 
 /*** file scope macro definitions ****************************************************************/
 
+/* how long to wait for directory sizes before update of status dialog: 25 FPS */
+#define DIRSIZE_WAIT_US (G_USEC_PER_SEC / 25)
+
 /*** file scope type declarations ****************************************************************/
 
 enum CompareMode
@@ -472,6 +476,85 @@ switch_to_listing (int panel_index)
         create_panel (panel_index, view_listing);
 }
 
+#ifdef ENABLE_DIR_SIZE_POOL
+/**
+ * Compute sizes of local directories in parallel. Each size is shown in the panel as soon as
+ * it is known.
+ *
+ * @param panel panel
+ * @param current index of the directory to compute, -1 for all marked directories or all
+ *                directories if none is marked
+ *
+ * @return TRUE if sizes were computed, FALSE if the panel directory is not local
+ */
+
+static gboolean
+dirsizes_compute_parallel (WPanel *panel, int current)
+{
+    dir_size_pool_t *pool;
+    dirsize_status_msg_t dsm;
+    status_msg_t *sm = STATUS_MSG (&dsm);
+    int i;
+
+    if (!vfs_file_is_local (panel->cwd_vpath))
+        return FALSE;
+
+    pool = dir_size_pool_new ();
+    if (pool == NULL)
+        return FALSE;
+
+    for (i = 0; i < panel->dir.len; i++)
+    {
+        const file_entry_t *fe = &panel->dir.list[i];
+
+        if (current >= 0 ? i == current
+            : (S_ISDIR (fe->st.st_mode) && !DIR_IS_DOTDOT (fe->fname->str)
+               && (panel->dirs_marked == 0 || fe->f.marked != 0)))
+        {
+            vfs_path_t *p;
+
+            p = vfs_path_append_new (panel->cwd_vpath, fe->fname->str, (char *) NULL);
+            dir_size_pool_add (pool, vfs_path_as_str (p), i);
+            vfs_path_free (p, TRUE);
+        }
+    }
+
+    memset (&dsm, 0, sizeof (dsm));
+    dsm.dirname_vpath = panel->cwd_vpath;
+    status_msg_init (sm, _("Directory scanning"), 0, dirsize_status_init_cb,
+                     dirsize_status_update_cb, dirsize_status_deinit_cb);
+
+    while (dir_size_pool_get_running (pool) != 0)
+    {
+        dir_size_result_t result;
+
+        if (dir_size_pool_pop (pool, DIRSIZE_WAIT_US, &result) && result.ok)
+        {
+            file_entry_t *fe = &panel->dir.list[result.id];
+
+            fe->st.st_size = (off_t) result.total;
+            fe->f.dir_size_computed = 1;
+
+            /* show the size at once */
+            widget_draw (WIDGET (panel));
+            if (!widget_get_state (WIDGET (sm->dlg), WST_CONSTRUCT))
+                widget_draw (WIDGET (sm->dlg));
+        }
+
+        dir_size_pool_get_progress (pool, &dsm.dir_count, &dsm.total_size);
+        if (sm->update (sm) == FILE_ABORT)
+            break;
+    }
+
+    /* sizes which are not computed yet are dropped */
+    dir_size_pool_free (pool);
+
+    status_msg_deinit (sm);
+
+    return TRUE;
+}
+#endif /* ENABLE_DIR_SIZE_POOL */
+
 /* --------------------------------------------------------------------------------------------- */
 /*** public functions ****************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
@@ -1263,7 +1346,11 @@ single_dirsize_cmd (WPanel *panel)
 
     entry = panel_current_entry (panel);
 
-    if (entry != NULL && S_ISDIR (entry->st.st_mode) && !DIR_IS_DOTDOT (entry->fname->str))
+    if (entry != NULL && S_ISDIR (entry->st.st_mode) && !DIR_IS_DOTDOT (entry->fname->str)
+#ifdef ENABLE_DIR_SIZE_POOL
+        && !dirsizes_compute_parallel (panel, panel->current)
+#endif
+        )
     {
         size_t dir_count = 0;
         size_t count = 0;
@@ -1293,7 +1380,7 @@ single_dirsize_cmd (WPanel *panel)
 
     recalculate_panel_summary (panel);
 
-    if (panel->sort_field->sort_routine == (GCompareFunc) sort_size)
+    if (panel->sort_field->sort_routine == (GCompareDataFunc) sort_size)
         panel_re_sort (panel);
 
     panel->dirty = TRUE;
@@ -1307,6 +1394,19 @@ dirsizes_cmd (WPanel *panel)
     int i;
     dirsize_status_msg_t dsm;
 
+#ifdef ENABLE_DIR_SIZE_POOL
+    if (dirsizes_compute_parallel (panel, -1))
+    {
+        recalculate_panel_summary (panel);
+
+        if (panel->sort_field->sort_routine == (GCompareDataFunc) sort_size)
+            panel_re_sort (panel);
+
+        panel->dirty = TRUE;
+        return;
+    }
+#endif
+
     memset (&dsm, 0, sizeof (dsm));
     status_msg_init (STATUS_MSG (&dsm), _("Directory scanning"), 0, dirsize_status_init_cb,
                      dirsize_status_update_cb, dirsize_status_deinit_cb);
@@ -1336,7 +1436,7 @@ dirsizes_cmd (WPanel *panel)
 
     recalculate_panel_summary (panel);
 
-    if (panel->sort_field->sort_routine == (GCompareFunc) sort_size)
+    if (panel->sort_field->sort_routine == (GCompareDataFunc) sort_size)
         panel_re_sort (panel);
 
     panel->dirty = TRUE;
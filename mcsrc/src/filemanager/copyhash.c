@@ -0,0 +1,220 @@
+/*
+   Checksum of copied data computed in a separate thread.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  copyhash.c
+ *  \brief Source: checksum of copied data computed in a separate thread
+ *
+ *  Data read by the copy are passed to the thread through a small ring of buffers, so the
+ *  checksum is computed while the next piece of file is read and written. The main thread
+ *  waits only if the checksum is slower than the copy itself.
+ *
+ *  The thread doesn't touch files or VFS, it only updates GChecksum.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "lib/global.h"
+
+#include "copyhash.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define COPY_HASH_COUNT 4
+#define COPY_HASH_MIN_SIZE (4 * 1024)
+#define COPY_HASH_MAX_SIZE (16 * 1024 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    guchar *data;
+    size_t len;
+} copy_hash_chunk_t;
+
+struct copy_hash_t
+{
+    GChecksum *checksum;
+    size_t size;
+    copy_hash_chunk_t chunks[COPY_HASH_COUNT];
+
+    /* buffers to fill */
+    GAsyncQueue *empty;
+    /* buffers to hash */
+    GAsyncQueue *full;
+    GThread *thread;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+static copy_hash_chunk_t copy_hash_stop_mark;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+copy_hash_thread (gpointer data)
+{
+    copy_hash_t *hash = (copy_hash_t *) data;
+    copy_hash_chunk_t *c;
+
+    while ((c = g_async_queue_pop (hash->full)) != &copy_hash_stop_mark)
+    {
+        g_checksum_update (hash->checksum, c->data, (gssize) c->len);
+        g_async_queue_push (hash->empty, c);
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_hash_stop (copy_hash_t *hash)
+{
+    if (hash->thread != NULL)
+    {
+        g_async_queue_push (hash->full, &copy_hash_stop_mark);
+        g_thread_join (hash->thread);
+        hash->thread = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the checksum thread. If thread cannot be started, checksum is computed in the
+ * calling thread.
+ *
+ * @param type checksum type
+ * @param size size of each buffer, usually the size of copy buffer
+ *
+ * @return new checksum, NULL if checksum type is not supported
+ */
+
+copy_hash_t *
+copy_hash_new (GChecksumType type, size_t size)
+{
+    copy_hash_t *hash;
+    GChecksum *checksum;
+    int i;
+
+    checksum = g_checksum_new (type);
+    if (checksum == NULL)
+        return NULL;
+
+    hash = g_new0 (copy_hash_t, 1);
+    hash->checksum = checksum;
+    hash->size = CLAMP (size, COPY_HASH_MIN_SIZE, COPY_HASH_MAX_SIZE);
+    hash->empty = g_async_queue_new ();
+    hash->full = g_async_queue_new ();
+
+    for (i = 0; i < COPY_HASH_COUNT; i++)
+    {
+        hash->chunks[i].data = g_malloc (hash->size);
+        g_async_queue_push (hash->empty, &hash->chunks[i]);
+    }
+
+    hash->thread = g_thread_try_new ("copyhash", copy_hash_thread, hash, NULL);
+
+    return hash;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop the thread and free the checksum.
+ */
+
+void
+copy_hash_free (copy_hash_t *hash)
+{
+    int i;
+
+    if (hash == NULL)
+        return;
+
+    copy_hash_stop (hash);
+
+    for (i = 0; i < COPY_HASH_COUNT; i++)
+        g_free (hash->chunks[i].data);
+
+    g_async_queue_unref (hash->empty);
+    g_async_queue_unref (hash->full);
+    g_checksum_free (hash->checksum);
+    g_free (hash);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Pass next piece of data to the checksum. Data are copied, so the caller can reuse
+ * its buffer immediately.
+ */
+
+void
+copy_hash_update (copy_hash_t *hash, const void *data, size_t len)
+{
+    const guchar *p = (const guchar *) data;
+
+    if (hash->thread == NULL)
+    {
+        g_checksum_update (hash->checksum, p, (gssize) len);
+        return;
+    }
+
+    while (len != 0)
+    {
+        copy_hash_chunk_t *c;
+
+        c = g_async_queue_pop (hash->empty);
+        c->len = MIN (len, hash->size);
+        memcpy (c->data, p, c->len);
+        g_async_queue_push (hash->full, c);
+
+        p += c->len;
+        len -= c->len;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for all passed data and get the checksum.
+ *
+ * @return checksum as a hexadecimal string to free with g_free(). No more data can be passed
+ *         to the checksum after this call.
+ */
+
+char *
+copy_hash_finish (copy_hash_t *hash)
+{
+    copy_hash_stop (hash);
+
+    return g_strdup (g_checksum_get_string (hash->checksum));
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,30 @@
+/** \file  copyhash.h
+ *  \brief Header: checksum of copied data computed in a separate thread
+ */
+
+#ifndef MC__COPYHASH_H
+#define MC__COPYHASH_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct copy_hash_t copy_hash_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_hash_t *copy_hash_new (GChecksumType type, size_t size);
+void copy_hash_free (copy_hash_t * hash);
+
+void copy_hash_update (copy_hash_t * hash, const void *data, size_t len);
+char *copy_hash_finish (copy_hash_t * hash);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYHASH_H */
@@ -0,0 +1,326 @@
+/*
+   Journal of copied files to resume interrupted copy or move.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  copyjournal.c
+ *  \brief Source: journal of copied files to resume interrupted copy or move
+ *
+ *  The journal is a text file in the cache directory. Its name is derived from the key of
+ *  operation (operation type, source, target, mask), so the same operation started again
+ *  finds the journal of the interrupted one. Each line is a record about one source file:
+ *
+ *      D <size> <path>      file is copied completely
+ *      P <offset> <path>    file is copied up to offset
+ *
+ *  Path is escaped with g_strescape(). The journal is appended only and is flushed to the
+ *  file system at least once per second, so only the last second of work can be lost if mc
+ *  is killed. The journal is removed when the operation is finished.
+ */
+
+#include <config.h>
+
+#include <inttypes.h>           /* PRIuMAX */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
+#include "lib/util.h"           /* exist_file() */
+
+#include "copyjournal.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define COPY_JOURNAL_FLUSH_INTERVAL_US G_USEC_PER_SEC
+/* escaped path can be up to 4 times longer than the path itself */
+#define COPY_JOURNAL_LINE_SIZE (MC_MAXPATHLEN * 4 + 64)
+
+#define COPY_JOURNAL_DONE 'D'
+#define COPY_JOURNAL_PARTIAL 'P'
+
+/*** file scope type declarations ****************************************************************/
+
+/* State of source file read from the journal */
+typedef struct
+{
+    gboolean done;
+    /* file size if done, copied size otherwise */
+    uintmax_t size;
+} copy_journal_entry_t;
+
+struct copy_journal_t
+{
+    char *path;
+    FILE *f;
+    gint64 last_flush;
+    /* source path -> copy_journal_entry_t, records of interrupted operation */
+    GHashTable *entries;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+copy_journal_get_path (const char *key)
+{
+    char *sum, *name, *path;
+
+    sum = g_compute_checksum_for_string (G_CHECKSUM_SHA1, key, -1);
+    name = g_strconcat (MC_COPY_JOURNAL_FILE, "-", sum, (char *) NULL);
+    path = g_build_filename (mc_config_get_cache_path (), name, (char *) NULL);
+    g_free (name);
+    g_free (sum);
+
+    return path;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_journal_load (copy_journal_t *journal)
+{
+    FILE *f;
+    char *line;
+    /* rest of too long line is skipped */
+    gboolean skip = FALSE;
+
+    f = fopen (journal->path, "r");
+    if (f == NULL)
+        return;
+
+    line = g_malloc (COPY_JOURNAL_LINE_SIZE);
+
+    while (fgets (line, COPY_JOURNAL_LINE_SIZE, f) != NULL)
+    {
+        char *size_end, *path_end;
+        uintmax_t size;
+        copy_journal_entry_t *e;
+        const gboolean skip_line = skip;
+
+        /* last line may be written partially */
+        path_end = strchr (line, '\n');
+        skip = path_end == NULL;
+        if (skip || skip_line || line[1] != ' '
+            || (line[0] != COPY_JOURNAL_DONE && line[0] != COPY_JOURNAL_PARTIAL))
+            continue;
+        *path_end = '\0';
+
+        size = (uintmax_t) g_ascii_strtoull (line + 2, &size_end, 10);
+        if (size_end == line + 2 || *size_end != ' ')
+            continue;
+
+        e = g_new (copy_journal_entry_t, 1);
+        e->done = line[0] == COPY_JOURNAL_DONE;
+        e->size = size;
+        /* later record replaces earlier one */
+        g_hash_table_replace (journal->entries, g_strcompress (size_end + 1), e);
+    }
+
+    g_free (line);
+    fclose (f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_journal_add (copy_journal_t *journal, char type, const char *path, uintmax_t size,
+                  gboolean flush)
+{
+    char *escaped;
+    gint64 now;
+
+    escaped = g_strescape (path, NULL);
+    fprintf (journal->f, "%c %" PRIuMAX " %s\n", type, size, escaped);
+    g_free (escaped);
+
+    now = g_get_monotonic_time ();
+    if (flush || now - journal->last_flush >= COPY_JOURNAL_FLUSH_INTERVAL_US)
+    {
+        fflush (journal->f);
+        journal->last_flush = now;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether operation with this key was interrupted and can be resumed.
+ */
+
+gboolean
+copy_journal_exists (const char *key)
+{
+    char *path;
+    gboolean ret;
+
+    path = copy_journal_get_path (key);
+    ret = exist_file (path);
+    g_free (path);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the journal of operation.
+ *
+ * @param key string which identifies the operation
+ * @param resume TRUE to read records of interrupted operation and continue its journal,
+ *               FALSE to start new journal
+ *
+ * @return new journal, NULL if journal file cannot be created
+ */
+
+copy_journal_t *
+copy_journal_new (const char *key, gboolean resume)
+{
+    copy_journal_t *journal;
+
+    journal = g_new0 (copy_journal_t, 1);
+    journal->path = copy_journal_get_path (key);
+    journal->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+    if (resume)
+        copy_journal_load (journal);
+
+    journal->f = fopen (journal->path, resume ? "a" : "w");
+    if (journal->f == NULL)
+    {
+        copy_journal_free (journal, FALSE);
+        return NULL;
+    }
+
+    journal->last_flush = g_get_monotonic_time ();
+
+    return journal;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Close the journal.
+ *
+ * @param finished TRUE if operation is finished and journal is not needed anymore
+ */
+
+void
+copy_journal_free (copy_journal_t *journal, gboolean finished)
+{
+    if (journal == NULL)
+        return;
+
+    if (journal->f != NULL)
+        fclose (journal->f);
+
+    if (finished)
+        unlink (journal->path);
+
+    g_hash_table_destroy (journal->entries);
+    g_free (journal->path);
+    g_free (journal);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether source file was copied completely by interrupted operation.
+ *
+ * @param size where the size of copied file is stored
+ */
+
+gboolean
+copy_journal_is_done (const copy_journal_t *journal, const char *path, uintmax_t *size)
+{
+    const copy_journal_entry_t *e;
+
+    e = (const copy_journal_entry_t *) g_hash_table_lookup (journal->entries, path);
+    if (e == NULL || !e->done)
+        return FALSE;
+
+    *size = e->size;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether source file was copied partially by interrupted operation.
+ *
+ * @param offset where the size of copied part is stored
+ */
+
+gboolean
+copy_journal_get_partial (const copy_journal_t *journal, const char *path, mc_off_t *offset)
+{
+    const copy_journal_entry_t *e;
+
+    e = (const copy_journal_entry_t *) g_hash_table_lookup (journal->entries, path);
+    if (e == NULL || e->done)
+        return FALSE;
+
+    *offset = (mc_off_t) e->size;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record that source file is copied completely.
+ */
+
+void
+copy_journal_add_done (copy_journal_t *journal, const char *path, uintmax_t size)
+{
+    copy_journal_add (journal, COPY_JOURNAL_DONE, path, size, FALSE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Record that source file is copied up to offset.
+ */
+
+void
+copy_journal_add_partial (copy_journal_t *journal, const char *path, mc_off_t offset)
+{
+    copy_journal_add (journal, COPY_JOURNAL_PARTIAL, path, (uintmax_t) offset, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget record of interrupted operation about source file, so it is copied from the start.
+ * The record stays in the journal file until it is replaced by records of the new copy,
+ * it is checked again if operation is resumed once more.
+ */
+
+void
+copy_journal_forget (copy_journal_t *journal, const char *path)
+{
+    g_hash_table_remove (journal->entries, path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,38 @@
+/** \file  copyjournal.h
+ *  \brief Header: journal of copied files to resume interrupted copy or move
+ */
+
+#ifndef MC__COPYJOURNAL_H
+#define MC__COPYJOURNAL_H
+
+#include <inttypes.h>           /* uintmax_t */
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct copy_journal_t copy_journal_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+gboolean copy_journal_exists (const char *key);
+copy_journal_t *copy_journal_new (const char *key, gboolean resume);
+void copy_journal_free (copy_journal_t * journal, gboolean finished);
+
+gboolean copy_journal_is_done (const copy_journal_t * journal, const char *path, uintmax_t * size);
+gboolean copy_journal_get_partial (const copy_journal_t * journal, const char *path,
+                                   mc_off_t * offset);
+
+void copy_journal_add_done (copy_journal_t * journal, const char *path, uintmax_t size);
+void copy_journal_add_partial (copy_journal_t * journal, const char *path, mc_off_t offset);
+void copy_journal_forget (copy_journal_t * journal, const char *path);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYJOURNAL_H */
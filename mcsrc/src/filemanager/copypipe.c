@@ -0,0 +1,456 @@
+/*
+   Read-ahead and write-behind thread for file copy.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  copypipe.c
+ *  \brief Source: read-ahead and write-behind thread for file copy
+ *
+ *  If one file of the copy is local and another one is not (local disk to sftp, ftp to
+ *  local disk, etc), the local file is read or written in a separate thread while the main
+ *  thread works with the other one. The threads exchange a ring of buffers, so the total time
+ *  of copy is the time of the slower side rather than the sum of both.
+ *
+ *  VFS is not thread-safe, so the thread uses only plain read() or write() on the descriptor
+ *  of the local file. Errors are not reported in the thread: the copy continues in the main
+ *  thread from the place where the thread failed, and error dialogs are shown there.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "copypipe.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define COPY_PIPE_MIN_COUNT 2
+#define COPY_PIPE_MAX_COUNT 64
+#define COPY_PIPE_MIN_SIZE (4 * 1024)
+#define COPY_PIPE_MAX_SIZE (64 * 1024 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct
+{
+    char *data;
+    /* size of data in the buffer */
+    size_t len;
+    /* size of written data */
+    size_t done;
+} copy_pipe_chunk_t;
+
+struct copy_pipe_t
+{
+    int fd;
+    gboolean reading;
+    size_t size;
+    int count;
+    copy_pipe_chunk_t *chunks;
+
+    /* buffers to fill: free ones for reader, written ones for writer */
+    GAsyncQueue *empty;
+    /* filled buffers: read ones for reader, ones to write for writer */
+    GAsyncQueue *full;
+    GThread *thread;
+
+    /* errno of the failed read() or write(); set by thread before the error mark is pushed */
+    int error;
+    /* buffers which were not written by the writer thread because of error */
+    GQueue unwritten;
+    /* pipe is freed: writer thread drops data which are not written yet */
+    gint cancelled;
+
+    /* main thread data */
+    /* buffer which is used by the main thread now */
+    copy_pipe_chunk_t *current;
+    /* end of file is reached or an error is got */
+    gboolean finished;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* marks in the buffer queues */
+static copy_pipe_chunk_t copy_pipe_stop_mark;
+static copy_pipe_chunk_t copy_pipe_flush_mark;
+static copy_pipe_chunk_t copy_pipe_error_mark;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+copy_pipe_reader (gpointer data)
+{
+    copy_pipe_t *cpipe = (copy_pipe_t *) data;
+    copy_pipe_chunk_t *c;
+
+    while ((c = g_async_queue_pop (cpipe->empty)) != &copy_pipe_stop_mark)
+    {
+        ssize_t n;
+
+        do
+            n = read (cpipe->fd, c->data, cpipe->size);
+        while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+        {
+            /* file position is not changed: main thread will read it again */
+            cpipe->error = errno;
+            g_async_queue_push (cpipe->full, &copy_pipe_error_mark);
+            break;
+        }
+
+        c->len = (size_t) n;
+        g_async_queue_push (cpipe->full, c);
+
+        if (n == 0)
+            break;
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+copy_pipe_writer (gpointer data)
+{
+    copy_pipe_t *cpipe = (copy_pipe_t *) data;
+    copy_pipe_chunk_t *c;
+
+    while ((c = g_async_queue_pop (cpipe->full)) != &copy_pipe_stop_mark)
+    {
+        if (c == &copy_pipe_flush_mark)
+        {
+            g_async_queue_push (cpipe->empty, c);
+            continue;
+        }
+
+        /* don't make the main thread wait for data which are dropped anyway */
+        if (g_atomic_int_get (&cpipe->cancelled) != 0)
+            continue;
+
+        while (cpipe->error == 0 && c->done < c->len
+               && g_atomic_int_get (&cpipe->cancelled) == 0)
+        {
+            ssize_t n;
+
+            n = write (cpipe->fd, c->data + c->done, c->len - c->done);
+            if (n >= 0)
+                c->done += (size_t) n;
+            else if (errno != EINTR)
+            {
+                cpipe->error = errno;
+                /* wake up the main thread */
+                g_async_queue_push (cpipe->empty, &copy_pipe_error_mark);
+            }
+        }
+
+        if (cpipe->error == 0)
+            g_async_queue_push (cpipe->empty, c);
+        else
+            g_queue_push_tail (&cpipe->unwritten, c);
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_pipe_stop (copy_pipe_t *cpipe)
+{
+    if (cpipe->thread != NULL)
+    {
+        g_async_queue_push (cpipe->reading ? cpipe->empty : cpipe->full, &copy_pipe_stop_mark);
+        g_thread_join (cpipe->thread);
+        cpipe->thread = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the thread to read or write local file.
+ *
+ * @param fd descriptor of local file
+ * @param reading TRUE to read file ahead, FALSE to write it behind
+ * @param count number of buffers
+ * @param size size of each buffer
+ *
+ * @return new pipe, NULL if thread cannot be started
+ */
+
+copy_pipe_t *
+copy_pipe_new (int fd, gboolean reading, int count, size_t size)
+{
+    copy_pipe_t *cpipe;
+    int i;
+
+    if (fd < 0)
+        return NULL;
+
+    cpipe = g_new0 (copy_pipe_t, 1);
+    cpipe->fd = fd;
+    cpipe->reading = reading;
+    cpipe->count = CLAMP (count, COPY_PIPE_MIN_COUNT, COPY_PIPE_MAX_COUNT);
+    cpipe->size = CLAMP (size, COPY_PIPE_MIN_SIZE, COPY_PIPE_MAX_SIZE);
+    cpipe->empty = g_async_queue_new ();
+    cpipe->full = g_async_queue_new ();
+    g_queue_init (&cpipe->unwritten);
+
+    cpipe->chunks = g_new0 (copy_pipe_chunk_t, cpipe->count);
+    for (i = 0; i < cpipe->count; i++)
+    {
+        cpipe->chunks[i].data = g_malloc (cpipe->size);
+        g_async_queue_push (cpipe->empty, &cpipe->chunks[i]);
+    }
+
+    cpipe->thread = g_thread_try_new ("copy", reading ? copy_pipe_reader : copy_pipe_writer,
+                                      cpipe, NULL);
+    if (cpipe->thread == NULL)
+    {
+        copy_pipe_free (cpipe);
+        return NULL;
+    }
+
+    return cpipe;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop the thread and free the pipe. Data which were passed to the writer thread but not
+ * written yet are dropped, so the caller doesn't wait for them: call copy_pipe_flush() first
+ * to write the whole file.
+ */
+
+void
+copy_pipe_free (copy_pipe_t *cpipe)
+{
+    int i;
+
+    if (cpipe == NULL)
+        return;
+
+    g_atomic_int_set (&cpipe->cancelled, 1);
+    copy_pipe_stop (cpipe);
+
+    for (i = 0; i < cpipe->count; i++)
+        g_free (cpipe->chunks[i].data);
+    g_free (cpipe->chunks);
+
+    g_queue_clear (&cpipe->unwritten);
+    g_async_queue_unref (cpipe->empty);
+    g_async_queue_unref (cpipe->full);
+    g_free (cpipe);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+copy_pipe_is_reading (const copy_pipe_t *cpipe)
+{
+    return cpipe->reading;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+size_t
+copy_pipe_get_size (const copy_pipe_t *cpipe)
+{
+    return cpipe->size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get next piece of file read by the thread. Data are valid until the next call.
+ *
+ * @param cpipe read-ahead pipe
+ * @param data where the pointer to data is stored
+ *
+ * @return size of data, 0 at end of file, -1 on error (errno is set). After error the file
+ *         position is the position of failed read().
+ */
+
+ssize_t
+copy_pipe_read (copy_pipe_t *cpipe, char **data)
+{
+    copy_pipe_chunk_t *c;
+
+    if (cpipe->current != NULL)
+    {
+        g_async_queue_push (cpipe->empty, cpipe->current);
+        cpipe->current = NULL;
+    }
+
+    if (cpipe->finished)
+        return 0;
+
+    c = g_async_queue_pop (cpipe->full);
+
+    if (c == &copy_pipe_error_mark)
+    {
+        cpipe->finished = TRUE;
+        errno = cpipe->error;
+        return (-1);
+    }
+
+    if (c->len == 0)
+    {
+        cpipe->finished = TRUE;
+        g_async_queue_push (cpipe->empty, c);
+        return 0;
+    }
+
+    cpipe->current = c;
+    *data = c->data;
+    return (ssize_t) c->len;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get buffer to fill with data to write. Buffer size is copy_pipe_get_size().
+ *
+ * @return buffer, NULL if the thread failed to write previous data (errno is set).
+ *         Use copy_pipe_get_unwritten() to get data which were not written.
+ */
+
+char *
+copy_pipe_get_buffer (copy_pipe_t *cpipe)
+{
+    copy_pipe_chunk_t *c;
+
+    if (cpipe->finished)
+    {
+        errno = cpipe->error;
+        return NULL;
+    }
+
+    if (cpipe->current == NULL)
+    {
+        c = g_async_queue_pop (cpipe->empty);
+        if (c == &copy_pipe_error_mark)
+        {
+            cpipe->finished = TRUE;
+            errno = cpipe->error;
+            return NULL;
+        }
+
+        c->len = 0;
+        c->done = 0;
+        cpipe->current = c;
+    }
+
+    return cpipe->current->data;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Pass the buffer got by copy_pipe_get_buffer() to the thread to write.
+ *
+ * @param len size of data in the buffer
+ */
+
+void
+copy_pipe_commit (copy_pipe_t *cpipe, size_t len)
+{
+    if (cpipe->current != NULL)
+    {
+        cpipe->current->len = len;
+        g_async_queue_push (cpipe->full, cpipe->current);
+        cpipe->current = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait until all passed data are written.
+ *
+ * @return 0 on success, -1 on error (errno is set)
+ */
+
+int
+copy_pipe_flush (copy_pipe_t *cpipe)
+{
+    GSList *written = NULL;
+    copy_pipe_chunk_t *c;
+
+    if (cpipe->finished)
+    {
+        errno = cpipe->error;
+        return (-1);
+    }
+
+    g_async_queue_push (cpipe->full, &copy_pipe_flush_mark);
+
+    while ((c = g_async_queue_pop (cpipe->empty)) != &copy_pipe_flush_mark)
+    {
+        if (c == &copy_pipe_error_mark)
+            cpipe->finished = TRUE;
+        else
+            written = g_slist_prepend (written, c);
+    }
+
+    for (; written != NULL; written = g_slist_delete_link (written, written))
+        g_async_queue_push (cpipe->empty, written->data);
+
+    if (cpipe->finished)
+    {
+        errno = cpipe->error;
+        return (-1);
+    }
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get next piece of data which the thread failed to write. The thread is stopped at first call.
+ * Data are valid until the pipe is freed.
+ *
+ * @return TRUE if data are found, FALSE otherwise
+ */
+
+gboolean
+copy_pipe_get_unwritten (copy_pipe_t *cpipe, char **data, size_t *len)
+{
+    copy_pipe_chunk_t *c;
+
+    copy_pipe_stop (cpipe);
+
+    c = g_queue_pop_head (&cpipe->unwritten);
+    if (c == NULL)
+        return FALSE;
+
+    *data = c->data + c->done;
+    *len = c->len - c->done;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,39 @@
+/** \file  copypipe.h
+ *  \brief Header: read-ahead and write-behind thread for file copy
+ */
+
+#ifndef MC__COPYPIPE_H
+#define MC__COPYPIPE_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct copy_pipe_t copy_pipe_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_pipe_t *copy_pipe_new (int fd, gboolean reading, int count, size_t size);
+void copy_pipe_free (copy_pipe_t * cpipe);
+
+gboolean copy_pipe_is_reading (const copy_pipe_t * cpipe);
+size_t copy_pipe_get_size (const copy_pipe_t * cpipe);
+
+/* read-ahead pipe */
+ssize_t copy_pipe_read (copy_pipe_t * cpipe, char **data);
+
+/* write-behind pipe */
+char *copy_pipe_get_buffer (copy_pipe_t * cpipe);
+void copy_pipe_commit (copy_pipe_t * cpipe, size_t len);
+int copy_pipe_flush (copy_pipe_t * cpipe);
+gboolean copy_pipe_get_unwritten (copy_pipe_t * cpipe, char **data, size_t *len);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYPIPE_H */
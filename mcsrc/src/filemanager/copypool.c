@@ -0,0 +1,445 @@
+/*
+   Thread pool to copy local files in parallel.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  copypool.c
+ *  \brief Source: thread pool to copy local files in parallel
+ *
+ *  Copying of a lot of small files is bound by latency of open/close/utime rather than
+ *  by bandwidth. The pool copies such files concurrently.
+ *
+ *  VFS and UI are not thread-safe, so worker threads use only plain system calls on local
+ *  files. All decisions which require user interaction are made by the pool owner: a job
+ *  which failed by any reason is reported back with the target file removed, and the owner
+ *  copies that file again in the usual way to show an error or replace dialog.
+ *
+ *  On copy-on-write file systems data blocks of the file are shared with the target file
+ *  rather than copied, so a tree is cloned at the speed of metadata updates.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(HAVE_LINUX_FS_H) && defined(HAVE_SYS_IOCTL_H)
+#include <linux/fs.h>           /* FICLONE */
+#include <sys/ioctl.h>
+#endif
+
+#ifdef ENABLE_EXT2FS_ATTR
+#include <e2p/e2p.h>            /* fgetflags(), fsetflags() */
+#endif
+
+#include "lib/global.h"
+#include "lib/vfs/utilvfs.h"    /* vfs_utime(), vfs_get_timesbuf_from_stat() */
+
+#include "copypool.h"
+
+#ifdef ENABLE_COPY_POOL
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define COPY_POOL_BUFSIZE (64 * 1024)
+
+#ifdef HAVE_COPY_FILE_RANGE
+#define COPY_POOL_KERNEL_CHUNK (8 * 1024 * 1024)
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct copy_pool_t
+{
+    GThreadPool *threads;
+    /* finished jobs */
+    GAsyncQueue *results;
+    /* number of pushed jobs which are not popped yet */
+    guint running;
+    gint cancelled;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* copy buffer of each worker thread */
+static GPrivate copy_pool_buffer = G_PRIVATE_INIT (g_free);
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+copy_pool_write_all (int fd, const char *buf, ssize_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n;
+
+        n = write (fd, buf, (size_t) len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+
+        buf += n;
+        len -= n;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/**
+ * Copy data of the file.
+ *
+ * @param size size of the source file
+ *
+ * @return 0 on success, errno otherwise
+ */
+
+static int
+copy_pool_copy_data (copy_pool_t *pool, int src_fd, int dst_fd, off_t size)
+{
+    char *buf;
+#ifdef HAVE_COPY_FILE_RANGE
+    gboolean kernel_copy = TRUE;
+    off_t copied = 0;
+#else
+    (void) size;
+#endif
+
+    while (g_atomic_int_get (&pool->cancelled) == 0)
+    {
+        ssize_t n;
+
+#ifdef HAVE_COPY_FILE_RANGE
+        if (kernel_copy)
+        {
+            n = copy_file_range (src_fd, NULL, dst_fd, NULL, COPY_POOL_KERNEL_CHUNK, 0);
+            if (n > 0)
+            {
+                copied += n;
+                continue;
+            }
+            /* Kernels 5.3 to 5.18 copy nothing from procfs and sysfs files, which report
+               zero or wrong size. End of file is trusted only if the whole size is copied */
+            if (n == 0 && size != 0 && copied >= size)
+                return 0;
+            if (n < 0 && errno != ENOSYS && errno != EXDEV && errno != EINVAL && errno != EBADF
+                && errno != ENOTSUP && errno != EOPNOTSUPP)
+                return errno;
+
+            /* continue with read/write from the current position */
+            kernel_copy = FALSE;
+        }
+#endif
+
+        buf = g_private_get (&copy_pool_buffer);
+        if (buf == NULL)
+        {
+            buf = g_malloc (COPY_POOL_BUFSIZE);
+            g_private_set (&copy_pool_buffer, buf);
+        }
+
+        n = read (src_fd, buf, COPY_POOL_BUFSIZE);
+        if (n == 0)
+            return 0;
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return errno;
+        }
+
+        if (!copy_pool_write_all (dst_fd, buf, n))
+            return errno;
+    }
+
+    return ECANCELED;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef ENABLE_EXT2FS_ATTR
+static int
+copy_pool_copy_attrs (const copy_job_t *job)
+{
+    unsigned long attrs;
+
+    if (fgetflags (job->src_path, &attrs) == 0 && fsetflags (job->dst_path, attrs) == 0)
+        return 0;
+
+    /* attributes aren't supported in this FS */
+    if (errno == ENOTSUP || errno == EOPNOTSUPP || errno == ENOSYS || errno == EINVAL
+        || errno == ENOTTY || errno == ELOOP || errno == ENXIO)
+        return 0;
+
+    return errno;
+}
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+copy_pool_copy_file (copy_pool_t *pool, copy_job_t *job)
+{
+    int src_fd, dst_fd;
+    mc_stat_t st;
+    mc_timesbuf_t times;
+    int error = 0;
+
+    if (g_atomic_int_get (&pool->cancelled) != 0)
+        return ECANCELED;
+
+    src_fd = open (job->src_path, O_RDONLY);
+    if (src_fd == -1)
+        return errno;
+
+    if (fstat (src_fd, &st) != 0)
+        error = errno;
+    else if (!S_ISREG (st.st_mode) || st.st_dev != job->src_stat.st_dev
+             || st.st_ino != job->src_stat.st_ino)
+        error = ESTALE;         /* file was replaced after stat() */
+
+    if (error != 0)
+    {
+        close (src_fd);
+        return error;
+    }
+
+    /* Owner sets umask temporarily, so permissions are set explicitly below */
+    dst_fd = open (job->dst_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (dst_fd == -1)
+    {
+        error = errno;
+        close (src_fd);
+        return error;
+    }
+
+#ifdef FICLONE
+    if (job->try_clone)
+    {
+        job->cloned = ioctl (dst_fd, FICLONE, src_fd) == 0;
+        if (!job->cloned)
+            job->clone_error = errno;
+    }
+
+    if (!job->cloned)
+#endif
+        error = copy_pool_copy_data (pool, src_fd, dst_fd, st.st_size);
+
+    if (error == 0 && job->preserve_uidgid
+        && fchown (dst_fd, job->src_stat.st_uid, job->src_stat.st_gid) != 0)
+        error = errno;
+
+    if (error == 0 && fchmod (dst_fd, job->dst_mode) != 0)
+        error = errno;
+
+    if (close (dst_fd) != 0 && error == 0)
+        error = errno;
+
+    close (src_fd);
+
+    if (error == 0)
+    {
+        vfs_get_timesbuf_from_stat (&job->src_stat, &times);
+        (void) vfs_utime (job->dst_path, &times);
+
+#ifdef ENABLE_EXT2FS_ATTR
+        if (job->preserve_attrs)
+            error = copy_pool_copy_attrs (job);
+#endif
+    }
+
+    if (error != 0)
+        unlink (job->dst_path);
+
+    return error;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_pool_worker (gpointer data, gpointer user_data)
+{
+    copy_job_t *job = (copy_job_t *) data;
+    copy_pool_t *pool = (copy_pool_t *) user_data;
+
+    job->error = copy_pool_copy_file (pool, job);
+    g_async_queue_push (pool->results, job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create pool of worker threads.
+ *
+ * @param workers number of threads
+ *
+ * @return new pool, NULL if threads cannot be created
+ */
+
+copy_pool_t *
+copy_pool_new (int workers)
+{
+    copy_pool_t *pool;
+
+    pool = g_new0 (copy_pool_t, 1);
+    pool->results = g_async_queue_new ();
+    pool->threads = g_thread_pool_new (copy_pool_worker, pool,
+                                       CLAMP (workers, 1, COPY_POOL_MAX_WORKERS), FALSE, NULL);
+    if (pool->threads == NULL)
+    {
+        g_async_queue_unref (pool->results);
+        g_free (pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for all jobs and destroy the pool. Results which were not popped are dropped.
+ */
+
+void
+copy_pool_free (copy_pool_t *pool)
+{
+    copy_job_t *job;
+
+    if (pool == NULL)
+        return;
+
+    g_thread_pool_free (pool->threads, FALSE, TRUE);
+
+    while ((job = g_async_queue_try_pop (pool->results)) != NULL)
+        copy_job_free (job);
+
+    g_async_queue_unref (pool->results);
+    g_free (pool);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of worker threads.
+ */
+
+int
+copy_pool_get_workers (const copy_pool_t *pool)
+{
+    return g_thread_pool_get_max_threads (pool->threads);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue the job to copy. Pool owns the job until it is popped.
+ */
+
+void
+copy_pool_push (copy_pool_t *pool, copy_job_t *job)
+{
+    pool->running++;
+    g_thread_pool_push (pool->threads, job, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the finished job.
+ *
+ * @param pool pool
+ * @param timeout time to wait for a job in microseconds, 0 to return immediately
+ *
+ * @return finished job, NULL if no job was finished during timeout
+ */
+
+copy_job_t *
+copy_pool_pop (copy_pool_t *pool, gint64 timeout)
+{
+    copy_job_t *job;
+
+    if (pool->running == 0)
+        return NULL;
+
+    if (timeout <= 0)
+        job = g_async_queue_try_pop (pool->results);
+    else
+        job = g_async_queue_timeout_pop (pool->results, (guint64) timeout);
+
+    if (job != NULL)
+        pool->running--;
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+guint
+copy_pool_get_running (const copy_pool_t *pool)
+{
+    return pool->running;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop copying. Unfinished jobs fail with ECANCELED.
+ */
+
+void
+copy_pool_cancel (copy_pool_t *pool)
+{
+    g_atomic_int_set (&pool->cancelled, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+copy_pool_is_cancelled (copy_pool_t *pool)
+{
+    return (g_atomic_int_get (&pool->cancelled) != 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+copy_job_free (copy_job_t *job)
+{
+    if (job != NULL)
+    {
+        g_free (job->src_path);
+        g_free (job->dst_path);
+        g_free (job);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_COPY_POOL */
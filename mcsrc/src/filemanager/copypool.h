@@ -0,0 +1,73 @@
+/** \file  copypool.h
+ *  \brief Header: thread pool to copy local files in parallel
+ */
+
+#ifndef MC__COPYPOOL_H
+#define MC__COPYPOOL_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"        /* mc_stat_t */
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Worker threads use the POSIX file API directly bypassing VFS */
+#ifndef WIN32
+#define ENABLE_COPY_POOL 1
+#endif
+
+#define COPY_POOL_MAX_WORKERS 64
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct copy_pool_t copy_pool_t;
+
+/* Copy of one regular file */
+typedef struct
+{
+    /* Local source and target file names */
+    char *src_path;
+    char *dst_path;
+    /* Status of source file got before the copy */
+    mc_stat_t src_stat;
+    /* Permission bits of created target file */
+    mode_t dst_mode;
+    /* Whether to set owner and ext2 attributes of target file */
+    gboolean preserve_uidgid;
+    gboolean preserve_attrs;
+    /* Whether to share data blocks with the source file on copy-on-write file systems */
+    gboolean try_clone;
+    /* Device of target directory and counter of unfinished jobs of it. Used by pool owner only */
+    dev_t dst_dev;
+    int *pending;
+
+    /* Result: 0 on success, errno value otherwise.
+       Target file is removed if the copy failed */
+    int error;
+    /* Whether data blocks are shared rather than copied */
+    gboolean cloned;
+    /* errno value of the failed attempt to share data blocks */
+    int clone_error;
+} copy_job_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+copy_pool_t *copy_pool_new (int workers);
+void copy_pool_free (copy_pool_t * pool);
+int copy_pool_get_workers (const copy_pool_t * pool);
+
+void copy_pool_push (copy_pool_t * pool, copy_job_t * job);
+copy_job_t *copy_pool_pop (copy_pool_t * pool, gint64 timeout);
+guint copy_pool_get_running (const copy_pool_t * pool);
+
+void copy_pool_cancel (copy_pool_t * pool);
+gboolean copy_pool_is_cancelled (copy_pool_t * pool);
+
+void copy_job_free (copy_job_t * job);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__COPYPOOL_H */
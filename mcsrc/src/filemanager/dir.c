@@ -47,40 +47,73 @@
 
 #include "treestore.h"
 #include "file.h"               /* file_is_symlink_to_dir() */
+#include "dirpool.h"
+#include "dirstat.h"
+#include "dirsort.h"
 #include "dir.h"
 
 /*** global variables ****************************************************************************/
 
 /*** file scope macro definitions ****************************************************************/
 
-#define MY_ISDIR(x) (\
-    (is_exe (x->st.st_mode) && !(S_ISDIR (x->st.st_mode) || link_isdir (x)) && exec_first) \
+#define MY_ISDIR(x, op) (\
+    (is_exe (x->st.st_mode) && !(S_ISDIR (x->st.st_mode) || link_isdir (x)) && op->exec_first) \
         ? 1 \
         : ( (S_ISDIR (x->st.st_mode) || link_isdir (x)) ? 2 : 0) )
 
-/*** file scope type declarations ****************************************************************/
+/* Maps signed integer to unsigned one keeping the order */
+#define SIGNED_KEY(x) ((guint64) (gint64) (x) ^ G_GUINT64_CONSTANT (0x8000000000000000))
 
-/*** forward declarations (file scope functions) *************************************************/
+/* Number of names read at once by synchronous load */
+#define DIR_LIST_LOAD_BATCH 4096
+/* Number of names read at once by load in steps, if they are not stat'ed by threads */
+#define DIR_LIST_LOAD_STEP_BATCH 256
+/* Minimal number of entries worth a thread to create sort keys */
+#define DIR_LIST_KEYS_PARALLEL_MIN 2048
+/* Maximal number of changed entries inserted one by one, more ones are sorted with others */
+#define DIR_LIST_INSERT_MAX 64
 
-/*** file scope variables ************************************************************************/
+/*** file scope type declarations ****************************************************************/
 
-/* Reverse flag */
-static int reverse = 1;
+/* Integer key of entry for radix sort */
+typedef guint64 (*dir_list_int_key_fn) (const file_entry_t * fentry);
 
-/* Are the files sorted case sensitively? */
-static gboolean case_sensitive = OS_SORT_CASE_SENSITIVE_DEFAULT;
+/* Sort keys created by several threads */
+typedef struct
+{
+    file_entry_t *entries;
+    gboolean case_sensitive;
+    /* create keys of extensions too */
+    gboolean extension;
+} dir_list_keys_t;
+
+struct dir_list_loader_t
+{
+    dir_list *list;
+    vfs_path_t *vpath;
+    const file_filter_t *filter;
+    DIR *dirp;
+#ifdef ENABLE_DIR_STAT
+    dir_stat_t *ds;
+#endif
+    /* names of subdirectories to update the tree store */
+    GPtrArray *dirs;
+    /* all entries are read */
+    gboolean finished;
+    /* list cannot grow */
+    gboolean error;
+};
 
-/* Are the exec_bit files top in list */
-static gboolean exec_first = TRUE;
+/*** forward declarations (file scope functions) *************************************************/
 
-static dir_list dir_copy = { NULL, 0, 0, NULL };
+/*** file scope variables ************************************************************************/
 
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
 /* --------------------------------------------------------------------------------------------- */
 
 static inline int
-key_collate (const char *t1, const char *t2)
+key_collate (const char *t1, const char *t2, const dir_sort_options_t *sort_op)
 {
     int dotdot = 0;
     int ret;
@@ -91,7 +124,9 @@ key_collate (const char *t1, const char *t2)
     {
     case 0:
     case 3:
-        ret = str_key_collate (t1, t2, case_sensitive) * reverse;
+        ret = str_key_collate (t1, t2, sort_op->case_sensitive);
+        if (sort_op->reverse)
+            ret = -ret;
         break;
     case 1:
         ret = -1;               /* t1 < t2 */
@@ -109,20 +144,23 @@ key_collate (const char *t1, const char *t2)
 /* --------------------------------------------------------------------------------------------- */
 
 static inline int
-compare_by_names (file_entry_t *a, file_entry_t *b)
+compare_by_names (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    /* create key if does not exist, key will be freed after sorting */
-    if (a->name_sort_key == NULL)
-        a->name_sort_key = str_create_key_for_filename (a->fname->str, case_sensitive);
-    if (b->name_sort_key == NULL)
-        b->name_sort_key = str_create_key_for_filename (b->fname->str, case_sensitive);
+    /* keys are created by dir_list_sort() */
+    return key_collate (a->name_sort_key, b->name_sort_key, sort_op);
+}
+
+/* --------------------------------------------------------------------------------------------- */
 
-    return key_collate (a->name_sort_key, b->name_sort_key);
+static inline int
+apply_reverse (int result, const dir_sort_options_t *sort_op)
+{
+    return sort_op->reverse ? -result : result;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 /**
- * clear keys, should be call after sorting is finished.
+ * Free sort keys of entries, should be called before entries are freed.
  */
 
 static void
@@ -135,34 +173,301 @@ clean_sort_keys (dir_list *list, int start, int count)
         file_entry_t *fentry;
 
         fentry = &list->list[i + start];
-        str_release_key (fentry->name_sort_key, case_sensitive);
+        str_release_key (fentry->name_sort_key, list->keys_case_sensitive);
         fentry->name_sort_key = NULL;
-        str_release_key (fentry->extension_sort_key, case_sensitive);
+        str_release_key (fentry->extension_sort_key, list->keys_case_sensitive);
         fentry->extension_sort_key = NULL;
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static GString *
+new_entry_name (dir_list *list, const char *fname)
+{
+    if (list->names == NULL)
+        list->names = dir_pool_new ();
+
+    return dir_pool_add (list->names, fname, strlen (fname));
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
- * If you change handle_dirent then check also handle_path.
- * @return FALSE = don't add, TRUE = add to the list
+ * Free all entries at once. Allocated entries and storage of names are kept for reuse.
  */
 
-static gboolean
-handle_dirent (struct vfs_dirent *dp, const file_filter_t *filter, mc_stat_t *buf1,
-               gboolean *link_to_dir, gboolean *stale_link)
+static void
+clean_entries (dir_list *list)
 {
-    vfs_path_t *vpath;
-    gboolean ok = TRUE;
+    int i;
+
+    clean_sort_keys (list, 0, list->len);
+
+    for (i = 0; i < list->len; i++)
+        list->list[i].fname = NULL;
+
+    dir_pool_reset (list->names);
+    list->len = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+create_sort_keys_part (gpointer data, gsize start, gsize end)
+{
+    const dir_list_keys_t *keys = (const dir_list_keys_t *) data;
+    gsize i;
+
+    for (i = start; i < end; i++)
+    {
+        file_entry_t *fentry = &keys->entries[i];
+
+        if (fentry->name_sort_key == NULL)
+            fentry->name_sort_key =
+                str_create_key_for_filename (fentry->fname->str, keys->case_sensitive);
+        if (keys->extension && fentry->extension_sort_key == NULL)
+            fentry->extension_sort_key =
+                str_create_key (extension (fentry->fname->str), keys->case_sensitive);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create sort keys of entries which don't have them yet. Keys are kept until entries are
+ * freed, so they are created once per load of directory, not on each sort.
+ */
+
+static void
+create_sort_keys (dir_list *list, GCompareDataFunc sort, const dir_sort_options_t *sort_op)
+{
+    dir_list_keys_t keys;
+
+    keys.entries = list->list;
+    keys.case_sensitive = sort_op->case_sensitive ? TRUE : FALSE;
+    keys.extension = sort == (GCompareDataFunc) sort_ext;
+
+    /* keys of other case sensitivity are useless */
+    if (list->keys_case_sensitive != keys.case_sensitive)
+    {
+        clean_sort_keys (list, 0, list->len);
+        list->keys_case_sensitive = keys.case_sensitive;
+    }
+
+    dir_sort_parallel ((gsize) list->len, DIR_LIST_KEYS_PARALLEL_MIN, create_sort_keys_part,
+                       &keys);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+int_key_size (const file_entry_t *fentry)
+{
+    return SIGNED_KEY (fentry->st.st_size);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+int_key_mtime (const file_entry_t *fentry)
+{
+    return SIGNED_KEY (fentry->st.st_mtime);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+int_key_atime (const file_entry_t *fentry)
+{
+    return SIGNED_KEY (fentry->st.st_atime);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+int_key_ctime (const file_entry_t *fentry)
+{
+    return SIGNED_KEY (fentry->st.st_ctime);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static guint64
+int_key_inode (const file_entry_t *fentry)
+{
+    return (guint64) fentry->st.st_ino;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get integer key for radix sort.
+ *
+ * @return function to get the key, NULL if entries are compared by the sort function only
+ */
+
+static dir_list_int_key_fn
+get_int_key (GCompareDataFunc sort)
+{
+    if (sort == (GCompareDataFunc) sort_size)
+        return int_key_size;
+    if (sort == (GCompareDataFunc) sort_time)
+        return int_key_mtime;
+    if (sort == (GCompareDataFunc) sort_atime)
+        return int_key_atime;
+    if (sort == (GCompareDataFunc) sort_ctime)
+        return int_key_ctime;
+    if (sort == (GCompareDataFunc) sort_inode)
+        return int_key_inode;
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort entries by integer key with radix sort. Entries with the same key are sorted by
+ * the sort function, then entries are grouped by type keeping the order inside groups.
+ * The result is the same as the sort function gives.
+ */
+
+static void
+sort_by_int_key (file_entry_t *entries, int count, file_entry_t **order,
+                 GCompareDataFunc sort, const dir_sort_options_t *sort_op,
+                 dir_list_int_key_fn int_key)
+{
+    dir_sort_item_t *items;
+    int i, j;
+
+    items = g_new (dir_sort_item_t, count);
+
+    for (i = 0; i < count; i++)
+    {
+        items[i].key = int_key (&entries[i]);
+        if (sort_op->reverse)
+            items[i].key = ~items[i].key;
+        items[i].data = &entries[i];
+    }
+
+    dir_sort_radix (items, (gsize) count);
+
+    for (i = 0; i < count; i++)
+        order[i] = (file_entry_t *) items[i].data;
+
+    for (i = 0; i < count; i = j)
+    {
+        for (j = i + 1; j < count && items[j].key == items[i].key; j++)
+            ;
+        if (j - i > 1)
+            dir_sort_merge ((gpointer *) (order + i), (gsize) (j - i), sort, (gpointer) sort_op);
+    }
 
-    if (DIR_IS_DOT (dp->d_name) || DIR_IS_DOTDOT (dp->d_name))
+    if (!panels_options.mix_all_files)
+    {
+        /* directories first, then executables, then other files */
+        for (i = 0; i < count; i++)
+        {
+            items[i].key = (guint64) (2 - MY_ISDIR (order[i], sort_op));
+            items[i].data = order[i];
+        }
+
+        dir_sort_radix (items, (gsize) count);
+
+        for (i = 0; i < count; i++)
+            order[i] = (file_entry_t *) items[i].data;
+    }
+
+    g_free (items);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move entries to sorted order. Each entry is moved once.
+ *
+ * @param entries entries to move
+ * @param count number of entries
+ * @param order pointers to entries in sorted order, it is destroyed
+ */
+
+static void
+apply_sort_order (file_entry_t *entries, int count, file_entry_t **order)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        file_entry_t tmp;
+        int j, k;
+
+        /* follow the cycle of the permutation starting at i unless it is moved already */
+        if (order[i] == NULL)
+            continue;
+
+        tmp = entries[i];
+
+        for (j = i; (k = (int) (order[j] - entries)) != i; j = k)
+        {
+            entries[j] = entries[k];
+            order[j] = NULL;
+        }
+
+        entries[j] = tmp;
+        order[j] = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check the name of directory entry against panel options.
+ *
+ * @return FALSE = don't add, TRUE = check the entry further
+ */
+
+static gboolean
+handle_dirent_name (const char *name, size_t len)
+{
+    if (DIR_IS_DOT (name) || DIR_IS_DOTDOT (name))
         return FALSE;
-    if (!panels_options.show_dot_files && (dp->d_name[0] == '.'))
+    if (!panels_options.show_dot_files && (name[0] == '.'))
         return FALSE;
-    if (!panels_options.show_backups && dp->d_name[dp->d_len - 1] == '~')
+    if (!panels_options.show_backups && name[len - 1] == '~')
         return FALSE;
 
-    vpath = vfs_path_from_str (dp->d_name);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check the stat'ed directory entry against the filter.
+ *
+ * @return FALSE = don't add, TRUE = add to the list
+ */
+
+static gboolean
+handle_dirent_filter (const file_filter_t *filter, const char *name, size_t len,
+                      const mc_stat_t *buf1, gboolean link_to_dir)
+{
+    gboolean files_only;
+
+    if (filter == NULL || filter->handler == NULL)
+        return TRUE;
+
+    files_only = (filter->flags & SELECT_FILES_ONLY) != 0;
+
+    return ((S_ISDIR (buf1->st_mode) || link_to_dir) && files_only)
+        || mc_search_run (filter->handler, name, 0, len, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get status of directory entry through VFS.
+ * If you change handle_dirent_stat then check also handle_path and dir_stat_run().
+ */
+
+static void
+handle_dirent_stat (const vfs_path_t *dir_vpath, const char *name, mc_stat_t *buf1,
+                    gboolean *link_to_dir, gboolean *stale_link)
+{
+    vfs_path_t *vpath;
+
+    /* directory loaded step by step may be not the current one */
+    vpath = vfs_path_append_new (dir_vpath, name, (char *) NULL);
     if (mc_lstat (vpath, buf1) == -1)
     {
         /*
@@ -173,23 +478,113 @@ handle_dirent (struct vfs_dirent *dp, const file_filter_t *filter, mc_stat_t *bu
         memset (buf1, 0, sizeof (*buf1));
     }
 
-    if (S_ISDIR (buf1->st_mode))
-        tree_store_mark_checked (dp->d_name);
-
     /* A link to a file or a directory? */
     *link_to_dir = file_is_symlink_to_dir (vpath, buf1, stale_link);
 
     vfs_path_free (vpath, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append next entries of directory to the list.
+ *
+ * Entries of local directory are stat'ed at once by worker threads after names are read,
+ * other ones are stat'ed one by one through VFS. Then entries are checked against the filter.
+ *
+ * @param max maximum number of names to read
+ */
+
+static void
+dir_list_loader_read (dir_list_loader_t *loader, int max)
+{
+    dir_list *list = loader->list;
+    const int start = list->len;
+    struct vfs_dirent *dp = NULL;
+    mc_stat_t st;
+    int i, j;
+
+    /* status of local entries is got below */
+    memset (&st, 0, sizeof (st));
 
-    if (filter != NULL && filter->handler != NULL)
+    for (i = 0; i < max && (dp = mc_readdir (loader->dirp)) != NULL; i++)
     {
-        gboolean files_only = (filter->flags & SELECT_FILES_ONLY) != 0;
+        gboolean link_to_dir = FALSE, stale_link = FALSE;
 
-        ok = ((S_ISDIR (buf1->st_mode) || *link_to_dir) && files_only)
-            || mc_search_run (filter->handler, dp->d_name, 0, dp->d_len, NULL);
+        if (list->callback != NULL)
+            list->callback (DIR_READ, dp);
+
+        if (!handle_dirent_name (dp->d_name, dp->d_len))
+            continue;
+
+#ifdef ENABLE_DIR_STAT
+        if (loader->ds == NULL)
+#endif
+            handle_dirent_stat (loader->vpath, dp->d_name, &st, &link_to_dir, &stale_link);
+
+        if (!dir_list_append (list, dp->d_name, &st, link_to_dir, stale_link))
+        {
+            loader->error = TRUE;
+            break;
+        }
     }
 
-    return ok;
+    if (dp == NULL)
+        loader->finished = TRUE;
+
+#ifdef ENABLE_DIR_STAT
+    if (loader->ds != NULL)
+        dir_stat_run (loader->ds, &list->list[start], list->len - start);
+#endif
+
+    for (i = j = start; i < list->len; i++)
+    {
+        file_entry_t *fentry = &list->list[i];
+
+        if (S_ISDIR (fentry->st.st_mode))
+            g_ptr_array_add (loader->dirs, g_strndup (fentry->fname->str, fentry->fname->len));
+
+        if (!handle_dirent_filter (loader->filter, fentry->fname->str, fentry->fname->len,
+                                   &fentry->st, fentry->f.link_to_dir != 0))
+            continue;           /* name stays in the storage until the list is cleaned */
+
+        if (j != i)
+            list->list[j] = *fentry;
+        j++;
+    }
+
+    list->len = j;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open directory to load. ".." entry (if any) must be added to the list by caller already.
+ *
+ * @return new loader, NULL if directory cannot be opened
+ */
+
+static dir_list_loader_t *
+dir_list_loader_open (dir_list *list, const vfs_path_t *vpath, const file_filter_t *filter)
+{
+    dir_list_loader_t *loader;
+    DIR *dirp;
+
+    if (list->callback != NULL)
+        list->callback (DIR_OPEN, (void *) vpath);
+    dirp = mc_opendir (vpath);
+    if (dirp == NULL)
+        return NULL;
+
+    loader = g_new0 (dir_list_loader_t, 1);
+    loader->list = list;
+    loader->vpath = vfs_path_clone (vpath);
+    loader->filter = filter;
+    loader->dirp = dirp;
+#ifdef ENABLE_DIR_STAT
+    loader->ds = dir_stat_open (vpath);
+#endif
+    loader->dirs = g_ptr_array_new_with_free_func (g_free);
+
+    return loader;
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -219,19 +614,101 @@ dir_get_dotdot_stat (const vfs_path_t *vpath, mc_stat_t *st)
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Move names to a new storage if most of stored names belong to removed entries.
+ */
+
+static void
+compact_entry_names (dir_list *list)
+{
+    dir_pool_t *names;
+    int i;
+
+    if (dir_pool_get_count (list->names) <= (gsize) list->len * 2 + DIR_LIST_MIN_SIZE)
+        return;
+
+    /* keys may refer to old names */
+    clean_sort_keys (list, 0, list->len);
+
+    names = dir_pool_new ();
+    for (i = 0; i < list->len; i++)
+    {
+        file_entry_t *fentry = &list->list[i];
+
+        fentry->fname = dir_pool_add (names, fentry->fname->str, fentry->fname->len);
+    }
+
+    dir_pool_free (list->names);
+    list->names = names;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move entries appended to the sorted list to their places.
+ *
+ * @param start index of the first appended entry
+ */
+
+static void
+insert_sorted (dir_list *list, int start, GCompareDataFunc sort, const dir_sort_options_t *sort_op)
+{
+    int first, i;
+
+    if (start >= list->len || sort == (GCompareDataFunc) unsorted)
+        return;
+
+    /* the list is almost sorted, so merge sort is fast on it */
+    if (list->len - start > DIR_LIST_INSERT_MAX)
+    {
+        dir_list_sort (list, sort, sort_op);
+        return;
+    }
+
+    if (sort != (GCompareDataFunc) sort_inode)
+        create_sort_keys (list, sort, sort_op);
+
+    first = DIR_IS_DOTDOT (list->list[0].fname->str) ? 1 : 0;
+
+    for (i = MAX (start, first); i < list->len; i++)
+    {
+        file_entry_t fentry = list->list[i];
+        int lo = first, hi = i;
+
+        /* insert after equal entries as stable sort does */
+        while (lo < hi)
+        {
+            const int mid = lo + (hi - lo) / 2;
+
+            if (sort (&fentry, &list->list[mid], (gpointer) sort_op) < 0)
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+
+        memmove (&list->list[lo + 1], &list->list[lo], (i - lo) * sizeof (file_entry_t));
+        list->list[lo] = fentry;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update the tree store with subdirectories in the list.
+ */
 
 static void
-alloc_dir_copy (int size)
+update_tree_store (const dir_list *list, const vfs_path_t *vpath)
 {
-    if (dir_copy.size < size)
+    int i;
+
+    tree_store_start_check (vpath);
+    for (i = 0; i < list->len; i++)
     {
-        if (dir_copy.list != NULL)
-            dir_list_free_list (&dir_copy);
+        const file_entry_t *fentry = &list->list[i];
 
-        dir_copy.list = g_new0 (file_entry_t, size);
-        dir_copy.size = size;
-        dir_copy.len = 0;
+        if (S_ISDIR (fentry->st.st_mode) && !DIR_IS_DOTDOT (fentry->fname->str))
+            tree_store_mark_checked (fentry->fname->str);
     }
+    tree_store_end_check ();
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -301,12 +778,13 @@ dir_list_append (dir_list *list, const char *fname, const mc_stat_t *st,
 {
     file_entry_t *fentry;
 
-    /* Need to grow the *list? */
-    if (list->len == list->size && !dir_list_grow (list, DIR_LIST_RESIZE_STEP))
+    /* Need to grow the *list? Grow it geometrically to not copy large list too often */
+    if (list->len == list->size
+        && !dir_list_grow (list, MAX (DIR_LIST_RESIZE_STEP, list->size / 2)))
         return FALSE;
 
     fentry = &list->list[list->len];
-    fentry->fname = g_string_new (fname);
+    fentry->fname = new_entry_name (list, fname);
     fentry->f.marked = 0;
     fentry->f.link_to_dir = link_to_dir ? 1 : 0;
     fentry->f.stale_link = stale_link ? 1 : 0;
@@ -323,10 +801,11 @@ dir_list_append (dir_list *list, const char *fname, const mc_stat_t *st,
 /* --------------------------------------------------------------------------------------------- */
 
 int
-unsorted (file_entry_t *a, file_entry_t *b)
+unsorted (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
     (void) a;
     (void) b;
+    (void) sort_op;
 
     return 0;
 }
@@ -334,13 +813,13 @@ unsorted (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_name (file_entry_t *a, file_entry_t *b)
+sort_name (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
 
     return bd - ad;
 }
@@ -348,10 +827,10 @@ sort_name (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_vers (file_entry_t *a, file_entry_t *b)
+sort_vers (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
@@ -359,9 +838,9 @@ sort_vers (file_entry_t *a, file_entry_t *b)
 
         result = filevercmp (a->fname->str, b->fname->str);
         if (result != 0)
-            return result * reverse;
+            return apply_reverse (result, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
@@ -370,25 +849,21 @@ sort_vers (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_ext (file_entry_t *a, file_entry_t *b)
+sort_ext (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
         int r;
 
-        if (a->extension_sort_key == NULL)
-            a->extension_sort_key = str_create_key (extension (a->fname->str), case_sensitive);
-        if (b->extension_sort_key == NULL)
-            b->extension_sort_key = str_create_key (extension (b->fname->str), case_sensitive);
-
-        r = str_key_collate (a->extension_sort_key, b->extension_sort_key, case_sensitive);
+        r = str_key_collate (a->extension_sort_key, b->extension_sort_key,
+                             sort_op->case_sensitive);
         if (r != 0)
-            return r * reverse;
+            return apply_reverse (r, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
@@ -397,19 +872,19 @@ sort_ext (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_time (file_entry_t *a, file_entry_t *b)
+sort_time (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
         int result = _GL_CMP (a->st.st_mtime, b->st.st_mtime);
 
         if (result != 0)
-            return result * reverse;
+            return apply_reverse (result, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
@@ -418,19 +893,19 @@ sort_time (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_ctime (file_entry_t *a, file_entry_t *b)
+sort_ctime (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
         int result = _GL_CMP (a->st.st_ctime, b->st.st_ctime);
 
         if (result != 0)
-            return result * reverse;
+            return apply_reverse (result, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
@@ -439,19 +914,19 @@ sort_ctime (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_atime (file_entry_t *a, file_entry_t *b)
+sort_atime (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
         int result = _GL_CMP (a->st.st_atime, b->st.st_atime);
 
         if (result != 0)
-            return result * reverse;
+            return apply_reverse (result, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
@@ -460,13 +935,13 @@ sort_atime (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_inode (file_entry_t *a, file_entry_t *b)
+sort_inode (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
-        return (a->st.st_ino - b->st.st_ino) * reverse;
+        return apply_reverse (_GL_CMP (a->st.st_ino, b->st.st_ino), sort_op);
 
     return bd - ad;
 }
@@ -474,45 +949,71 @@ sort_inode (file_entry_t *a, file_entry_t *b)
 /* --------------------------------------------------------------------------------------------- */
 
 int
-sort_size (file_entry_t *a, file_entry_t *b)
+sort_size (const file_entry_t *a, const file_entry_t *b, const dir_sort_options_t *sort_op)
 {
-    int ad = MY_ISDIR (a);
-    int bd = MY_ISDIR (b);
+    int ad = MY_ISDIR (a, sort_op);
+    int bd = MY_ISDIR (b, sort_op);
 
     if (ad == bd || panels_options.mix_all_files)
     {
         int result = _GL_CMP (a->st.st_size, b->st.st_size);
 
         if (result != 0)
-            return result * reverse;
+            return apply_reverse (result, sort_op);
 
-        return compare_by_names (a, b);
+        return compare_by_names (a, b, sort_op);
     }
 
     return bd - ad;
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort directory list. Entries are not moved while being sorted: pointers to them are sorted
+ * by several threads, or by radix sort if entries are compared by integer, and then entries
+ * are moved to their places at once.
+ *
+ * @param list directory list
+ * @param sort sort function, called by several threads at once
+ * @param sort_op sort options
+ */
 
 void
-dir_list_sort (dir_list *list, GCompareFunc sort, const dir_sort_options_t *sort_op)
+dir_list_sort (dir_list *list, GCompareDataFunc sort, const dir_sort_options_t *sort_op)
 {
-    if (list->len > 1 && sort != (GCompareFunc) unsorted)
-    {
-        file_entry_t *fentry = &list->list[0];
-        int dot_dot_found;
+    file_entry_t *entries;
+    file_entry_t **order;
+    dir_list_int_key_fn int_key;
+    int dot_dot_found, count, i;
+
+    if (list->len < 2 || sort == (GCompareDataFunc) unsorted)
+        return;
+
+    /* If there is an ".." entry the caller must take care to
+       ensure that it occupies the first list element. */
+    dot_dot_found = DIR_IS_DOTDOT (list->list[0].fname->str) ? 1 : 0;
+    entries = &list->list[dot_dot_found];
+    count = list->len - dot_dot_found;
+
+    /* inodes are never equal enough to compare names */
+    if (sort != (GCompareDataFunc) sort_inode)
+        create_sort_keys (list, sort, sort_op);
+
+    order = g_new (file_entry_t *, count);
 
-        /* If there is an ".." entry the caller must take care to
-           ensure that it occupies the first list element. */
-        dot_dot_found = DIR_IS_DOTDOT (fentry->fname->str) ? 1 : 0;
-        reverse = sort_op->reverse ? -1 : 1;
-        case_sensitive = sort_op->case_sensitive ? 1 : 0;
-        exec_first = sort_op->exec_first;
-        qsort (&(list->list)[dot_dot_found], list->len - dot_dot_found, sizeof (file_entry_t),
-               sort);
+    int_key = get_int_key (sort);
+    if (int_key != NULL)
+        sort_by_int_key (entries, count, order, sort, sort_op, int_key);
+    else
+    {
+        for (i = 0; i < count; i++)
+            order[i] = &entries[i];
 
-        clean_sort_keys (list, dot_dot_found, list->len - dot_dot_found);
+        dir_sort_merge ((gpointer *) order, (gsize) count, sort, (gpointer) sort_op);
     }
+
+    apply_sort_order (entries, count, order);
+    g_free (order);
 }
 
 /* --------------------------------------------------------------------------------------------- */
@@ -520,18 +1021,8 @@ dir_list_sort (dir_list *list, GCompareFunc sort, const dir_sort_options_t *sort
 void
 dir_list_clean (dir_list *list)
 {
-    int i;
-
-    for (i = 0; i < list->len; i++)
-    {
-        file_entry_t *fentry;
-
-        fentry = &list->list[i];
-        g_string_free (fentry->fname, TRUE);
-        fentry->fname = NULL;
-    }
+    clean_entries (list);
 
-    list->len = 0;
     /* reduce memory usage */
     dir_list_grow (list, DIR_LIST_MIN_SIZE - list->size);
 }
@@ -541,21 +1032,33 @@ dir_list_clean (dir_list *list)
 void
 dir_list_free_list (dir_list *list)
 {
-    int i;
-
-    for (i = 0; i < list->len; i++)
-    {
-        file_entry_t *fentry;
+    clean_sort_keys (list, 0, list->len);
 
-        fentry = &list->list[i];
-        g_string_free (fentry->fname, TRUE);
-    }
+    /* all names are released at once */
+    dir_pool_free (list->names);
+    list->names = NULL;
 
     MC_PTR_FREE (list->list);
     list->len = 0;
     list->size = 0;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Free sort keys of the entry before it is removed from the list. The name is released
+ * with all other names when the list is cleaned.
+ *
+ * @param list directory list
+ * @param index index of the entry
+ */
+
+void
+dir_list_free_entry (dir_list *list, int index)
+{
+    clean_sort_keys (list, index, 1);
+    list->list[index].fname = NULL;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /** Used to set up a directory list when there is no access to a directory */
 
@@ -573,7 +1076,7 @@ dir_list_init (dir_list *list)
 
     fentry = &list->list[0];
     memset (fentry, 0, sizeof (*fentry));
-    fentry->fname = g_string_new ("..");
+    fentry->fname = new_entry_name (list, "..");
     fentry->f.link_to_dir = 0;
     fentry->f.stale_link = 0;
     fentry->f.dir_size_computed = 0;
@@ -585,11 +1088,11 @@ dir_list_init (dir_list *list)
 
 /* --------------------------------------------------------------------------------------------- */
 /**
-   handle_path is a simplified handle_dirent. The difference is that
+   handle_path is a simplified handle_dirent_stat. The difference is that
    handle_path doesn't pay attention to panels_options.show_dot_files
    and panels_options.show_backups.
    Moreover handle_path can't be used with a filemask.
-   If you change handle_path then check also handle_dirent. */
+   If you change handle_path then check also handle_dirent_stat. */
 /* Return values: FALSE = don't add, TRUE = add to the list */
 
 gboolean
@@ -629,61 +1132,135 @@ handle_path (const char *path, mc_stat_t *buf1, gboolean *link_to_dir, gboolean
 }
 
 /* --------------------------------------------------------------------------------------------- */
+/**
+ * Start loading of directory. The list is cleaned and ".." entry is added to it except
+ * to the root directory. Entries are appended to the list by dir_list_loader_step().
+ *
+ * @param list directory list
+ * @param vpath directory path
+ * @param filter file name filter, it must live until the loader is freed
+ *
+ * @return new loader, NULL if directory cannot be opened
+ */
 
-gboolean
-dir_list_load (dir_list *list, const vfs_path_t *vpath, GCompareFunc sort,
-               const dir_sort_options_t *sort_op, const file_filter_t *filter)
+dir_list_loader_t *
+dir_list_loader_new (dir_list *list, const vfs_path_t *vpath, const file_filter_t *filter)
 {
-    DIR *dirp;
-    struct vfs_dirent *dp;
+    dir_list_loader_t *loader;
     mc_stat_t st;
-    file_entry_t *fentry;
     const char *vpath_str;
-    gboolean ret = TRUE;
 
     /* ".." (if any) must be the first entry in the list */
     if (!dir_list_init (list))
-        return FALSE;
+        return NULL;
 
-    fentry = &list->list[0];
     if (dir_get_dotdot_stat (vpath, &st))
-        fentry->st = st;
-
-    if (list->callback != NULL)
-        list->callback (DIR_OPEN, (void *) vpath);
-    dirp = mc_opendir (vpath);
-    if (dirp == NULL)
-        return FALSE;
+        list->list[0].st = st;
 
-    tree_store_start_check (vpath);
+    loader = dir_list_loader_open (list, vpath, filter);
+    if (loader == NULL)
+        return NULL;
 
     vpath_str = vfs_path_as_str (vpath);
     /* Do not add a ".." entry to the root directory */
     if (IS_PATH_SEP (vpath_str[0]) && vpath_str[1] == '\0')
         dir_list_clean (list);
 
-    while (ret && (dp = mc_readdir (dirp)) != NULL)
+    return loader;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Append next entries of directory to the list. Appended entries are not sorted.
+ *
+ * @param timeout how long to read in microseconds, -1 to read the whole directory
+ *
+ * @return TRUE if loading is finished, FALSE if there are more entries to read
+ */
+
+gboolean
+dir_list_loader_step (dir_list_loader_t *loader, gint64 timeout)
+{
+    const gint64 end_time = g_get_monotonic_time () + timeout;
+    int max;
+
+    max = timeout < 0 ? DIR_LIST_LOAD_BATCH : DIR_LIST_LOAD_STEP_BATCH;
+#ifdef ENABLE_DIR_STAT
+    /* smaller batch would be stat'ed by one thread */
+    if (loader->ds != NULL)
+        max = MAX (max, DIR_STAT_RUN_FULL);
+#endif
+
+    while (!loader->finished && !loader->error)
     {
-        gboolean link_to_dir, stale_link;
+        dir_list_loader_read (loader, max);
 
-        if (list->callback != NULL)
-            list->callback (DIR_READ, dp);
+        if (timeout >= 0 && g_get_monotonic_time () >= end_time)
+            break;
+    }
 
-        if (!handle_dirent (dp, filter, &st, &link_to_dir, &stale_link))
-            continue;
+    return loader->finished || loader->error;
+}
 
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir, stale_link))
-            ret = FALSE;
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop loading and free the loader. If the whole directory was read, the tree store is updated
+ * with its subdirectories.
+ *
+ * @return TRUE if the whole directory was read successfully, FALSE otherwise
+ */
+
+gboolean
+dir_list_loader_free (dir_list_loader_t *loader)
+{
+    gboolean ret;
+
+    ret = loader->finished && !loader->error;
+
+    if (loader->list->callback != NULL)
+        loader->list->callback (DIR_CLOSE, NULL);
+    mc_closedir (loader->dirp);
+#ifdef ENABLE_DIR_STAT
+    dir_stat_close (loader->ds);
+#endif
+
+    /* tree store checks one directory at a time, so it is updated when loading is finished */
+    if (ret)
+    {
+        guint i;
+
+        tree_store_start_check (loader->vpath);
+        for (i = 0; i < loader->dirs->len; i++)
+            tree_store_mark_checked ((const char *) g_ptr_array_index (loader->dirs, i));
+        tree_store_end_check ();
     }
 
+    g_ptr_array_free (loader->dirs, TRUE);
+    vfs_path_free (loader->vpath, TRUE);
+    g_free (loader);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+dir_list_load (dir_list *list, const vfs_path_t *vpath, GCompareDataFunc sort,
+               const dir_sort_options_t *sort_op, const file_filter_t *filter)
+{
+    dir_list_loader_t *loader;
+    gboolean ret;
+
+    loader = dir_list_loader_new (list, vpath, filter);
+    if (loader == NULL)
+        return FALSE;
+
+    dir_list_loader_step (loader, -1);
+    ret = dir_list_loader_free (loader);
+
     if (ret)
         dir_list_sort (list, sort, sort_op);
 
-    if (list->callback != NULL)
-        list->callback (DIR_CLOSE, NULL);
-    mc_closedir (dirp);
-    tree_store_end_check ();
-
     return ret;
 }
 
@@ -704,71 +1281,52 @@ if_link_is_exe (const vfs_path_t *full_name_vpath, const file_entry_t *file)
 /** If filter is null, then it is a match */
 
 gboolean
-dir_list_reload (dir_list *list, const vfs_path_t *vpath, GCompareFunc sort,
+dir_list_reload (dir_list *list, const vfs_path_t *vpath, GCompareDataFunc sort,
                  const dir_sort_options_t *sort_op, const file_filter_t *filter)
 {
-    DIR *dirp;
-    struct vfs_dirent *dp;
-    int i;
+    dir_list_loader_t *loader;
+    int i, start;
     mc_stat_t st;
     int marked_cnt;
     GHashTable *marked_files;
     const char *tmp_path;
-    gboolean ret = TRUE;
+    gboolean ret;
 
-    if (list->callback != NULL)
-        list->callback (DIR_OPEN, (void *) vpath);
-    dirp = mc_opendir (vpath);
-    if (dirp == NULL)
+    loader = dir_list_loader_open (list, vpath, filter);
+    if (loader == NULL)
     {
         dir_list_clean (list);
         dir_list_init (list);
         return FALSE;
     }
 
-    tree_store_start_check (vpath);
-
-    marked_files = g_hash_table_new (g_str_hash, g_str_equal);
-    alloc_dir_copy (list->len);
+    /* only names of marked files are needed to restore marks */
+    marked_files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
     for (marked_cnt = i = 0; i < list->len; i++)
     {
-        file_entry_t *fentry, *dfentry;
+        file_entry_t *fentry;
 
         fentry = &list->list[i];
-        dfentry = &dir_copy.list[i];
-
-        dfentry->fname = mc_g_string_dup (fentry->fname);
-        dfentry->f.marked = fentry->f.marked;
-        dfentry->f.dir_size_computed = fentry->f.dir_size_computed;
-        dfentry->f.link_to_dir = fentry->f.link_to_dir;
-        dfentry->f.stale_link = fentry->f.stale_link;
-        dfentry->name_sort_key = NULL;
-        dfentry->extension_sort_key = NULL;
         if (fentry->f.marked != 0)
         {
-            g_hash_table_insert (marked_files, dfentry->fname->str, dfentry);
+            g_hash_table_add (marked_files, g_strndup (fentry->fname->str, fentry->fname->len));
             marked_cnt++;
         }
     }
 
-    /* save len for later dir_list_clean() */
-    dir_copy.len = list->len;
+    /* keep allocated entries and storage of names for new entries */
+    clean_entries (list);
 
     /* Add ".." except to the root directory. The ".." entry
        (if any) must be the first in the list. */
     tmp_path = vfs_path_get_by_index (vpath, 0)->path;
-    if (vfs_path_elements_count (vpath) == 1 && IS_PATH_SEP (tmp_path[0]) && tmp_path[1] == '\0')
-    {
-        /* root directory */
-        dir_list_clean (list);
-    }
-    else
+    if (vfs_path_elements_count (vpath) != 1 || !IS_PATH_SEP (tmp_path[0])
+        || tmp_path[1] != '\0')
     {
-        dir_list_clean (list);
         if (!dir_list_init (list))
         {
-            dir_list_free_list (&dir_copy);
-            mc_closedir (dirp);
+            g_hash_table_destroy (marked_files);
+            dir_list_loader_free (loader);
             return FALSE;
         }
 
@@ -781,46 +1339,134 @@ dir_list_reload (dir_list *list, const vfs_path_t *vpath, GCompareFunc sort,
         }
     }
 
-    while (ret && (dp = mc_readdir (dirp)) != NULL)
+    start = list->len;
+
+    dir_list_loader_step (loader, -1);
+    ret = dir_list_loader_free (loader);
+
+    /*
+     * Mark files which were marked before reload.  Decrease number
+     * of remaining marks if we found one.
+     */
+    for (i = start; i < list->len && marked_cnt > 0; i++)
     {
-        gboolean link_to_dir, stale_link;
+        file_entry_t *fentry;
 
-        if (list->callback != NULL)
-            list->callback (DIR_READ, dp);
+        fentry = &list->list[i];
+        fentry->f.marked = g_hash_table_contains (marked_files, fentry->fname->str) ? 1 : 0;
+        if (fentry->f.marked != 0)
+            marked_cnt--;
+    }
 
-        if (!handle_dirent (dp, filter, &st, &link_to_dir, &stale_link))
-            continue;
+    if (ret)
+        dir_list_sort (list, sort, sort_op);
 
-        if (!dir_list_append (list, dp->d_name, &st, link_to_dir, stale_link))
-            ret = FALSE;
-        else
-        {
-            file_entry_t *fentry;
+    g_hash_table_destroy (marked_files);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Update the list with changed entries of the directory instead of reloading it. Changed
+ * entries are stat'ed again: removed ones are removed from the list, new and changed ones are
+ * inserted to their places. Marks of entries are kept.
+ *
+ * @param list directory list sorted with @sort
+ * @param vpath directory path
+ * @param names set of changed names
+ * @param sort sort function
+ * @param sort_op sort options
+ * @param filter file name filter
+ *
+ * @return FALSE if the list cannot grow, the directory should be reloaded then
+ */
+
+gboolean
+dir_list_update (dir_list *list, const vfs_path_t *vpath, GHashTable *names,
+                 GCompareDataFunc sort, const dir_sort_options_t *sort_op,
+                 const file_filter_t *filter)
+{
+    GHashTable *marked_files;
+    GHashTableIter iter;
+    gpointer key;
+    guint64 lengths = 0;
+    gboolean dirs_changed = FALSE;
+    gboolean ret = TRUE;
+    int i, j, start;
+
+    if (g_hash_table_size (names) == 0)
+        return TRUE;
 
-            fentry = &list->list[list->len - 1];
+    /* most of entries are not changed, skip them without hashing of names */
+    g_hash_table_iter_init (&iter, names);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+        lengths |= G_GUINT64_CONSTANT (1) << (strlen ((const char *) key) % 64);
 
-            /*
-             * If we have marked files in the copy, scan through the copy
-             * to find matching file.  Decrease number of remaining marks if
-             * we copied one.
-             */
-            fentry->f.marked = (marked_cnt > 0
-                                && g_hash_table_lookup (marked_files, dp->d_name) != NULL) ? 1 : 0;
+    /* remove changed entries, existing ones are added again */
+    marked_files = g_hash_table_new (g_str_hash, g_str_equal);
+    for (i = j = 0; i < list->len; i++)
+    {
+        file_entry_t *fentry = &list->list[i];
+
+        if ((lengths & (G_GUINT64_CONSTANT (1) << (fentry->fname->len % 64))) != 0
+            && g_hash_table_lookup_extended (names, fentry->fname->str, &key, NULL))
+        {
             if (fentry->f.marked != 0)
-                marked_cnt--;
+                g_hash_table_add (marked_files, key);
+            if (S_ISDIR (fentry->st.st_mode))
+                dirs_changed = TRUE;
+            dir_list_free_entry (list, i);
+            continue;
         }
+
+        if (j != i)
+            list->list[j] = *fentry;
+        j++;
     }
 
-    if (ret)
-        dir_list_sort (list, sort, sort_op);
+    list->len = start = j;
 
-    if (list->callback != NULL)
-        list->callback (DIR_CLOSE, NULL);
-    mc_closedir (dirp);
-    tree_store_end_check ();
+    g_hash_table_iter_init (&iter, names);
+    while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+        const char *name = (const char *) key;
+        const size_t len = strlen (name);
+        gboolean link_to_dir, stale_link;
+        mc_stat_t st;
+
+        if (!handle_dirent_name (name, len))
+            continue;
+
+        handle_dirent_stat (vpath, name, &st, &link_to_dir, &stale_link);
+        /* entry is removed */
+        if (st.st_mode == 0)
+            continue;
+
+        if (S_ISDIR (st.st_mode))
+            dirs_changed = TRUE;
+
+        if (!handle_dirent_filter (filter, name, len, &st, link_to_dir))
+            continue;
+
+        if (!dir_list_append (list, name, &st, link_to_dir, stale_link))
+        {
+            ret = FALSE;
+            break;
+        }
+
+        list->list[list->len - 1].f.marked = g_hash_table_contains (marked_files, name) ? 1 : 0;
+    }
 
     g_hash_table_destroy (marked_files);
-    dir_list_free_list (&dir_copy);
+
+    compact_entry_names (list);
+    insert_sorted (list, start, sort, sort_op);
+
+    /* directories hidden by filter must not be removed from the tree store */
+    if (dirs_changed
+        && (filter == NULL || filter->handler == NULL || (filter->flags & SELECT_FILES_ONLY) != 0))
+        update_tree_store (list, vpath);
 
     return ret;
 }
@@ -12,6 +12,8 @@
 #include "lib/file-entry.h"
 #include "lib/vfs/vfs.h"
 
+#include "dirpool.h"
+
 /*** typedefs(not structures) and defined constants **********************************************/
 
 #define DIR_LIST_MIN_SIZE 128
@@ -50,6 +52,8 @@ typedef struct
     int size;           /**< number of allocated elements in list (capacity) */
     int len;            /**< number of used elements in list */
     dir_list_cb_fn callback;    /**< callback to visualize of directory read */
+    gboolean keys_case_sensitive;       /**< sort keys of entries are case sensitive */
+    dir_pool_t *names;  /**< storage of names of entries */
 } dir_list;
 
 /**
@@ -70,6 +74,9 @@ typedef struct
     select_flags_t flags;
 } file_filter_t;
 
+/* Directory which is being loaded step by step */
+typedef struct dir_list_loader_t dir_list_loader_t;
+
 /*** global variables defined in .c file *********************************************************/
 
 /*** declarations of public functions ************************************************************/
@@ -78,27 +85,35 @@ gboolean dir_list_grow (dir_list * list, int delta);
 gboolean dir_list_append (dir_list * list, const char *fname, const mc_stat_t *st,
                           gboolean link_to_dir, gboolean stale_link);
 
-gboolean dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
+gboolean dir_list_load (dir_list * list, const vfs_path_t * vpath, GCompareDataFunc sort,
                         const dir_sort_options_t * sort_op, const file_filter_t * filter);
-gboolean dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareFunc sort,
+gboolean dir_list_reload (dir_list * list, const vfs_path_t * vpath, GCompareDataFunc sort,
                           const dir_sort_options_t * sort_op, const file_filter_t * filter);
-void dir_list_sort (dir_list * list, GCompareFunc sort, const dir_sort_options_t * sort_op);
+gboolean dir_list_update (dir_list * list, const vfs_path_t * vpath, GHashTable * names,
+                          GCompareDataFunc sort, const dir_sort_options_t * sort_op,
+                          const file_filter_t * filter);
+dir_list_loader_t *dir_list_loader_new (dir_list * list, const vfs_path_t * vpath,
+                                        const file_filter_t * filter);
+gboolean dir_list_loader_step (dir_list_loader_t * loader, gint64 timeout);
+gboolean dir_list_loader_free (dir_list_loader_t * loader);
+void dir_list_sort (dir_list * list, GCompareDataFunc sort, const dir_sort_options_t * sort_op);
 gboolean dir_list_init (dir_list * list);
 void dir_list_clean (dir_list * list);
 void dir_list_free_list (dir_list * list);
+void dir_list_free_entry (dir_list * list, int index);
 gboolean handle_path (const char *path, mc_stat_t *buf1, gboolean * link_to_dir,
                       gboolean * stale_link);
 
-/* Sorting functions */
-int unsorted (file_entry_t * a, file_entry_t * b);
-int sort_name (file_entry_t * a, file_entry_t * b);
-int sort_vers (file_entry_t * a, file_entry_t * b);
-int sort_ext (file_entry_t * a, file_entry_t * b);
-int sort_time (file_entry_t * a, file_entry_t * b);
-int sort_atime (file_entry_t * a, file_entry_t * b);
-int sort_ctime (file_entry_t * a, file_entry_t * b);
-int sort_size (file_entry_t * a, file_entry_t * b);
-int sort_inode (file_entry_t * a, file_entry_t * b);
+/* Sorting functions, they compare sort keys created by dir_list_sort() */
+int unsorted (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_name (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_vers (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_ext (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_time (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_atime (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_ctime (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_size (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
+int sort_inode (const file_entry_t * a, const file_entry_t * b, const dir_sort_options_t * sort_op);
 
 gboolean if_link_is_exe (const vfs_path_t * full_name, const file_entry_t * file);
 
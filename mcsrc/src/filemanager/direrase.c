@@ -0,0 +1,386 @@
+/*
+   Removal of local directory tree by worker threads.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  direrase.c
+ *  \brief Source: removal of local directory tree by worker threads
+ *
+ *  Files are removed with unlinkat() relative to the open directory, so the kernel doesn't
+ *  resolve the full path for each entry. Subdirectories are passed to other threads while
+ *  there are idle ones, otherwise they are put on the stack of the current thread, so deep
+ *  trees don't deepen the call stack. A directory is removed when its own scan and all its
+ *  subdirectories are finished.
+ *
+ *  A directory is closed as soon as it is read, so each thread keeps only one directory open
+ *  however deep the tree is. Subdirectories are opened by their paths later, and a directory
+ *  which was replaced since it was read is left in place.
+ *
+ *  Errors are not reported: entries which cannot be removed are left in place, and the
+ *  caller removes the rest of the tree in the usual way to ask user what to do. The top
+ *  directory itself is not removed.
+ *
+ *  VFS is not thread-safe, so worker threads use only plain system calls on local files.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "direrase.h"
+
+#ifdef ENABLE_DIR_ERASE
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIR_ERASE_MAX_WORKERS 8
+/* Subdirectories are queued to threads while queue is shorter than this per thread */
+#define DIR_ERASE_JOBS_PER_WORKER 4
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+/* Directory which is being removed */
+typedef struct dir_erase_node_t
+{
+    struct dir_erase_node_t *parent;
+    char *path;
+    /* identity of the directory when its parent was read */
+    dev_t dev;
+    ino_t ino;
+    /* own scan and subdirectories which are not removed yet */
+    gint pending;
+} dir_erase_node_t;
+
+struct dir_erase_t
+{
+    GThreadPool *threads;
+    int max_queued;
+    gint queued;
+    gint cancelled;
+    /* number of removed entries */
+    gint removed;
+
+    dir_erase_node_t *root;
+
+    GMutex lock;
+    GCond cond;
+    gboolean finished;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static dir_erase_node_t *
+dir_erase_node_new (dir_erase_node_t *parent, char *path, const struct stat *st)
+{
+    dir_erase_node_t *node;
+
+    node = g_new (dir_erase_node_t, 1);
+    node->parent = parent;
+    node->path = path;
+    node->dev = st->st_dev;
+    node->ino = st->st_ino;
+    node->pending = 1;
+
+    if (parent != NULL)
+        g_atomic_int_inc (&parent->pending);
+
+    return node;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Finish one job of the directory. Remove the directory after the last one and finish
+ * the job of its parent then.
+ */
+
+static void
+dir_erase_node_release (dir_erase_t *erase, dir_erase_node_t *node)
+{
+    while (node != NULL && g_atomic_int_dec_and_test (&node->pending))
+    {
+        dir_erase_node_t *parent = node->parent;
+
+        if (parent == NULL)
+        {
+            /* the top directory is kept */
+            g_mutex_lock (&erase->lock);
+            erase->finished = TRUE;
+            g_cond_signal (&erase->cond);
+            g_mutex_unlock (&erase->lock);
+            return;
+        }
+
+        if (rmdir (node->path) == 0)
+            g_atomic_int_inc (&erase->removed);
+
+        g_free (node->path);
+        g_free (node);
+        node = parent;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open directory and check that it is the one which was found in its parent.
+ *
+ * @return directory descriptor, -1 if directory cannot be opened or was replaced
+ */
+
+static int
+dir_erase_node_open (const dir_erase_node_t *node)
+{
+    struct stat st;
+    int fd;
+
+    fd = open (node->path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (fstat (fd, &st) != 0 || st.st_dev != node->dev || st.st_ino != node->ino)
+    {
+        close (fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove files of the directory. Its subdirectories are queued to other threads or put on
+ * the @stack of the current thread.
+ */
+
+static void
+dir_erase_scan (dir_erase_t *erase, dir_erase_node_t *node, GPtrArray *stack)
+{
+    DIR *dir;
+    struct dirent *de;
+    int fd;
+
+    fd = dir_erase_node_open (node);
+    if (fd < 0)
+        return;
+
+    dir = fdopendir (fd);
+    if (dir == NULL)
+    {
+        close (fd);
+        return;
+    }
+
+    while (g_atomic_int_get (&erase->cancelled) == 0 && (de = readdir (dir)) != NULL)
+    {
+        struct stat st;
+        gboolean is_dir;
+        gboolean have_stat = FALSE;
+        dir_erase_node_t *child;
+
+        if (DIR_IS_DOT (de->d_name) || DIR_IS_DOTDOT (de->d_name))
+            continue;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+        if (de->d_type != DT_UNKNOWN)
+            is_dir = de->d_type == DT_DIR;
+        else
+#endif
+        {
+            have_stat = fstatat (fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0;
+            is_dir = have_stat && S_ISDIR (st.st_mode);
+        }
+
+        if (!is_dir)
+        {
+            if (unlinkat (fd, de->d_name, 0) == 0)
+                g_atomic_int_inc (&erase->removed);
+            continue;
+        }
+
+        /* identity of subdirectory to check it when it is opened */
+        if (!have_stat && (fstatat (fd, de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0
+                           || !S_ISDIR (st.st_mode)))
+            continue;
+
+        child = dir_erase_node_new (node, g_build_filename (node->path, de->d_name, (char *) NULL),
+                                    &st);
+
+        if (g_atomic_int_get (&erase->queued) < erase->max_queued)
+        {
+            g_atomic_int_inc (&erase->queued);
+            g_thread_pool_push (erase->threads, child, NULL);
+        }
+        else
+            g_ptr_array_add (stack, child);
+    }
+
+    closedir (dir);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_erase_worker (gpointer data, gpointer user_data)
+{
+    dir_erase_t *erase = (dir_erase_t *) user_data;
+    GPtrArray *stack;
+
+    g_atomic_int_add (&erase->queued, -1);
+
+    /* subdirectories which are not queued to other threads */
+    stack = g_ptr_array_new ();
+    g_ptr_array_add (stack, data);
+
+    while (stack->len != 0)
+    {
+        dir_erase_node_t *node;
+
+        node = (dir_erase_node_t *) g_ptr_array_index (stack, stack->len - 1);
+        g_ptr_array_set_size (stack, stack->len - 1);
+
+        /* directories are released without scan if removal is cancelled */
+        if (g_atomic_int_get (&erase->cancelled) == 0)
+            dir_erase_scan (erase, node, stack);
+        dir_erase_node_release (erase, node);
+    }
+
+    g_ptr_array_free (stack, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start removal of the content of local directory.
+ *
+ * @param path directory path
+ *
+ * @return new removal, NULL if directory cannot be opened or threads cannot be created
+ */
+
+dir_erase_t *
+dir_erase_start (const char *path)
+{
+    dir_erase_t *erase;
+    struct stat st;
+    int workers;
+
+    if (lstat (path, &st) != 0 || !S_ISDIR (st.st_mode))
+        return NULL;
+
+    workers = CLAMP ((int) g_get_num_processors (), 2, DIR_ERASE_MAX_WORKERS);
+
+    erase = g_new0 (dir_erase_t, 1);
+    erase->max_queued = workers * DIR_ERASE_JOBS_PER_WORKER;
+    g_mutex_init (&erase->lock);
+    g_cond_init (&erase->cond);
+    erase->root = dir_erase_node_new (NULL, g_strdup (path), &st);
+    erase->threads = g_thread_pool_new (dir_erase_worker, erase, workers, FALSE, NULL);
+    if (erase->threads == NULL)
+    {
+        erase->finished = TRUE;
+        dir_erase_free (erase);
+        return NULL;
+    }
+
+    /* the top directory is scanned by thread as well */
+    g_atomic_int_inc (&erase->queued);
+    g_thread_pool_push (erase->threads, erase->root, NULL);
+
+    return erase;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop removal and free it.
+ */
+
+void
+dir_erase_free (dir_erase_t *erase)
+{
+    if (erase == NULL)
+        return;
+
+    g_atomic_int_set (&erase->cancelled, 1);
+
+    /* queued directories are released without scan */
+    g_mutex_lock (&erase->lock);
+    while (!erase->finished)
+        g_cond_wait (&erase->cond, &erase->lock);
+    g_mutex_unlock (&erase->lock);
+
+    if (erase->threads != NULL)
+        g_thread_pool_free (erase->threads, FALSE, TRUE);
+
+    g_free (erase->root->path);
+    g_free (erase->root);
+    g_cond_clear (&erase->cond);
+    g_mutex_clear (&erase->lock);
+    g_free (erase);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for the removal no longer than timeout.
+ *
+ * @param timeout timeout in microseconds
+ * @param removed where the number of removed entries is stored
+ *
+ * @return TRUE if removal is finished, FALSE otherwise
+ */
+
+gboolean
+dir_erase_wait (dir_erase_t *erase, gint64 timeout, size_t *removed)
+{
+    const gint64 end_time = g_get_monotonic_time () + timeout;
+    gboolean finished;
+
+    g_mutex_lock (&erase->lock);
+    while (!erase->finished && g_cond_wait_until (&erase->cond, &erase->lock, end_time))
+        ;
+    finished = erase->finished;
+    g_mutex_unlock (&erase->lock);
+
+    *removed = (size_t) g_atomic_int_get (&erase->removed);
+
+    return finished;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_DIR_ERASE */
@@ -0,0 +1,34 @@
+/** \file  direrase.h
+ *  \brief Header: removal of local directory tree by worker threads
+ */
+
+#ifndef MC__DIRERASE_H
+#define MC__DIRERASE_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Worker threads use the POSIX file API directly bypassing VFS */
+#if !defined(WIN32) && defined(HAVE_FDOPENDIR) && defined(HAVE_UNLINKAT)
+#define ENABLE_DIR_ERASE 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_erase_t dir_erase_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_erase_t *dir_erase_start (const char *path);
+void dir_erase_free (dir_erase_t * erase);
+
+gboolean dir_erase_wait (dir_erase_t * erase, gint64 timeout, size_t * removed);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRERASE_H */
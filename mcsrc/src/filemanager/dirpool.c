@@ -0,0 +1,215 @@
+/*
+   Storage of names of directory entries.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirpool.c
+ *  \brief Source: storage of names of directory entries
+ *
+ *  A name allocated with g_string_new() takes two heap blocks, and the string buffer is
+ *  rounded up to a power of two. With millions of entries in a panel the allocator overhead
+ *  is larger than the names themselves, and freeing the list takes millions of calls.
+ *
+ *  Names of a directory list are packed one after another to large blocks instead. Each
+ *  name is stored as a GString header immediately followed by its text, so the rest of
+ *  the code reads entries as before. Such strings must never be changed or freed with
+ *  g_string_free(): the whole storage is released at once when the list is cleaned.
+ *  The largest block is kept for the next load of the list.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "lib/global.h"
+
+#include "dirpool.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIR_POOL_MIN_BLOCK (16 * 1024)
+#define DIR_POOL_MAX_BLOCK (4 * 1024 * 1024)
+
+#define DIR_POOL_ALIGN(x) (((x) + G_MEM_ALIGN - 1) & ~((gsize) G_MEM_ALIGN - 1))
+#define DIR_POOL_HEADER DIR_POOL_ALIGN (sizeof (dir_pool_block_t))
+
+/*** file scope type declarations ****************************************************************/
+
+typedef struct dir_pool_block_t
+{
+    struct dir_pool_block_t *next;
+    /* size of data following the header */
+    gsize size;
+} dir_pool_block_t;
+
+struct dir_pool_t
+{
+    /* the current block is the first one */
+    dir_pool_block_t *blocks;
+    /* free space of the current block */
+    char *free;
+    gsize left;
+    /* number of stored names */
+    gsize count;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_pool_use_block (dir_pool_t *pool, dir_pool_block_t *block)
+{
+    pool->blocks = block;
+    pool->free = (char *) block + DIR_POOL_HEADER;
+    pool->left = block->size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_pool_add_block (dir_pool_t *pool, gsize need)
+{
+    dir_pool_block_t *block;
+    gsize size;
+
+    /* blocks grow with the list, so large directories take a few blocks only */
+    size = pool->blocks == NULL ? DIR_POOL_MIN_BLOCK : MIN (pool->blocks->size * 2,
+                                                            DIR_POOL_MAX_BLOCK);
+    size = MAX (size, need);
+
+    block = (dir_pool_block_t *) g_malloc (DIR_POOL_HEADER + size);
+    block->next = pool->blocks;
+    block->size = size;
+
+    dir_pool_use_block (pool, block);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+dir_pool_t *
+dir_pool_new (void)
+{
+    return g_new0 (dir_pool_t, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_pool_free (dir_pool_t *pool)
+{
+    if (pool == NULL)
+        return;
+
+    while (pool->blocks != NULL)
+    {
+        dir_pool_block_t *next = pool->blocks->next;
+
+        g_free (pool->blocks);
+        pool->blocks = next;
+    }
+
+    g_free (pool);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Forget all stored names. The largest block is kept to store names again.
+ */
+
+void
+dir_pool_reset (dir_pool_t *pool)
+{
+    dir_pool_block_t *block;
+
+    if (pool == NULL || pool->blocks == NULL)
+        return;
+
+    /* the current block is the largest one */
+    block = pool->blocks->next;
+    while (block != NULL)
+    {
+        dir_pool_block_t *next = block->next;
+
+        g_free (block);
+        block = next;
+    }
+
+    pool->blocks->next = NULL;
+    dir_pool_use_block (pool, pool->blocks);
+    pool->count = 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Store a name.
+ *
+ * @param pool storage
+ * @param text name
+ * @param len length of name
+ *
+ * @return string which is valid until the storage is reset or freed, it must not be changed
+ */
+
+GString *
+dir_pool_add (dir_pool_t *pool, const char *text, gsize len)
+{
+    const gsize need = DIR_POOL_ALIGN (sizeof (GString) + len + 1);
+    GString *s;
+
+    if (need > pool->left)
+        dir_pool_add_block (pool, need);
+
+    s = (GString *) pool->free;
+    pool->free += need;
+    pool->left -= need;
+
+    s->str = (char *) (s + 1);
+    memcpy (s->str, text, len);
+    s->str[len] = '\0';
+    s->len = len;
+    s->allocated_len = len + 1;
+
+    pool->count++;
+
+    return s;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of names stored since the storage was reset. Names of removed entries are
+ * counted too until the storage is reset.
+ */
+
+gsize
+dir_pool_get_count (const dir_pool_t *pool)
+{
+    return pool == NULL ? 0 : pool->count;
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,31 @@
+/** \file  dirpool.h
+ *  \brief Header: storage of names of directory entries
+ */
+
+#ifndef MC__DIRPOOL_H
+#define MC__DIRPOOL_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_pool_t dir_pool_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_pool_t *dir_pool_new (void);
+void dir_pool_free (dir_pool_t * pool);
+void dir_pool_reset (dir_pool_t * pool);
+
+GString *dir_pool_add (dir_pool_t * pool, const char *text, gsize len);
+gsize dir_pool_get_count (const dir_pool_t * pool);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRPOOL_H */
@@ -0,0 +1,381 @@
+/*
+   Background scan of directory sizes.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirscan.c
+ *  \brief Source: background scan of directory sizes
+ *
+ *  Totals of file operation are computed in a separate thread while the operation is already
+ *  running, so the scan of a large tree doesn't delay the start of copying. Names read by the
+ *  scan are kept until the copy reaches the directory, so each directory is read only once.
+ *
+ *  VFS is not thread-safe, so the thread uses only plain opendir()/readdir()/stat() and is
+ *  used for local directories only.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+
+#include "dirscan.h"
+
+#ifdef ENABLE_DIR_SCAN
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Maximum number of names kept for the copy. Scan continues to count files after that */
+#define DIR_SCAN_MAX_NAMES (1024 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_scan_t
+{
+    gboolean follow_links;
+    /* directories to scan */
+    GPtrArray *roots;
+    GThread *thread;
+    gint cancelled;
+
+    /* following members are protected by lock */
+    GMutex lock;
+    size_t count;
+    uintmax_t bytes;
+    gboolean finished;
+    /* directory path -> array of entry names */
+    GHashTable *listings;
+    /* number of names in listings */
+    size_t names;
+};
+
+/* Scanned directory, used to detect cyclic symbolic links */
+typedef struct dir_scan_node_t
+{
+    dev_t dev;
+    ino_t ino;
+    const struct dir_scan_node_t *parent;
+} dir_scan_node_t;
+
+/* Subdirectory to scan */
+typedef struct
+{
+    char *path;
+    dev_t dev;
+    ino_t ino;
+} dir_scan_subdir_t;
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_scan_subdir_free (gpointer data)
+{
+    dir_scan_subdir_t *sd = (dir_scan_subdir_t *) data;
+
+    g_free (sd->path);
+    g_free (sd);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_scan_is_cyclic (const dir_scan_node_t *node, dev_t dev, ino_t ino)
+{
+    for (; node != NULL; node = node->parent)
+        if (node->dev == dev && node->ino == ino)
+            return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_scan_dir (dir_scan_t *scan, const char *path, const dir_scan_node_t *node)
+{
+    DIR *dir;
+    struct dirent *de;
+    GPtrArray *names, *subdirs;
+    size_t count = 0;
+    uintmax_t bytes = 0;
+    guint i;
+
+    dir = opendir (path);
+    if (dir == NULL)
+        return;
+
+    names = g_ptr_array_new_with_free_func (g_free);
+    subdirs = g_ptr_array_new_with_free_func (dir_scan_subdir_free);
+
+    while (g_atomic_int_get (&scan->cancelled) == 0 && (de = readdir (dir)) != NULL)
+    {
+        char *full;
+        struct stat st;
+        int res;
+
+        if (DIR_IS_DOT (de->d_name) || DIR_IS_DOTDOT (de->d_name))
+            continue;
+
+        g_ptr_array_add (names, g_strdup (de->d_name));
+
+        full = g_build_filename (path, de->d_name, (char *) NULL);
+        res = scan->follow_links ? stat (full, &st) : lstat (full, &st);
+
+        if (res == 0 && S_ISDIR (st.st_mode))
+        {
+            dir_scan_subdir_t *sd;
+
+            sd = g_new (dir_scan_subdir_t, 1);
+            sd->path = full;
+            sd->dev = st.st_dev;
+            sd->ino = st.st_ino;
+            g_ptr_array_add (subdirs, sd);
+            continue;
+        }
+
+        if (res == 0)
+        {
+            count++;
+            bytes += (uintmax_t) st.st_size;
+        }
+
+        g_free (full);
+    }
+
+    /* subdirectories are scanned after close to keep number of open descriptors low */
+    closedir (dir);
+
+    g_mutex_lock (&scan->lock);
+    scan->count += count;
+    scan->bytes += bytes;
+    /* listing is incomplete if scan was cancelled */
+    if (g_atomic_int_get (&scan->cancelled) == 0 && scan->names + names->len <= DIR_SCAN_MAX_NAMES
+        && !g_hash_table_contains (scan->listings, path))
+    {
+        scan->names += names->len;
+        g_hash_table_insert (scan->listings, g_strdup (path), names);
+        names = NULL;
+    }
+    g_mutex_unlock (&scan->lock);
+
+    if (names != NULL)
+        g_ptr_array_free (names, TRUE);
+
+    for (i = 0; i < subdirs->len && g_atomic_int_get (&scan->cancelled) == 0; i++)
+    {
+        const dir_scan_subdir_t *sd = (const dir_scan_subdir_t *) g_ptr_array_index (subdirs, i);
+        dir_scan_node_t child;
+
+        if (dir_scan_is_cyclic (node, sd->dev, sd->ino))
+            continue;
+
+        child.dev = sd->dev;
+        child.ino = sd->ino;
+        child.parent = node;
+        dir_scan_dir (scan, sd->path, &child);
+    }
+
+    g_ptr_array_free (subdirs, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+dir_scan_thread (gpointer data)
+{
+    dir_scan_t *scan = (dir_scan_t *) data;
+    guint i;
+
+    for (i = 0; i < scan->roots->len && g_atomic_int_get (&scan->cancelled) == 0; i++)
+    {
+        const char *path = (const char *) g_ptr_array_index (scan->roots, i);
+        struct stat st;
+        dir_scan_node_t node;
+
+        if (stat (path, &st) != 0)
+            continue;
+
+        node.dev = st.st_dev;
+        node.ino = st.st_ino;
+        node.parent = NULL;
+        dir_scan_dir (scan, path, &node);
+    }
+
+    g_mutex_lock (&scan->lock);
+    scan->finished = TRUE;
+    g_mutex_unlock (&scan->lock);
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the scan. Add files and directories and call dir_scan_start() then.
+ *
+ * @param follow_links TRUE to follow symbolic links to directories
+ *
+ * @return new scan
+ */
+
+dir_scan_t *
+dir_scan_new (gboolean follow_links)
+{
+    dir_scan_t *scan;
+
+    scan = g_new0 (dir_scan_t, 1);
+    scan->follow_links = follow_links;
+    scan->roots = g_ptr_array_new_with_free_func (g_free);
+    g_mutex_init (&scan->lock);
+    scan->listings =
+        g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
+    return scan;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop the scan and free it.
+ */
+
+void
+dir_scan_free (dir_scan_t *scan)
+{
+    if (scan == NULL)
+        return;
+
+    g_atomic_int_set (&scan->cancelled, 1);
+    if (scan->thread != NULL)
+        g_thread_join (scan->thread);
+
+    g_hash_table_destroy (scan->listings);
+    g_ptr_array_free (scan->roots, TRUE);
+    g_mutex_clear (&scan->lock);
+    g_free (scan);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Count file which is not a directory. Should be called before dir_scan_start().
+ */
+
+void
+dir_scan_add_file (dir_scan_t *scan, uintmax_t size)
+{
+    scan->count++;
+    scan->bytes += size;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add local directory to scan. Should be called before dir_scan_start().
+ */
+
+void
+dir_scan_add_dir (dir_scan_t *scan, const char *path)
+{
+    g_ptr_array_add (scan->roots, g_strdup (path));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the scan thread.
+ *
+ * @return TRUE on success, FALSE if thread cannot be started
+ */
+
+gboolean
+dir_scan_start (dir_scan_t *scan)
+{
+    if (scan->roots->len == 0)
+    {
+        scan->finished = TRUE;
+        return TRUE;
+    }
+
+    scan->thread = g_thread_try_new ("dirscan", dir_scan_thread, scan, NULL);
+    return (scan->thread != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get totals counted for the moment.
+ *
+ * @return TRUE if scan is finished and totals are final, FALSE otherwise
+ */
+
+gboolean
+dir_scan_get_totals (dir_scan_t *scan, size_t *count, uintmax_t *bytes)
+{
+    gboolean finished;
+
+    g_mutex_lock (&scan->lock);
+    *count = scan->count;
+    *bytes = scan->bytes;
+    finished = scan->finished;
+    g_mutex_unlock (&scan->lock);
+
+    return finished;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get names of entries of scanned directory except "." and "..". The names are removed
+ * from the scan, so each directory listing can be got only once.
+ *
+ * @param scan scan
+ * @param path directory path as it was built by the scan
+ *
+ * @return array of names to free with g_ptr_array_free(), NULL if the directory
+ *         is not scanned yet
+ */
+
+GPtrArray *
+dir_scan_take_listing (dir_scan_t *scan, const char *path)
+{
+    gpointer key = NULL, names = NULL;
+
+    g_mutex_lock (&scan->lock);
+    if (g_hash_table_lookup_extended (scan->listings, path, &key, &names))
+    {
+        g_hash_table_steal (scan->listings, path);
+        scan->names -= ((GPtrArray *) names)->len;
+        g_free (key);
+    }
+    g_mutex_unlock (&scan->lock);
+
+    return (GPtrArray *) names;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_DIR_SCAN */
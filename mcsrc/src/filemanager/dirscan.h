@@ -0,0 +1,41 @@
+/** \file  dirscan.h
+ *  \brief Header: background scan of directory sizes
+ */
+
+#ifndef MC__DIRSCAN_H
+#define MC__DIRSCAN_H
+
+#include <inttypes.h>           /* uintmax_t */
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Scan thread uses the POSIX file API directly bypassing VFS */
+#ifndef WIN32
+#define ENABLE_DIR_SCAN 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_scan_t dir_scan_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_scan_t *dir_scan_new (gboolean follow_links);
+void dir_scan_free (dir_scan_t * scan);
+
+void dir_scan_add_file (dir_scan_t * scan, uintmax_t size);
+void dir_scan_add_dir (dir_scan_t * scan, const char *path);
+gboolean dir_scan_start (dir_scan_t * scan);
+
+gboolean dir_scan_get_totals (dir_scan_t * scan, size_t * count, uintmax_t * bytes);
+GPtrArray *dir_scan_take_listing (dir_scan_t * scan, const char *path);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSCAN_H */
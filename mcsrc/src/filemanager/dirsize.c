@@ -0,0 +1,615 @@
+/*
+   Parallel computation of directory sizes.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirsize.c
+ *  \brief Source: parallel computation of directory sizes
+ *
+ *  Each directory of the tree is a separate job of the thread pool, so subtrees are read
+ *  concurrently. Sizes of files directly in a directory and names of its subdirectories are
+ *  cached for the session with the directory modification and status change times. If the
+ *  directory wasn't changed since, it is not read again: only its subdirectories are checked.
+ *  If it was changed, cached data of the whole subtree are dropped.
+ *
+ *  Each directory is counted once per tree, so bind mounts which make a loop are not walked
+ *  endlessly.
+ *
+ *  Note that the modification time of a directory doesn't change if a file in it is
+ *  overwritten or grows, so the cache can miss such changes until the directory changes.
+ *
+ *  VFS is not thread-safe, so worker threads use only plain system calls on local files.
+ */
+
+#include <config.h>
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "lib/global.h"
+
+#include "dirsize.h"
+
+#ifdef ENABLE_DIR_SIZE_POOL
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIR_SIZE_MAX_WORKERS 16
+/* Cache is dropped if it grows over this number of directories */
+#define DIR_SIZE_CACHE_MAX (256 * 1024)
+
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+#define DIR_SIZE_MTIME_NSEC(st) ((st)->st_mtim.tv_nsec)
+#define DIR_SIZE_CTIME_NSEC(st) ((st)->st_ctim.tv_nsec)
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMESPEC)
+#define DIR_SIZE_MTIME_NSEC(st) ((st)->st_mtimespec.tv_nsec)
+#define DIR_SIZE_CTIME_NSEC(st) ((st)->st_ctimespec.tv_nsec)
+#elif defined(HAVE_STRUCT_STAT_ST_MTIMENSEC)
+#define DIR_SIZE_MTIME_NSEC(st) ((st)->st_mtimensec)
+#define DIR_SIZE_CTIME_NSEC(st) ((st)->st_ctimensec)
+#else
+#define DIR_SIZE_MTIME_NSEC(st) 0
+#define DIR_SIZE_CTIME_NSEC(st) 0
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+/* Identity of directory */
+typedef struct
+{
+    dev_t dev;
+    ino_t ino;
+} dir_size_key_t;
+
+struct dir_size_pool_t
+{
+    GThreadPool *threads;
+    /* finished roots */
+    GAsyncQueue *results;
+    /* number of added roots which are not popped yet */
+    guint running;
+    gint cancelled;
+
+    /* progress of all roots */
+    GMutex lock;
+    size_t dir_count;
+    uintmax_t total;
+};
+
+/* Directory which size is requested */
+typedef struct
+{
+    dir_size_pool_t *pool;
+    /* unfinished jobs of this tree */
+    gint pending;
+
+    GMutex lock;
+    dir_size_result_t result;
+    /* directories of this tree: set of dir_size_key_t */
+    GHashTable *visited;
+} dir_size_root_t;
+
+/* One directory of the tree */
+typedef struct
+{
+    dir_size_root_t *root;
+    char *path;
+    struct stat st;
+} dir_size_job_t;
+
+/* Cached content of one directory */
+typedef struct
+{
+    /* must be the first member: entry is the key of the hash table */
+    dir_size_key_t key;
+    time_t mtime;
+    long mtime_nsec;
+    time_t ctime;
+    long ctime_nsec;
+    /* files except subdirectories */
+    size_t count;
+    uintmax_t total;
+    /* names of subdirectories */
+    char **subdirs;
+    /* identities of subdirectories in the same order */
+    dir_size_key_t *subkeys;
+} dir_size_cache_entry_t;
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+static GMutex dir_size_cache_lock;
+static GHashTable *dir_size_cache = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static guint
+dir_size_key_hash (gconstpointer key)
+{
+    const dir_size_key_t *k = (const dir_size_key_t *) key;
+    guint64 h;
+
+    h = (guint64) k->ino * 31 + (guint64) k->dev;
+    return (guint) (h ^ (h >> 32));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_size_key_equal (gconstpointer a, gconstpointer b)
+{
+    const dir_size_key_t *ka = (const dir_size_key_t *) a;
+    const dir_size_key_t *kb = (const dir_size_key_t *) b;
+
+    return (ka->dev == kb->dev && ka->ino == kb->ino);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_cache_entry_free (gpointer data)
+{
+    dir_size_cache_entry_t *e = (dir_size_cache_entry_t *) data;
+
+    g_strfreev (e->subdirs);
+    g_free (e->subkeys);
+    g_free (e);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_size_cache_entry_is_valid (const dir_size_cache_entry_t *e, const struct stat *st)
+{
+    return (e->mtime == st->st_mtime && e->mtime_nsec == (long) DIR_SIZE_MTIME_NSEC (st)
+            && e->ctime == st->st_ctime && e->ctime_nsec == (long) DIR_SIZE_CTIME_NSEC (st));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Drop cached directory and all its cached subdirectories. Cache must be locked.
+ */
+
+static void
+dir_size_cache_invalidate (const dir_size_key_t *key)
+{
+    GArray *stack;
+
+    stack = g_array_new (FALSE, FALSE, sizeof (dir_size_key_t));
+    g_array_append_val (stack, *key);
+
+    while (stack->len != 0)
+    {
+        dir_size_key_t k;
+        const dir_size_cache_entry_t *e;
+
+        k = g_array_index (stack, dir_size_key_t, stack->len - 1);
+        g_array_set_size (stack, stack->len - 1);
+
+        /* removed entry is not found again, so loops of the tree end here */
+        e = (const dir_size_cache_entry_t *) g_hash_table_lookup (dir_size_cache, &k);
+        if (e != NULL)
+        {
+            g_array_append_vals (stack, e->subkeys, g_strv_length (e->subdirs));
+            g_hash_table_remove (dir_size_cache, &k);
+        }
+    }
+
+    g_array_free (stack, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find unchanged directory in the cache.
+ *
+ * @return TRUE if directory is found, its data are copied to @entry
+ */
+
+static gboolean
+dir_size_cache_lookup (const struct stat *st, dir_size_cache_entry_t *entry)
+{
+    const dir_size_cache_entry_t *e = NULL;
+    dir_size_key_t key;
+
+    key.dev = st->st_dev;
+    key.ino = st->st_ino;
+
+    g_mutex_lock (&dir_size_cache_lock);
+    if (dir_size_cache != NULL)
+        e = (const dir_size_cache_entry_t *) g_hash_table_lookup (dir_size_cache, &key);
+    if (e != NULL && dir_size_cache_entry_is_valid (e, st))
+    {
+        *entry = *e;
+        entry->subdirs = g_strdupv (e->subdirs);
+        entry->subkeys = NULL;
+    }
+    else if (e != NULL)
+    {
+        /* subdirectories could be moved or removed, their cached data are unreliable too */
+        dir_size_cache_invalidate (&key);
+        e = NULL;
+    }
+    g_mutex_unlock (&dir_size_cache_lock);
+
+    return (e != NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_cache_store (const struct stat *st, size_t count, uintmax_t total, GPtrArray *subdirs,
+                      GArray *subkeys)
+{
+    dir_size_cache_entry_t *e;
+    guint i;
+
+    e = g_new (dir_size_cache_entry_t, 1);
+    e->key.dev = st->st_dev;
+    e->key.ino = st->st_ino;
+    e->mtime = st->st_mtime;
+    e->mtime_nsec = (long) DIR_SIZE_MTIME_NSEC (st);
+    e->ctime = st->st_ctime;
+    e->ctime_nsec = (long) DIR_SIZE_CTIME_NSEC (st);
+    e->count = count;
+    e->total = total;
+    e->subdirs = g_new (char *, subdirs->len + 1);
+    for (i = 0; i < subdirs->len; i++)
+        e->subdirs[i] = g_strdup ((const char *) g_ptr_array_index (subdirs, i));
+    e->subdirs[i] = NULL;
+    e->subkeys = g_new (dir_size_key_t, subkeys->len + 1);
+    memcpy (e->subkeys, subkeys->data, subkeys->len * sizeof (dir_size_key_t));
+
+    g_mutex_lock (&dir_size_cache_lock);
+    if (dir_size_cache == NULL)
+        dir_size_cache = g_hash_table_new_full (dir_size_key_hash, dir_size_key_equal,
+                                                dir_size_cache_entry_free, NULL);
+    else if (g_hash_table_size (dir_size_cache) >= DIR_SIZE_CACHE_MAX)
+        g_hash_table_remove_all (dir_size_cache);
+    g_hash_table_replace (dir_size_cache, e, e);
+    g_mutex_unlock (&dir_size_cache_lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_root_finish (dir_size_root_t *root)
+{
+    if (g_atomic_int_dec_and_test (&root->pending))
+    {
+        root->result.ok = g_atomic_int_get (&root->pool->cancelled) == 0;
+        g_hash_table_destroy (root->visited);
+        root->visited = NULL;
+        g_async_queue_push (root->pool->results, root);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_push_subdir (dir_size_root_t *root, const char *path, const struct stat *st)
+{
+    dir_size_job_t *job;
+    dir_size_key_t *key;
+    gboolean seen;
+
+    key = g_new (dir_size_key_t, 1);
+    key->dev = st->st_dev;
+    key->ino = st->st_ino;
+
+    g_mutex_lock (&root->lock);
+    seen = g_hash_table_contains (root->visited, key);
+    if (!seen)
+        g_hash_table_add (root->visited, key);
+    g_mutex_unlock (&root->lock);
+
+    /* bind mount of one of parents */
+    if (seen)
+    {
+        g_free (key);
+        return;
+    }
+
+    job = g_new (dir_size_job_t, 1);
+    job->root = root;
+    job->path = g_strdup (path);
+    job->st = *st;
+
+    g_atomic_int_inc (&root->pending);
+    g_thread_pool_push (root->pool->threads, job, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the directory, count its files and queue its subdirectories.
+ */
+
+static void
+dir_size_read_dir (dir_size_job_t *job, size_t *count, uintmax_t *total)
+{
+    dir_size_pool_t *pool = job->root->pool;
+    DIR *dir;
+    struct dirent *de;
+    GPtrArray *subdirs;
+    GArray *subkeys;
+
+    dir = opendir (job->path);
+    if (dir == NULL)
+        return;
+
+    subdirs = g_ptr_array_new_with_free_func (g_free);
+    subkeys = g_array_new (FALSE, FALSE, sizeof (dir_size_key_t));
+
+    while (g_atomic_int_get (&pool->cancelled) == 0 && (de = readdir (dir)) != NULL)
+    {
+        char *full;
+        struct stat st;
+
+        if (DIR_IS_DOT (de->d_name) || DIR_IS_DOTDOT (de->d_name))
+            continue;
+
+        full = g_build_filename (job->path, de->d_name, (char *) NULL);
+
+        if (lstat (full, &st) == 0)
+        {
+            if (S_ISDIR (st.st_mode))
+            {
+                dir_size_key_t key;
+
+                key.dev = st.st_dev;
+                key.ino = st.st_ino;
+                g_ptr_array_add (subdirs, g_strdup (de->d_name));
+                g_array_append_val (subkeys, key);
+                dir_size_push_subdir (job->root, full, &st);
+            }
+            else
+            {
+                (*count)++;
+                *total += (uintmax_t) st.st_size;
+            }
+        }
+
+        g_free (full);
+    }
+
+    closedir (dir);
+
+    /* content of directory is incomplete if computation was cancelled */
+    if (g_atomic_int_get (&pool->cancelled) == 0)
+        dir_size_cache_store (&job->st, *count, *total, subdirs, subkeys);
+    g_ptr_array_free (subdirs, TRUE);
+    g_array_free (subkeys, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_size_worker (gpointer data, gpointer user_data)
+{
+    dir_size_job_t *job = (dir_size_job_t *) data;
+    dir_size_pool_t *pool = (dir_size_pool_t *) user_data;
+    dir_size_root_t *root = job->root;
+
+    if (g_atomic_int_get (&pool->cancelled) == 0)
+    {
+        dir_size_cache_entry_t cached;
+        size_t count = 0;
+        uintmax_t total = 0;
+
+        if (dir_size_cache_lookup (&job->st, &cached))
+        {
+            char **name;
+
+            count = cached.count;
+            total = cached.total;
+
+            /* subdirectories can be changed */
+            for (name = cached.subdirs; *name != NULL; name++)
+            {
+                char *full;
+                struct stat st;
+
+                full = g_build_filename (job->path, *name, (char *) NULL);
+                if (lstat (full, &st) == 0 && S_ISDIR (st.st_mode))
+                    dir_size_push_subdir (root, full, &st);
+                g_free (full);
+            }
+
+            g_strfreev (cached.subdirs);
+        }
+        else
+            dir_size_read_dir (job, &count, &total);
+
+        g_mutex_lock (&root->lock);
+        root->result.dir_count++;
+        root->result.count += count;
+        root->result.total += total;
+        g_mutex_unlock (&root->lock);
+
+        g_mutex_lock (&pool->lock);
+        pool->dir_count++;
+        pool->total += total;
+        g_mutex_unlock (&pool->lock);
+    }
+
+    g_free (job->path);
+    g_free (job);
+
+    dir_size_root_finish (root);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create pool of worker threads.
+ *
+ * @return new pool, NULL if threads cannot be created
+ */
+
+dir_size_pool_t *
+dir_size_pool_new (void)
+{
+    dir_size_pool_t *pool;
+
+    pool = g_new0 (dir_size_pool_t, 1);
+    pool->results = g_async_queue_new ();
+    g_mutex_init (&pool->lock);
+    pool->threads = g_thread_pool_new (dir_size_worker, pool,
+                                       CLAMP ((int) g_get_num_processors () * 2, 2,
+                                              DIR_SIZE_MAX_WORKERS), FALSE, NULL);
+    if (pool->threads == NULL)
+    {
+        g_mutex_clear (&pool->lock);
+        g_async_queue_unref (pool->results);
+        g_free (pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop computation and destroy the pool. Results which were not popped are dropped.
+ */
+
+void
+dir_size_pool_free (dir_size_pool_t *pool)
+{
+    dir_size_root_t *root;
+
+    if (pool == NULL)
+        return;
+
+    g_atomic_int_set (&pool->cancelled, 1);
+
+    /* wait for queued jobs, they are skipped now. Running jobs don't queue new ones */
+    for (; pool->running != 0; pool->running--)
+    {
+        root = g_async_queue_pop (pool->results);
+        g_mutex_clear (&root->lock);
+        g_free (root);
+    }
+
+    g_thread_pool_free (pool->threads, FALSE, TRUE);
+
+    g_async_queue_unref (pool->results);
+    g_mutex_clear (&pool->lock);
+    g_free (pool);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue local directory to compute its size.
+ *
+ * @param pool pool
+ * @param path directory path
+ * @param id identifier of the result
+ */
+
+void
+dir_size_pool_add (dir_size_pool_t *pool, const char *path, int id)
+{
+    dir_size_root_t *root;
+    struct stat st;
+
+    root = g_new0 (dir_size_root_t, 1);
+    root->pool = pool;
+    root->pending = 1;
+    g_mutex_init (&root->lock);
+    root->result.id = id;
+    root->visited = g_hash_table_new_full (dir_size_key_hash, dir_size_key_equal, g_free, NULL);
+
+    pool->running++;
+
+    if (stat (path, &st) == 0 && S_ISDIR (st.st_mode))
+        dir_size_push_subdir (root, path, &st);
+
+    /* drop the initial reference */
+    dir_size_root_finish (root);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get size of one of the directories.
+ *
+ * @param pool pool
+ * @param timeout time to wait for a result in microseconds, 0 to return immediately
+ * @param result where the result is stored
+ *
+ * @return TRUE if the size was got, FALSE if no directory was finished during timeout
+ */
+
+gboolean
+dir_size_pool_pop (dir_size_pool_t *pool, gint64 timeout, dir_size_result_t *result)
+{
+    dir_size_root_t *root;
+
+    if (pool->running == 0)
+        return FALSE;
+
+    if (timeout <= 0)
+        root = g_async_queue_try_pop (pool->results);
+    else
+        root = g_async_queue_timeout_pop (pool->results, (guint64) timeout);
+
+    if (root == NULL)
+        return FALSE;
+
+    pool->running--;
+    *result = root->result;
+    g_mutex_clear (&root->lock);
+    g_free (root);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+guint
+dir_size_pool_get_running (const dir_size_pool_t *pool)
+{
+    return pool->running;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of directories and size of files counted for the moment in all directories.
+ */
+
+void
+dir_size_pool_get_progress (dir_size_pool_t *pool, size_t *dir_count, uintmax_t *total)
+{
+    g_mutex_lock (&pool->lock);
+    *dir_count = pool->dir_count;
+    *total = pool->total;
+    g_mutex_unlock (&pool->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_DIR_SIZE_POOL */
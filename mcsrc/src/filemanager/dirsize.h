@@ -0,0 +1,51 @@
+/** \file  dirsize.h
+ *  \brief Header: parallel computation of directory sizes
+ */
+
+#ifndef MC__DIRSIZE_H
+#define MC__DIRSIZE_H
+
+#include <inttypes.h>           /* uintmax_t */
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Worker threads use the POSIX file API directly bypassing VFS */
+#ifndef WIN32
+#define ENABLE_DIR_SIZE_POOL 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_size_pool_t dir_size_pool_t;
+
+/* Computed size of one directory */
+typedef struct
+{
+    /* Identifier passed to dir_size_pool_add() */
+    int id;
+    /* FALSE if computation was cancelled */
+    gboolean ok;
+    size_t dir_count;
+    size_t count;
+    uintmax_t total;
+} dir_size_result_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_size_pool_t *dir_size_pool_new (void);
+void dir_size_pool_free (dir_size_pool_t * pool);
+
+void dir_size_pool_add (dir_size_pool_t * pool, const char *path, int id);
+gboolean dir_size_pool_pop (dir_size_pool_t * pool, gint64 timeout, dir_size_result_t * result);
+guint dir_size_pool_get_running (const dir_size_pool_t * pool);
+void dir_size_pool_get_progress (dir_size_pool_t * pool, size_t * dir_count, uintmax_t * total);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSIZE_H */
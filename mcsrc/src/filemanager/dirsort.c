@@ -0,0 +1,391 @@
+/*
+   Sorting of large directory lists.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirsort.c
+ *  \brief Source: sorting of large directory lists
+ *
+ *  Directory entries are large structures, so they are not moved while being sorted.
+ *  Arrays of pointers to them are sorted instead, and entries are moved once at the end.
+ *
+ *  Entries compared by a function are sorted with a stable merge sort. Large arrays are
+ *  split to parts which are sorted by several threads at once, then the sorted parts are
+ *  merged pairwise, also in parallel. Entries compared by an integer, like the size or
+ *  the modification time, are sorted with a radix sort which doesn't compare them at all.
+ *
+ *  Comparison functions are called by worker threads, so they must not change anything.
+ */
+
+#include <config.h>
+
+#include <string.h>
+
+#include "lib/global.h"
+
+#include "dirsort.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define DIR_SORT_MAX_WORKERS 16
+/* Arrays not greater than it are sorted by insertion */
+#define DIR_SORT_INSERTION_MAX 16
+/* Minimal number of items sorted by one thread */
+#define DIR_SORT_PARALLEL_MIN 16384
+/* Number of bits sorted by one pass of radix sort */
+#define DIR_SORT_RADIX_BITS 8
+#define DIR_SORT_RADIX_SIZE (1 << DIR_SORT_RADIX_BITS)
+#define DIR_SORT_RADIX_PASSES (64 / DIR_SORT_RADIX_BITS)
+#define DIR_SORT_RADIX_DIGIT(key, pass) \
+    (((key) >> ((pass) * DIR_SORT_RADIX_BITS)) & (DIR_SORT_RADIX_SIZE - 1))
+
+/*** file scope type declarations ****************************************************************/
+
+/* Part of items processed by one thread */
+typedef struct
+{
+    dir_sort_part_fn fn;
+    gpointer data;
+    gsize start;
+    gsize end;
+} dir_sort_part_t;
+
+/* Array sorted by several threads */
+typedef struct
+{
+    gpointer *items;
+    gpointer *tmp;
+    GCompareDataFunc cmp;
+    gpointer data;
+    /* bounds of parts: part i is from bounds[i] to bounds[i + 1] - 1 */
+    gsize *bounds;
+    gsize nparts;
+    /* number of parts merged already */
+    gsize step;
+} dir_sort_merge_t;
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gsize
+dir_sort_get_workers (void)
+{
+    return CLAMP (g_get_num_processors (), 1, DIR_SORT_MAX_WORKERS);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_sort_part_worker (gpointer data, gpointer user_data)
+{
+    const dir_sort_part_t *part = (const dir_sort_part_t *) data;
+
+    (void) user_data;
+
+    part->fn (part->data, part->start, part->end);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_sort_insertion (gpointer *items, gsize count, GCompareDataFunc cmp, gpointer data)
+{
+    gsize i, j;
+
+    for (i = 1; i < count; i++)
+    {
+        gpointer item = items[i];
+
+        for (j = i; j != 0 && cmp (item, items[j - 1], data) < 0; j--)
+            items[j] = items[j - 1];
+        items[j] = item;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Merge two sorted runs. Item of the first run goes first if items are equal, so the sort
+ * is stable.
+ */
+
+static void
+dir_sort_merge_runs (gpointer *dst, gpointer *a, gsize na, gpointer *b, gsize nb,
+                     GCompareDataFunc cmp, gpointer data)
+{
+    while (na != 0 && nb != 0)
+    {
+        if (cmp (*b, *a, data) < 0)
+        {
+            *dst++ = *b++;
+            nb--;
+        }
+        else
+        {
+            *dst++ = *a++;
+            na--;
+        }
+    }
+
+    /* one of runs is empty */
+    memcpy (dst, a, na * sizeof (gpointer));
+    memcpy (dst + na, b, nb * sizeof (gpointer));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_sort_merge_seq (gpointer *items, gpointer *tmp, gsize count, GCompareDataFunc cmp,
+                    gpointer data)
+{
+    gsize half;
+
+    if (count <= DIR_SORT_INSERTION_MAX)
+    {
+        dir_sort_insertion (items, count, cmp, data);
+        return;
+    }
+
+    half = count / 2;
+    dir_sort_merge_seq (items, tmp, half, cmp, data);
+    dir_sort_merge_seq (items + half, tmp + half, count - half, cmp, data);
+
+    /* runs are in order already: it is usual when sorted list is sorted again */
+    if (cmp (items[half], items[half - 1], data) >= 0)
+        return;
+
+    memcpy (tmp, items, count * sizeof (gpointer));
+    dir_sort_merge_runs (items, tmp, half, tmp + half, count - half, cmp, data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_sort_merge_sort_parts (gpointer data, gsize start, gsize end)
+{
+    dir_sort_merge_t *ms = (dir_sort_merge_t *) data;
+    gsize i;
+
+    for (i = start; i < end; i++)
+    {
+        const gsize lo = ms->bounds[i];
+
+        dir_sort_merge_seq (ms->items + lo, ms->tmp + lo, ms->bounds[i + 1] - lo, ms->cmp,
+                            ms->data);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_sort_merge_join_parts (gpointer data, gsize start, gsize end)
+{
+    dir_sort_merge_t *ms = (dir_sort_merge_t *) data;
+    gsize i;
+
+    for (i = start; i < end; i++)
+    {
+        const gsize first = i * 2 * ms->step;
+        const gsize lo = ms->bounds[first];
+        const gsize mid = ms->bounds[MIN (first + ms->step, ms->nparts)];
+        const gsize hi = ms->bounds[MIN (first + 2 * ms->step, ms->nparts)];
+
+        if (mid == hi || ms->cmp (ms->items[mid], ms->items[mid - 1], ms->data) >= 0)
+            continue;
+
+        memcpy (ms->tmp + lo, ms->items + lo, (hi - lo) * sizeof (gpointer));
+        dir_sort_merge_runs (ms->items + lo, ms->tmp + lo, mid - lo, ms->tmp + mid, hi - mid,
+                             ms->cmp, ms->data);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Run function for parts of items by several threads at once. Wait until all parts are done.
+ *
+ * @param count number of items
+ * @param min_part minimal number of items worth a thread
+ * @param fn function run for each part
+ * @param data data passed to @fn
+ */
+
+void
+dir_sort_parallel (gsize count, gsize min_part, dir_sort_part_fn fn, gpointer data)
+{
+    GThreadPool *threads = NULL;
+    dir_sort_part_t *parts;
+    gsize nparts, i;
+
+    nparts = MIN (count / MAX (min_part, 1), dir_sort_get_workers ());
+    if (nparts > 1)
+        threads = g_thread_pool_new (dir_sort_part_worker, NULL, (gint) nparts, FALSE, NULL);
+
+    if (threads == NULL)
+    {
+        fn (data, 0, count);
+        return;
+    }
+
+    parts = g_new (dir_sort_part_t, nparts);
+
+    for (i = 0; i < nparts; i++)
+    {
+        parts[i].fn = fn;
+        parts[i].data = data;
+        parts[i].start = count * i / nparts;
+        parts[i].end = count * (i + 1) / nparts;
+        g_thread_pool_push (threads, &parts[i], NULL);
+    }
+
+    /* wait for all parts */
+    g_thread_pool_free (threads, FALSE, TRUE);
+    g_free (parts);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort array with a stable merge sort. Large array is sorted by several threads.
+ *
+ * @param items array to sort
+ * @param count number of items
+ * @param cmp comparison function, it is called by several threads at once
+ * @param data data passed to @cmp
+ */
+
+void
+dir_sort_merge (gpointer *items, gsize count, GCompareDataFunc cmp, gpointer data)
+{
+    dir_sort_merge_t ms;
+    gsize i;
+
+    if (count <= DIR_SORT_INSERTION_MAX)
+    {
+        dir_sort_insertion (items, count, cmp, data);
+        return;
+    }
+
+    ms.items = items;
+    ms.tmp = g_new (gpointer, count);
+    ms.cmp = cmp;
+    ms.data = data;
+    ms.nparts = MIN (count / DIR_SORT_PARALLEL_MIN, dir_sort_get_workers ());
+
+    if (ms.nparts < 2)
+    {
+        dir_sort_merge_seq (items, ms.tmp, count, cmp, data);
+        g_free (ms.tmp);
+        return;
+    }
+
+    ms.bounds = g_new (gsize, ms.nparts + 1);
+    for (i = 0; i <= ms.nparts; i++)
+        ms.bounds[i] = count * i / ms.nparts;
+
+    dir_sort_parallel (ms.nparts, 1, dir_sort_merge_sort_parts, &ms);
+
+    for (ms.step = 1; ms.step < ms.nparts; ms.step *= 2)
+        dir_sort_parallel ((ms.nparts + 2 * ms.step - 1) / (2 * ms.step), 1,
+                           dir_sort_merge_join_parts, &ms);
+
+    g_free (ms.bounds);
+    g_free (ms.tmp);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort items by key in ascending order with a stable radix sort.
+ *
+ * @param items array to sort
+ * @param count number of items
+ */
+
+void
+dir_sort_radix (dir_sort_item_t *items, gsize count)
+{
+    gsize *counts;
+    dir_sort_item_t *tmp, *src, *dst;
+    gsize i;
+    int pass;
+
+    if (count <= DIR_SORT_INSERTION_MAX)
+    {
+        for (i = 1; i < count; i++)
+        {
+            dir_sort_item_t item = items[i];
+            gsize j;
+
+            for (j = i; j != 0 && item.key < items[j - 1].key; j--)
+                items[j] = items[j - 1];
+            items[j] = item;
+        }
+        return;
+    }
+
+    /* count digits of all passes at once */
+    counts = g_new0 (gsize, DIR_SORT_RADIX_PASSES * DIR_SORT_RADIX_SIZE);
+    for (i = 0; i < count; i++)
+        for (pass = 0; pass < DIR_SORT_RADIX_PASSES; pass++)
+            counts[pass * DIR_SORT_RADIX_SIZE + DIR_SORT_RADIX_DIGIT (items[i].key, pass)]++;
+
+    tmp = g_new (dir_sort_item_t, count);
+    src = items;
+    dst = tmp;
+
+    for (pass = 0; pass < DIR_SORT_RADIX_PASSES; pass++)
+    {
+        gsize *c = counts + pass * DIR_SORT_RADIX_SIZE;
+        gsize offset = 0;
+        int d;
+
+        /* skip the pass if all items have the same digit: high digits of sizes and times */
+        if (c[DIR_SORT_RADIX_DIGIT (src[0].key, pass)] == count)
+            continue;
+
+        for (d = 0; d < DIR_SORT_RADIX_SIZE; d++)
+        {
+            const gsize n = c[d];
+
+            c[d] = offset;
+            offset += n;
+        }
+
+        for (i = 0; i < count; i++)
+            dst[c[DIR_SORT_RADIX_DIGIT (src[i].key, pass)]++] = src[i];
+
+        src = dst;
+        dst = src == items ? tmp : items;
+    }
+
+    if (src != items)
+        memcpy (items, src, count * sizeof (dir_sort_item_t));
+
+    g_free (tmp);
+    g_free (counts);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,37 @@
+/** \file  dirsort.h
+ *  \brief Header: sorting of large directory lists
+ */
+
+#ifndef MC__DIRSORT_H
+#define MC__DIRSORT_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Function run by dir_sort_parallel() for items from start to end - 1 */
+typedef void (*dir_sort_part_fn) (gpointer data, gsize start, gsize end);
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/* Item sorted by integer key */
+typedef struct
+{
+    guint64 key;
+    gpointer data;
+} dir_sort_item_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void dir_sort_parallel (gsize count, gsize min_part, dir_sort_part_fn fn, gpointer data);
+
+void dir_sort_merge (gpointer * items, gsize count, GCompareDataFunc cmp, gpointer data);
+void dir_sort_radix (dir_sort_item_t * items, gsize count);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSORT_H */
@@ -0,0 +1,230 @@
+/*
+   Status of local directory entries got by worker threads.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirstat.c
+ *  \brief Source: status of local directory entries got by worker threads
+ *
+ *  Loading of a directory with a lot of entries on a network file system is dominated by
+ *  the round trip of lstat() of each entry. Names are read first, then entries are split
+ *  to batches which are stat'ed by several threads at once, so the round trips overlap.
+ *  Entries are stat'ed with fstatat() relative to the open directory, so the kernel doesn't
+ *  resolve the full path for each entry. Small directories are stat'ed by the caller.
+ *
+ *  Directory is loaded by several runs while the panel is shown, so the threads are created
+ *  once for the directory and are kept until it is closed.
+ *
+ *  VFS is not thread-safe, so worker threads use only plain system calls on local files.
+ */
+
+#include <config.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+
+#include "dirstat.h"
+
+#ifdef ENABLE_DIR_STAT
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_stat_t
+{
+    /* open directory */
+    int fd;
+
+    /* NULL if threads cannot be created */
+    GThreadPool *threads;
+    /* batches of the current run which are not stat'ed yet */
+    int pending;
+    GMutex lock;
+    GCond cond;
+};
+
+/* Entries stat'ed by one job */
+typedef struct
+{
+    file_entry_t *entries;
+    int count;
+} dir_stat_batch_t;
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get status of entries as handle_dirent() does it: entry which cannot be stat'ed gets zero
+ * mode, symbolic link is followed to find out whether it points to directory.
+ */
+
+static void
+dir_stat_entries (const dir_stat_t *ds, file_entry_t *entries, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        file_entry_t *fentry = &entries[i];
+        gboolean link_to_dir = FALSE, stale_link = FALSE;
+
+        if (fstatat (ds->fd, fentry->fname->str, &fentry->st, AT_SYMLINK_NOFOLLOW) != 0)
+            memset (&fentry->st, 0, sizeof (fentry->st));
+        else if (S_ISLNK (fentry->st.st_mode))
+        {
+            struct stat st;
+
+            stale_link = fstatat (ds->fd, fentry->fname->str, &st, 0) != 0;
+            link_to_dir = !stale_link && S_ISDIR (st.st_mode);
+        }
+
+        fentry->f.link_to_dir = link_to_dir ? 1 : 0;
+        fentry->f.stale_link = stale_link ? 1 : 0;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_stat_worker (gpointer data, gpointer user_data)
+{
+    const dir_stat_batch_t *batch = (const dir_stat_batch_t *) data;
+    dir_stat_t *ds = (dir_stat_t *) user_data;
+
+    dir_stat_entries (ds, batch->entries, batch->count);
+
+    g_mutex_lock (&ds->lock);
+    ds->pending--;
+    if (ds->pending == 0)
+        g_cond_signal (&ds->cond);
+    g_mutex_unlock (&ds->lock);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open local directory to stat its entries.
+ *
+ * @param vpath directory path
+ *
+ * @return new object, NULL if directory is not local or cannot be opened
+ */
+
+dir_stat_t *
+dir_stat_open (const vfs_path_t *vpath)
+{
+    dir_stat_t *ds;
+    int fd;
+
+    if (!vfs_file_is_local (vpath))
+        return NULL;
+
+    fd = open (vfs_path_get_last_path_str (vpath), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    ds = g_new0 (dir_stat_t, 1);
+    ds->fd = fd;
+    g_mutex_init (&ds->lock);
+    g_cond_init (&ds->cond);
+    /* threads are shared with other pools and are started on demand */
+    ds->threads = g_thread_pool_new (dir_stat_worker, ds, DIR_STAT_MAX_WORKERS, FALSE, NULL);
+
+    return ds;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_stat_close (dir_stat_t *ds)
+{
+    if (ds == NULL)
+        return;
+
+    if (ds->threads != NULL)
+        g_thread_pool_free (ds->threads, TRUE, TRUE);
+    g_cond_clear (&ds->cond);
+    g_mutex_clear (&ds->lock);
+    close (ds->fd);
+    g_free (ds);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get status of directory entries. Set st, f.link_to_dir and f.stale_link of each entry
+ * by name of the entry.
+ *
+ * @param entries entries of the directory
+ * @param count number of entries
+ */
+
+void
+dir_stat_run (dir_stat_t *ds, file_entry_t *entries, int count)
+{
+    dir_stat_batch_t *batches;
+    int nbatches, i;
+
+    nbatches = (count + DIR_STAT_BATCH - 1) / DIR_STAT_BATCH;
+
+    if (nbatches < 2 || ds->threads == NULL)
+    {
+        dir_stat_entries (ds, entries, count);
+        return;
+    }
+
+    batches = g_new (dir_stat_batch_t, nbatches);
+    ds->pending = nbatches;
+
+    for (i = 0; i < nbatches; i++)
+    {
+        batches[i].entries = entries + i * DIR_STAT_BATCH;
+        batches[i].count = MIN (count - i * DIR_STAT_BATCH, DIR_STAT_BATCH);
+        g_thread_pool_push (ds->threads, &batches[i], NULL);
+    }
+
+    /* wait for all batches */
+    g_mutex_lock (&ds->lock);
+    while (ds->pending != 0)
+        g_cond_wait (&ds->cond, &ds->lock);
+    g_mutex_unlock (&ds->lock);
+
+    g_free (batches);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_DIR_STAT */
@@ -0,0 +1,43 @@
+/** \file  dirstat.h
+ *  \brief Header: status of local directory entries got by worker threads
+ */
+
+#ifndef MC__DIRSTAT_H
+#define MC__DIRSTAT_H
+
+#include "lib/global.h"
+#include "lib/file-entry.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Worker threads use the POSIX file API directly bypassing VFS */
+#if !defined(WIN32) && defined(HAVE_FSTATAT)
+#define ENABLE_DIR_STAT 1
+#endif
+
+/* Threads wait for the file system mostly, so there are more of them than processors */
+#define DIR_STAT_MAX_WORKERS 16
+/* Number of entries stat'ed by one job */
+#define DIR_STAT_BATCH 256
+/* Number of entries which keeps all threads of dir_stat_run() busy */
+#define DIR_STAT_RUN_FULL (DIR_STAT_MAX_WORKERS * DIR_STAT_BATCH)
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_stat_t dir_stat_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_stat_t *dir_stat_open (const vfs_path_t * vpath);
+void dir_stat_close (dir_stat_t * ds);
+
+void dir_stat_run (dir_stat_t * ds, file_entry_t * entries, int count);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRSTAT_H */
@@ -0,0 +1,301 @@
+/*
+   Watch of changes of local directories.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  dirwatch.c
+ *  \brief Source: watch of changes of local directories
+ *
+ *  Reload of a panel reads and stats the whole directory again, although usually only a few
+ *  entries were changed since the last load. The kernel reports changes of a watched
+ *  directory with inotify, so the panel restats the changed entries only.
+ *
+ *  Events are read as soon as they arrive, so the kernel queue doesn't overflow while the
+ *  panel isn't reloaded. Several events for the same name are kept as one changed name.
+ *  Changes are unknown if the queue overflows, if too many names are changed or if the
+ *  directory itself is removed or moved: the directory must be reloaded then.
+ *
+ *  Changes made on other hosts are not reported for network file systems, so directories
+ *  on them are not watched.
+ */
+
+#include <config.h>
+
+#include "lib/global.h"
+
+#include "dirwatch.h"
+
+#ifdef ENABLE_DIR_WATCH
+
+#include <errno.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/vfs.h>            /* statfs() */
+#include <unistd.h>
+
+#include "lib/tty/key.h"        /* add_select_channel(), delete_select_channel() */
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Changes of a directory which are applied to the panel */
+#define DIR_WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM \
+                          | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR \
+                          | IN_EXCL_UNLINK)
+
+/* Changes of the directory itself after which its content is unknown */
+#define DIR_WATCH_LOST (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT)
+
+/* Reload is cheaper than restat of more names */
+#define DIR_WATCH_MAX_NAMES 16384
+
+/* Magic numbers of network file systems */
+#define DIR_WATCH_NFS_MAGIC 0x6969
+#define DIR_WATCH_SMB_MAGIC 0x517B
+#define DIR_WATCH_CIFS_MAGIC 0xFF534D42
+#define DIR_WATCH_SMB2_MAGIC 0xFE534D42
+#define DIR_WATCH_FUSE_MAGIC 0x65735546
+#define DIR_WATCH_CEPH_MAGIC 0x00C36400
+#define DIR_WATCH_AFS_MAGIC 0x5346414F
+#define DIR_WATCH_9P_MAGIC 0x01021997
+
+/*** file scope type declarations ****************************************************************/
+
+struct dir_watch_t
+{
+    /* inotify instance */
+    int fd;
+    vfs_path_t *vpath;
+    /* names changed since the last call of dir_watch_take_changes() */
+    GHashTable *names;
+    /* changes are unknown */
+    gboolean lost;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+dir_watch_is_remote (const char *path)
+{
+    struct statfs sfs;
+
+    if (statfs (path, &sfs) != 0)
+        return TRUE;
+
+    switch ((guint32) sfs.f_type)
+    {
+    case DIR_WATCH_NFS_MAGIC:
+    case DIR_WATCH_SMB_MAGIC:
+    case DIR_WATCH_CIFS_MAGIC:
+    case DIR_WATCH_SMB2_MAGIC:
+    case DIR_WATCH_FUSE_MAGIC:
+    case DIR_WATCH_CEPH_MAGIC:
+    case DIR_WATCH_AFS_MAGIC:
+    case DIR_WATCH_9P_MAGIC:
+        return TRUE;
+    default:
+        return FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+dir_watch_add_event (dir_watch_t *watch, const struct inotify_event *event)
+{
+    if ((event->mask & DIR_WATCH_LOST) != 0)
+        watch->lost = TRUE;
+    else if (event->len != 0 && event->name[0] != '\0')
+    {
+        if (g_hash_table_size (watch->names) >= DIR_WATCH_MAX_NAMES)
+            watch->lost = TRUE;
+        else if (!g_hash_table_contains (watch->names, event->name))
+            g_hash_table_add (watch->names, g_strdup (event->name));
+    }
+
+    /* names are useless if changes are unknown */
+    if (watch->lost)
+        g_hash_table_remove_all (watch->names);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read all queued events.
+ */
+
+static void
+dir_watch_read (dir_watch_t *watch)
+{
+    union
+    {
+        struct inotify_event event;
+        char buf[16 * 1024];
+    } events;
+
+    while (!watch->lost)
+    {
+        ssize_t n;
+        char *p;
+
+        n = read (watch->fd, events.buf, sizeof (events.buf));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        for (p = events.buf; p < events.buf + n && !watch->lost;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *) p;
+
+            dir_watch_add_event (watch, event);
+            p += sizeof (struct inotify_event) + event->len;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+dir_watch_callback (int fd, void *info)
+{
+    dir_watch_t *watch = (dir_watch_t *) info;
+
+    (void) fd;
+
+    dir_watch_read (watch);
+
+    /* nothing to watch anymore, keep the state until the panel takes it */
+    if (watch->lost)
+        delete_select_channel (watch->fd);
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start to watch changes of local directory. Changes made before this call are not reported,
+ * so the directory should be watched before it is read.
+ *
+ * @param vpath directory path
+ *
+ * @return new watch, NULL if directory is not local or cannot be watched
+ */
+
+dir_watch_t *
+dir_watch_new (const vfs_path_t *vpath)
+{
+    dir_watch_t *watch;
+    const char *path;
+    int fd;
+
+    if (vpath == NULL || !vfs_file_is_local (vpath))
+        return NULL;
+
+    path = vfs_path_get_last_path_str (vpath);
+    if (dir_watch_is_remote (path))
+        return NULL;
+
+    fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    if (inotify_add_watch (fd, path, DIR_WATCH_EVENTS) < 0)
+    {
+        close (fd);
+        return NULL;
+    }
+
+    watch = g_new (dir_watch_t, 1);
+    watch->fd = fd;
+    watch->vpath = vfs_path_clone (vpath);
+    watch->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    watch->lost = FALSE;
+
+    add_select_channel (fd, dir_watch_callback, watch);
+
+    return watch;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+dir_watch_free (dir_watch_t *watch)
+{
+    if (watch == NULL)
+        return;
+
+    delete_select_channel (watch->fd);
+    close (watch->fd);
+    vfs_path_free (watch->vpath, TRUE);
+    g_hash_table_destroy (watch->names);
+    g_free (watch);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+dir_watch_is_for (const dir_watch_t *watch, const vfs_path_t *vpath)
+{
+    return watch != NULL && vfs_path_equal (watch->vpath, vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take names changed since the last call. Name of removed entry is reported as well as name
+ * of new or changed one, so each of them should be stat'ed again.
+ *
+ * @param watch directory watch
+ * @param names set of changed names, NULL if there are no changes. Caller should free it
+ *
+ * @return TRUE if changes are known, FALSE if the directory must be reloaded. The watch is
+ *         useless then and should be created again
+ */
+
+gboolean
+dir_watch_take_changes (dir_watch_t *watch, GHashTable **names)
+{
+    *names = NULL;
+
+    dir_watch_read (watch);
+
+    if (watch->lost)
+        return FALSE;
+
+    if (g_hash_table_size (watch->names) != 0)
+    {
+        *names = watch->names;
+        watch->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_DIR_WATCH */
@@ -0,0 +1,35 @@
+/** \file  dirwatch.h
+ *  \brief Header: watch of changes of local directories
+ */
+
+#ifndef MC__DIRWATCH_H
+#define MC__DIRWATCH_H
+
+#include "lib/global.h"
+#include "lib/vfs/vfs.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+#if defined(__linux__) && defined(HAVE_SYS_INOTIFY_H)
+#define ENABLE_DIR_WATCH 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct dir_watch_t dir_watch_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+dir_watch_t *dir_watch_new (const vfs_path_t * vpath);
+void dir_watch_free (dir_watch_t * watch);
+
+gboolean dir_watch_is_for (const dir_watch_t * watch, const vfs_path_t * vpath);
+gboolean dir_watch_take_changes (dir_watch_t * watch, GHashTable ** names);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__DIRWATCH_H */
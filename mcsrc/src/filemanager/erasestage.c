@@ -0,0 +1,556 @@
+/*
+   Delete by rename into staging directory and background reclaim.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  erasestage.c
+ *  \brief Source: delete by rename into staging directory and background reclaim
+ *
+ *  A directory tree to delete is renamed into a staging directory on the same file system,
+ *  which takes constant time regardless of the tree size. The staged trees are removed by
+ *  a thread with idle I/O priority.
+ *
+ *  The staging directory of file system is "erase" in the cache directory if the cache is
+ *  on that file system, or ".mc-erase-<uid>" in the root of file system otherwise. Each
+ *  staged tree is put into a new subdirectory with unique name, so trees with the same
+ *  name don't collide. Staging directories are listed in the "erasestage" file in the cache
+ *  directory; trees which were not removed before mc exited are removed on the next start.
+ *
+ *  VFS is not thread-safe, so only local files are staged and the thread uses only plain
+ *  system calls.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/fileloc.h"
+#include "lib/mcconfig.h"       /* mc_config_get_cache_path() */
+
+#include "iosched.h"            /* io_priority_set_idle() */
+
+#include "erasestage.h"
+
+#ifdef ENABLE_ERASE_STAGE
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define ERASE_STAGE_CACHE_DIR "erase"
+#define ERASE_STAGE_ROOT_DIR ".mc-erase-"
+
+/* maximum number of directories nftw() keeps open */
+#define ERASE_STAGE_MAX_FDS 16
+
+/*** file scope type declarations ****************************************************************/
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* dev_t -> staging directory of file system */
+static GHashTable *stage_dirs = NULL;
+
+/* staged trees to remove, stage_stop ends the thread */
+static GAsyncQueue *stage_queue = NULL;
+static GThread *stage_thread = NULL;
+static gint stage_cancelled = 0;
+static char stage_stop[] = "";
+
+/* staged trees which cannot be removed, to report them to user */
+static GAsyncQueue *stage_failed = NULL;
+
+/* number of directories made accessible by the last pass, used by the thread only */
+static int stage_unlocked = 0;
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static char *
+erase_stage_registry_path (void)
+{
+    return g_build_filename (mc_config_get_cache_path (), MC_ERASE_STAGE_FILE, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that staging directory is not a symlink and is not accessible for other users.
+ */
+
+static gboolean
+erase_stage_dir_is_valid (const char *path, struct stat *st)
+{
+    return lstat (path, st) == 0 && S_ISDIR (st->st_mode) && st->st_uid == getuid ()
+        && (st->st_mode & (S_IRWXG | S_IRWXO)) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+erase_stage_dirs_add (dev_t dev, const char *path)
+{
+    gint64 *key;
+
+    if (stage_dirs == NULL)
+        stage_dirs = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, g_free);
+
+    key = g_new (gint64, 1);
+    *key = (gint64) dev;
+    g_hash_table_replace (stage_dirs, key, g_strdup (path));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+erase_stage_registry_append (const char *path)
+{
+    char *registry, *escaped;
+    FILE *f;
+
+    registry = erase_stage_registry_path ();
+    f = fopen (registry, "a");
+    g_free (registry);
+    if (f == NULL)
+        return;
+
+    escaped = g_strescape (path, NULL);
+    fprintf (f, "%s\n", escaped);
+    g_free (escaped);
+    fclose (f);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create staging directory if it doesn't exist.
+ *
+ * @return TRUE if directory is usable for staging files of device dev
+ */
+
+static gboolean
+erase_stage_dir_make (const char *path, dev_t dev)
+{
+    struct stat st;
+
+    if (mkdir (path, S_IRWXU) != 0 && errno != EEXIST)
+        return FALSE;
+
+    return erase_stage_dir_is_valid (path, &st) && st.st_dev == dev;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Find root of file system which contains path: the topmost parent on the same device.
+ */
+
+static char *
+erase_stage_fs_root (const char *path, dev_t dev)
+{
+    char *root;
+
+    root = g_path_get_dirname (path);
+
+    while (TRUE)
+    {
+        char *parent;
+        struct stat st;
+
+        parent = g_path_get_dirname (root);
+        if (strcmp (parent, root) == 0 || stat (parent, &st) != 0 || st.st_dev != dev)
+        {
+            g_free (parent);
+            break;
+        }
+
+        g_free (root);
+        root = parent;
+    }
+
+    return root;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get staging directory for path located on device dev. Create it if needed.
+ *
+ * @return staging directory, NULL if there is no usable one. Owned by the module.
+ */
+
+static const char *
+erase_stage_get_dir (const char *path, dev_t dev)
+{
+    const gint64 key = (gint64) dev;
+    const char *cached;
+    char *stage = NULL;
+    struct stat st;
+
+    if (stage_dirs != NULL)
+    {
+        cached = (const char *) g_hash_table_lookup (stage_dirs, &key);
+        if (cached != NULL && erase_stage_dir_is_valid (cached, &st) && st.st_dev == dev)
+            return cached;
+    }
+
+    /* prefer the cache directory to keep roots of file systems clean */
+    if (stat (mc_config_get_cache_path (), &st) == 0 && st.st_dev == dev)
+    {
+        stage =
+            g_build_filename (mc_config_get_cache_path (), ERASE_STAGE_CACHE_DIR, (char *) NULL);
+        if (!erase_stage_dir_make (stage, dev))
+            MC_PTR_FREE (stage);
+    }
+
+    if (stage == NULL)
+    {
+        char *root, *name;
+
+        root = erase_stage_fs_root (path, dev);
+        name = g_strdup_printf ("%s%lu", ERASE_STAGE_ROOT_DIR, (unsigned long) getuid ());
+        stage = g_build_filename (root, name, (char *) NULL);
+        g_free (name);
+        g_free (root);
+
+        if (!erase_stage_dir_make (stage, dev))
+            MC_PTR_FREE (stage);
+    }
+
+    if (stage == NULL)
+        return NULL;
+
+    if (stage_dirs == NULL || !g_hash_table_contains (stage_dirs, &key))
+        erase_stage_registry_append (stage);
+
+    erase_stage_dirs_add (dev, stage);
+    g_free (stage);
+
+    return (const char *) g_hash_table_lookup (stage_dirs, &key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+erase_stage_remove_cb (const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+    (void) sb;
+    (void) typeflag;
+    (void) ftwbuf;
+
+    /* failures are found by the caller: the tree still exists */
+    (void) remove (fpath);
+
+    return g_atomic_int_get (&stage_cancelled);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Make directory writable and searchable for owner, so its entries can be removed.
+ */
+
+static int
+erase_stage_unlock_cb (const char *fpath, const struct stat *sb, int typeflag, struct FTW *ftwbuf)
+{
+    (void) ftwbuf;
+
+    if ((typeflag == FTW_D || typeflag == FTW_DNR) && (sb->st_mode & S_IRWXU) != S_IRWXU
+        && chmod (fpath, (sb->st_mode & 07777) | S_IRWXU) == 0)
+        stage_unlocked++;
+
+    return g_atomic_int_get (&stage_cancelled);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove staged tree. If some entries cannot be removed, read-only directories are made
+ * writable and the tree is removed again. Unreadable directories are not entered by the
+ * walk, so it is repeated while it makes more directories accessible.
+ *
+ * @return FALSE if the tree cannot be removed completely
+ */
+
+static gboolean
+erase_stage_remove_tree (const char *path)
+{
+    struct stat st;
+
+    while (TRUE)
+    {
+        /* don't descend into file systems mounted inside the staged tree */
+        (void) nftw (path, erase_stage_remove_cb, ERASE_STAGE_MAX_FDS,
+                     FTW_DEPTH | FTW_PHYS | FTW_MOUNT);
+
+        if (lstat (path, &st) != 0 || g_atomic_int_get (&stage_cancelled) != 0)
+            return TRUE;
+
+        stage_unlocked = 0;
+        (void) nftw (path, erase_stage_unlock_cb, ERASE_STAGE_MAX_FDS, FTW_PHYS | FTW_MOUNT);
+
+        /* the rest is immutable, busy or belongs to other user */
+        if (stage_unlocked == 0)
+            return FALSE;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gpointer
+erase_stage_thread (gpointer data)
+{
+    char *path;
+
+    (void) data;
+
+    /* applies to the calling thread only */
+    (void) io_priority_set_idle ();
+
+    while ((path = (char *) g_async_queue_pop (stage_queue)) != stage_stop)
+    {
+        if (g_atomic_int_get (&stage_cancelled) == 0 && !erase_stage_remove_tree (path))
+            g_async_queue_push (stage_failed, path);
+        else
+            g_free (path);
+    }
+
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue staged tree for removal. Start the thread if it is not running.
+ */
+
+static void
+erase_stage_reclaim (char *path)
+{
+    if (stage_queue == NULL)
+    {
+        stage_queue = g_async_queue_new ();
+        stage_failed = g_async_queue_new_full (g_free);
+    }
+
+    g_async_queue_push (stage_queue, path);
+
+    /* if thread cannot be started the tree is removed on the next start */
+    if (stage_thread == NULL)
+        stage_thread = g_thread_try_new ("erasestage", erase_stage_thread, NULL, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue all trees left in staging directory by previous session.
+ *
+ * @return TRUE if staging directory is still usable
+ */
+
+static gboolean
+erase_stage_recover (const char *stage)
+{
+    struct stat st;
+    GDir *dir;
+    const char *name;
+
+    if (!erase_stage_dir_is_valid (stage, &st))
+        return FALSE;
+
+    dir = g_dir_open (stage, 0, NULL);
+    if (dir == NULL)
+        return FALSE;
+
+    while ((name = g_dir_read_name (dir)) != NULL)
+        erase_stage_reclaim (g_build_filename (stage, name, (char *) NULL));
+
+    g_dir_close (dir);
+
+    erase_stage_dirs_add (st.st_dev, stage);
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remove trees staged by previous sessions and drop staging directories which no longer
+ * exist from the registry.
+ */
+
+void
+erase_stage_init (void)
+{
+    char *registry, *contents = NULL;
+    char **lines;
+    GString *valid;
+    int i;
+
+    registry = erase_stage_registry_path ();
+
+    if (!g_file_get_contents (registry, &contents, NULL, NULL))
+    {
+        g_free (registry);
+        return;
+    }
+
+    valid = g_string_new ("");
+    lines = g_strsplit (contents, "\n", -1);
+    g_free (contents);
+
+    for (i = 0; lines[i] != NULL; i++)
+    {
+        char *stage;
+
+        if (lines[i][0] == '\0')
+            continue;
+
+        stage = g_strcompress (lines[i]);
+        if (erase_stage_recover (stage))
+            g_string_append_printf (valid, "%s\n", lines[i]);
+        g_free (stage);
+    }
+
+    g_strfreev (lines);
+
+    if (valid->len == 0)
+        unlink (registry);
+    else
+        (void) g_file_set_contents (registry, valid->str, (gssize) valid->len, NULL);
+
+    g_string_free (valid, TRUE);
+    g_free (registry);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop the reclaim thread. Trees which are not removed yet stay in staging directories
+ * until the next start.
+ */
+
+void
+erase_stage_done (void)
+{
+    if (stage_thread != NULL)
+    {
+        /* trees queued before the stop marker are skipped */
+        g_atomic_int_set (&stage_cancelled, 1);
+        g_async_queue_push (stage_queue, stage_stop);
+        g_thread_join (stage_thread);
+        stage_thread = NULL;
+    }
+
+    if (stage_queue != NULL)
+    {
+        char *path;
+
+        while ((path = (char *) g_async_queue_try_pop (stage_queue)) != NULL)
+            if (path != stage_stop)
+                g_free (path);
+
+        g_async_queue_unref (stage_queue);
+        stage_queue = NULL;
+        g_async_queue_unref (stage_failed);
+        stage_failed = NULL;
+    }
+
+    if (stage_dirs != NULL)
+    {
+        g_hash_table_destroy (stage_dirs);
+        stage_dirs = NULL;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Move local file or directory into staging directory of its file system and queue it
+ * for removal in the background.
+ *
+ * @param path local path
+ *
+ * @return TRUE if path is moved away, FALSE if it cannot be staged and should be removed
+ *         in the usual way
+ */
+
+gboolean
+erase_stage_move (const char *path)
+{
+    struct stat st;
+    const char *stage;
+    char *holder, *name, *target;
+    gboolean ok;
+
+    /* reclaim thread of the parent process doesn't exist in the background process */
+    if (mc_global.we_are_background || lstat (path, &st) != 0)
+        return FALSE;
+
+    stage = erase_stage_get_dir (path, st.st_dev);
+    if (stage == NULL)
+        return FALSE;
+
+    holder = g_build_filename (stage, "XXXXXX", (char *) NULL);
+    if (g_mkdtemp (holder) == NULL)
+    {
+        g_free (holder);
+        return FALSE;
+    }
+
+    name = g_path_get_basename (path);
+    target = g_build_filename (holder, name, (char *) NULL);
+    g_free (name);
+
+    /* fails if path contains the staging directory or crosses a mount point */
+    ok = rename (path, target) == 0;
+    g_free (target);
+
+    if (ok)
+        erase_stage_reclaim (holder);
+    else
+    {
+        rmdir (holder);
+        g_free (holder);
+    }
+
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get staged tree which cannot be removed by the reclaim thread. It stays in the staging
+ * directory and its removal is retried on the next start.
+ *
+ * @return path of the tree, NULL if there are no such trees. Caller should free it
+ */
+
+char *
+erase_stage_get_failed (void)
+{
+    if (stage_failed == NULL)
+        return NULL;
+
+    return (char *) g_async_queue_try_pop (stage_failed);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_ERASE_STAGE */
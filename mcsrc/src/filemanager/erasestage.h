@@ -0,0 +1,33 @@
+/** \file  erasestage.h
+ *  \brief Header: delete by rename into staging directory and background reclaim
+ */
+
+#ifndef MC__ERASESTAGE_H
+#define MC__ERASESTAGE_H
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* Reclaim thread uses the POSIX file API directly bypassing VFS */
+#ifndef WIN32
+#define ENABLE_ERASE_STAGE 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+void erase_stage_init (void);
+void erase_stage_done (void);
+
+gboolean erase_stage_move (const char *path);
+char *erase_stage_get_failed (void);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__ERASESTAGE_H */
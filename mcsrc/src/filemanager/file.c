@@ -74,6 +74,9 @@
 #ifdef ENABLE_BACKGROUND
 #include "src/background.h"     /* do_background() */
 #endif
+#ifdef ENABLE_VFS_SFTP
+#include "src/vfs/sftpfs/sftpfs.h"      /* sftpfs_transfer_new() */
+#endif
 
 /* Needed for other_panel and WTree */
 #include "dir.h"
@@ -82,6 +85,14 @@
 #include "filemanager.h"        /* other_panel */
 #include "layout.h"             /* rotate_dash() */
 #include "ioblksize.h"          /* io_blksize() */
+#include "copyhash.h"
+#include "copyjournal.h"
+#include "copypipe.h"
+#include "copypool.h"
+#include "erasestage.h"
+#include "direrase.h"
+#include "dirscan.h"
+#include "iosched.h"
 
 #include "file.h"
 
@@ -102,6 +113,24 @@ const char *op_names[3] = {
 #define FILEOP_STALLING_INTERVAL 4
 #define FILEOP_UPDATE_INTERVAL_US (FILEOP_UPDATE_INTERVAL * G_USEC_PER_SEC)
 #define FILEOP_STALLING_INTERVAL_US (FILEOP_STALLING_INTERVAL * G_USEC_PER_SEC)
+/* max size of data copied in the kernel at once, between progress updates */
+#define FILEOP_KERNEL_COPY_CHUNK (8 * 1024 * 1024)
+/* max number of queued files per worker thread of parallel copy */
+#define FILEOP_POOL_JOBS_PER_WORKER 16
+/* number of threads to clone files if parallel copy is not requested */
+#define FILEOP_CLONE_WORKERS 4
+/* how long to wait for copied files before check of progress buttons */
+#define FILEOP_POOL_WAIT_US (G_USEC_PER_SEC / 10)
+/* streaming copy: size of file part which is written out and dropped from the page cache */
+#define FILEOP_STREAM_CHUNK (8 * 1024 * 1024)
+/* alignment of buffer, file offset and I/O size for the direct I/O */
+#define FILEOP_DIRECT_IO_ALIGN 4096
+/* Checksum to verify copied files */
+#define FILEOP_VERIFY_CHECKSUM G_CHECKSUM_SHA256
+/* Copied size of large file is saved in the journal after each this number of bytes */
+#define FILEOP_JOURNAL_CHECKPOINT (64 * 1024 * 1024)
+/* smaller files are rewritten entirely by the update copy */
+#define FILEOP_DELTA_MIN_SIZE (1024 * 1024)
 
 /*** file scope type declarations ****************************************************************/
 
@@ -137,6 +166,37 @@ typedef enum
     HARDLINK_ABORT              /**< Stop file operation after hardlink creation error */
 } hardlink_status_t;
 
+/* Whether data blocks can be shared with the target file system */
+typedef enum
+{
+    CLONE_UNKNOWN = 0,          /**< Not tried yet */
+    CLONE_SUPPORTED,            /**< File was cloned successfully */
+    CLONE_UNSUPPORTED           /**< File system doesn't support cloning */
+} clone_support_t;
+
+#if defined(ENABLE_COPY_POOL) || defined(ENABLE_SFTPFS_TRANSFER)
+/* File copied by another thread */
+typedef struct
+{
+    const char *src_path;
+    const char *dst_path;
+    mc_off_t size;
+    gboolean cloned;            /**< Target shares data blocks with the source */
+    int error;                  /**< errno of failed copy, 0 if file is copied */
+} file_pool_done_t;
+
+/* Threads which copy files: the thread pool or parallel SFTP connections */
+typedef struct
+{
+    /* pop finished job and describe it in @done, NULL if no job is finished during @timeout */
+    gpointer (*get) (file_op_context_t * ctx, gint64 timeout, file_pool_done_t * done);
+    /* free the job popped by get() */
+    void (*finish) (gpointer job);
+    gboolean (*is_cancelled) (file_op_context_t * ctx);
+    void (*cancel) (file_op_context_t * ctx);
+} file_pool_ops_t;
+#endif
+
 /*
  * This array introduced to avoid translation problems. The former (op_names)
  * is assumed to be nouns, suitable in dialog box titles; this one should
@@ -181,7 +241,7 @@ static const char *prompt_parts[] = {
 /*** file scope variables ************************************************************************/
 
 /* the hard link cache */
-static GSList *linklist = NULL;
+static GHashTable *linklist = NULL;
 
 /* the files-to-be-erased list */
 static GQueue *erase_list = NULL;
@@ -190,7 +250,7 @@ static GQueue *erase_list = NULL;
  * This list holds information about just created target directories and is used to detect
  * when an directory is copied into itself (we don't want to copy infinitely).
  */
-static GSList *dest_dirs = NULL;
+static GHashTable *dest_dirs = NULL;
 
 /* --------------------------------------------------------------------------------------------- */
 /*** file scope functions ************************************************************************/
@@ -262,7 +322,11 @@ build_dest (file_op_context_t *ctx, const char *src, const char *dest, FileProgr
     }
     else
     {
-        q = mc_search_prepare_replace_str2 (ctx->search_handle, ctx->dest_mask);
+        /* mask is compiled once for all files of the operation */
+        if (ctx->dest_mask_replace == NULL)
+            ctx->dest_mask_replace = mc_search_replace_new (ctx->search_handle, ctx->dest_mask);
+
+        q = mc_search_replace_apply (ctx->search_handle, ctx->dest_mask_replace);
         if (ctx->search_handle->error != MC_SEARCH_E_OK)
         {
             if (ctx->search_handle->error_str != NULL)
@@ -278,7 +342,11 @@ build_dest (file_op_context_t *ctx, const char *src, const char *dest, FileProgr
     {
         char *repl_dest;
 
-        repl_dest = mc_search_prepare_replace_str2 (ctx->search_handle, dest);
+        /* destination is the same for all files of the operation */
+        if (ctx->dest_replace == NULL)
+            ctx->dest_replace = mc_search_replace_new (ctx->search_handle, dest);
+
+        repl_dest = mc_search_replace_apply (ctx->search_handle, ctx->dest_replace);
         if (ctx->search_handle->error == MC_SEARCH_E_OK)
             s = mc_build_filename (repl_dest, q, (char *) NULL);
         else
@@ -323,15 +391,71 @@ free_erase_list (GQueue *lp)
 /* --------------------------------------------------------------------------------------------- */
 
 static inline void *
-free_linklist (GSList *lp)
+free_linklist (GHashTable *lp)
 {
-    g_slist_free_full (lp, free_link);
+    if (lp != NULL)
+        g_hash_table_destroy (lp);
 
     return NULL;
 }
 
 /* --------------------------------------------------------------------------------------------- */
 
+static guint
+link_hash (gconstpointer key)
+{
+    const link_t *lnk = (const link_t *) key;
+    guint64 h;
+
+    h = (guint64) lnk->ino * 31 + (guint64) lnk->dev;
+    return g_direct_hash (lnk->vfs) ^ (guint) (h ^ (h >> 32));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+link_equal (gconstpointer a, gconstpointer b)
+{
+    const link_t *la = (const link_t *) a;
+    const link_t *lb = (const link_t *) b;
+
+    return (la->vfs == lb->vfs && la->ino == lb->ino && la->dev == lb->dev);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Add an inode to the hash of links. The hash is created if it doesn't exist.
+ * The hash takes ownership of the link.
+ */
+
+static void
+add_to_linklist (GHashTable **lp, link_t *lnk)
+{
+    if (*lp == NULL)
+        *lp = g_hash_table_new_full (link_hash, link_equal, free_link, NULL);
+
+    g_hash_table_add (*lp, lnk);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static const link_t *
+find_in_linklist (GHashTable *lp, const vfs_path_t *vpath, const mc_stat_t *sb)
+{
+    link_t key;
+
+    if (lp == NULL)
+        return NULL;
+
+    key.vfs = vfs_path_get_last_path_vfs (vpath);
+    key.ino = sb->st_ino;
+    key.dev = sb->st_dev;
+
+    return (const link_t *) g_hash_table_lookup (lp, &key);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static const link_t *
 is_in_linklist (const GSList *lp, const vfs_path_t *vpath, const mc_stat_t *sb)
 {
@@ -373,7 +497,7 @@ check_hardlinks (file_op_context_t *ctx, const vfs_path_t *src_vpath, const mc_s
     if ((vfs_file_class_flags (src_vpath) & VFSF_NOLINKS) != 0)
         return HARDLINK_UNSUPPORTED;
 
-    lnk = (link_t *) is_in_linklist (linklist, src_vpath, src_stat);
+    lnk = (link_t *) find_in_linklist (linklist, src_vpath, src_stat);
     if (lnk != NULL)
     {
         int stat_result;
@@ -484,7 +608,7 @@ check_hardlinks (file_op_context_t *ctx, const vfs_path_t *src_vpath, const mc_s
         lnk->src_vpath = vfs_path_clone (src_vpath);
         lnk->dst_vpath = vfs_path_clone (dst_vpath);
 
-        linklist = g_slist_prepend (linklist, lnk);
+        add_to_linklist (&linklist, lnk);
     }
 
     return HARDLINK_CACHED;
@@ -747,6 +871,94 @@ panel_compute_totals (const WPanel *panel, dirsize_status_msg_t *sm, size_t *ret
 
 /* --------------------------------------------------------------------------------------------- */
 
+#ifdef ENABLE_DIR_SCAN
+/**
+ * Start computation of totals in the background thread. The scan is used for copy and move of
+ * local files only: listings of scanned directories are reused by copy_dir_dir().
+ *
+ * @return TRUE if the scan is started, FALSE otherwise
+ */
+
+static gboolean
+panel_operate_start_scan (const WPanel *panel, const vfs_path_t *source,
+                          const mc_stat_t *source_stat, file_op_context_t *ctx)
+{
+    dir_scan_t *scan;
+
+    if (!file_op_background_totals || ctx->operation == OP_DELETE
+        || !vfs_file_is_local (source != NULL ? source : panel->cwd_vpath))
+        return FALSE;
+
+    scan = dir_scan_new (ctx->follow_links);
+
+    if (source == NULL)
+    {
+        int i;
+
+        for (i = 0; i < panel->dir.len; i++)
+        {
+            const file_entry_t *fe = &panel->dir.list[i];
+
+            if (fe->f.marked == 0)
+                continue;
+
+            if (S_ISDIR (fe->st.st_mode)
+                || (ctx->follow_links && link_isdir (fe) && fe->f.stale_link == 0))
+            {
+                vfs_path_t *p;
+
+                p = vfs_path_append_new (panel->cwd_vpath, fe->fname->str, (char *) NULL);
+                dir_scan_add_dir (scan, vfs_path_as_str (p));
+                vfs_path_free (p, TRUE);
+            }
+            else
+                dir_scan_add_file (scan, (uintmax_t) fe->st.st_size);
+        }
+    }
+    else
+    {
+        gboolean stale_link = FALSE;
+
+        if (S_ISDIR (source_stat->st_mode)
+            || (ctx->follow_links
+                && file_is_symlink_to_dir (source, (mc_stat_t *) source_stat, &stale_link)
+                && !stale_link))
+            dir_scan_add_dir (scan, vfs_path_as_str (source));
+        else
+            dir_scan_add_file (scan, (uintmax_t) source_stat->st_size);
+    }
+
+    if (!dir_scan_start (scan))
+    {
+        dir_scan_free (scan);
+        return FALSE;
+    }
+
+    ctx->dir_scan = scan;
+    ctx->totals_computed = TRUE;
+    ctx->totals_partial = !dir_scan_get_totals (scan, &ctx->total_count, &ctx->total_bytes);
+
+    return TRUE;
+}
+#endif /* ENABLE_DIR_SCAN */
+
+/* --------------------------------------------------------------------------------------------- */
+/** Get totals computed by the background scan for the moment */
+
+static void
+file_op_update_totals (file_op_context_t *ctx)
+{
+#ifdef ENABLE_DIR_SCAN
+    if (ctx->totals_partial && ctx->dir_scan != NULL)
+        ctx->totals_partial =
+            !dir_scan_get_totals (ctx->dir_scan, &ctx->total_count, &ctx->total_bytes);
+#else
+    (void) ctx;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 /** Initialize variables for progress bars */
 static FileProgressStatus
 panel_operate_init_totals (const WPanel *panel, const vfs_path_t *source,
@@ -760,7 +972,17 @@ panel_operate_init_totals (const WPanel *panel, const vfs_path_t *source,
         return FILE_CONT;
 #endif
 
-    if (verbose && compute_totals)
+#ifdef ENABLE_DIR_SCAN
+    dir_scan_free (ctx->dir_scan);
+    ctx->dir_scan = NULL;
+#endif
+    ctx->totals_partial = FALSE;
+
+    if (verbose && compute_totals
+#ifdef ENABLE_DIR_SCAN
+        && !panel_operate_start_scan (panel, source, source_stat, ctx)
+#endif
+        )
     {
         dirsize_status_msg_t dsm;
         gboolean stale_link = FALSE;
@@ -800,6 +1022,8 @@ panel_operate_init_totals (const WPanel *panel, const vfs_path_t *source,
         if (status == FILE_SKIP)
             status = FILE_CONT;
     }
+    else if (verbose && compute_totals)
+        status = FILE_CONT;     /* totals are computed in the background */
     else
     {
         status = FILE_CONT;
@@ -830,6 +1054,12 @@ progress_update_one (gboolean success, file_op_context_t *ctx, mc_off_t add)
     if (!success)
         return;
 
+    file_op_update_totals (ctx);
+
+#ifdef ENABLE_BACKGROUND
+    background_report_progress (ctx->total_progress_bytes, ctx->total_bytes, ctx->total_bps);
+#endif
+
     tv_current = g_get_monotonic_time ();
 
     if (tv_start < 0)
@@ -1162,6 +1392,8 @@ calc_copy_file_progress (file_op_context_t *ctx, gint64 tv_current, mc_off_t fil
     /* Update rotating dash after some time */
     rotate_dash (TRUE);
 
+    file_op_update_totals (ctx);
+
     /* Compute ETA */
     dt = (tv_current - ctx->pauses - ctx->transfer_start) / (double) G_USEC_PER_SEC;
 
@@ -1190,6 +1422,37 @@ calc_copy_file_progress (file_op_context_t *ctx, gint64 tv_current, mc_off_t fil
     }
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check whether file is copied already by the interrupted operation which is resumed now.
+ * The target could be removed or changed after the interruption, so it must still be a regular
+ * file of the copied size. Otherwise the record is dropped and the file is copied again.
+ *
+ * @param done_size where the size of copied file is stored
+ */
+
+static gboolean
+copy_journal_check_done (file_op_context_t *ctx, const char *src_path, const char *dst_path,
+                         uintmax_t *done_size)
+{
+    vfs_path_t *dst_vpath;
+    mc_stat_t dst_stat;
+    gboolean ok;
+
+    if (ctx->journal == NULL || !copy_journal_is_done (ctx->journal, src_path, done_size))
+        return FALSE;
+
+    dst_vpath = vfs_path_from_str (dst_path);
+    ok = mc_lstat (dst_vpath, &dst_stat) == 0 && S_ISREG (dst_stat.st_mode)
+        && (uintmax_t) dst_stat.st_size == *done_size;
+    vfs_path_free (dst_vpath, TRUE);
+
+    if (!ok)
+        copy_journal_forget (ctx->journal, src_path);
+
+    return ok;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static gboolean
@@ -1231,6 +1494,8 @@ move_file_file (const WPanel *panel, file_op_context_t *ctx, const char *s, cons
     gboolean copy_done = FALSE;
     gboolean old_ask_overwrite;
     vfs_path_t *src_vpath, *dst_vpath;
+    uintmax_t done_size;
+    mc_off_t resume_offset;
 
     src_vpath = vfs_path_from_str (s);
     dst_vpath = vfs_path_from_str (d);
@@ -1263,6 +1528,10 @@ move_file_file (const WPanel *panel, file_op_context_t *ctx, const char *s, cons
             goto ret;
     }
 
+    /* file is copied already by the interrupted operation which is resumed now */
+    if (copy_journal_check_done (ctx, s, d, &done_size))
+        goto retry_src_remove;
+
     if (mc_lstat (dst_vpath, &dst_stat) == 0)
     {
         if (check_same_file (ctx, s, &src_stat, d, &dst_stat, &return_status))
@@ -1276,7 +1545,10 @@ move_file_file (const WPanel *panel, file_op_context_t *ctx, const char *s, cons
             goto ret;
         }
 
-        if (confirm_overwrite)
+        /* partially copied file is continued by copy_file_file() */
+        if (confirm_overwrite
+            && (ctx->journal == NULL
+                || !copy_journal_get_partial (ctx->journal, s, &resume_offset)))
         {
             return_status = query_replace (ctx, s, &src_stat, d, &dst_stat);
             if (return_status != FILE_CONT)
@@ -1501,6 +1773,47 @@ recursive_erase (file_op_context_t *ctx, const vfs_path_t *vpath)
     return try_erase_dir (ctx, vpath);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef ENABLE_DIR_ERASE
+/**
+ * Remove content of local directory by worker threads. Entries which cannot be removed
+ * are left for recursive_erase() which asks user what to do with them.
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+erase_dir_fast (file_op_context_t *ctx, const vfs_path_t *vpath)
+{
+    dir_erase_t *erase;
+    FileProgressStatus status = FILE_CONT;
+    size_t removed = 0;
+    gboolean finished = FALSE;
+
+    erase = dir_erase_start (vfs_path_as_str (vpath));
+    if (erase == NULL)
+        return FILE_CONT;
+
+    while (!finished && status != FILE_ABORT)
+    {
+        size_t count;
+
+        finished = dir_erase_wait (erase, FILEOP_POOL_WAIT_US, &count);
+        ctx->total_progress_count += count - removed;
+        removed = count;
+
+        file_progress_show_deleting (ctx, vpath, NULL);
+        file_progress_show_count (ctx);
+        mc_refresh ();
+        status = file_progress_check_buttons (ctx);
+    }
+
+    dir_erase_free (erase);
+
+    return status == FILE_ABORT ? FILE_ABORT : FILE_CONT;
+}
+#endif /* ENABLE_DIR_ERASE */
+
 /* --------------------------------------------------------------------------------------------- */
 /**
   * Check if directory is empty or not.
@@ -1960,6 +2273,118 @@ panel_operate_generate_prompt (const WPanel *panel, FileOperation operation,
     return format_string;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open the manifest file to append checksums of verified files to.
+ */
+static void
+panel_operate_open_manifest (file_op_context_t *ctx)
+{
+    char *path;
+
+    if (ctx->verify_manifest != NULL || copymove_verify_manifest == NULL
+        || copymove_verify_manifest[0] == '\0')
+        return;
+
+    path = tilde_expand (copymove_verify_manifest);
+    ctx->verify_manifest = fopen (path, "a");
+    if (ctx->verify_manifest == NULL)
+        message (D_ERROR, MSG_ERROR, _("Cannot open checksum manifest \"%s\"\n%s"), path,
+                 unix_error_string (errno));
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start the journal of copy or move. If the same operation was interrupted before,
+ * ask user whether to resume it.
+ */
+static copy_journal_t *
+panel_operate_open_journal (const WPanel *panel, file_op_context_t *ctx, const char *source,
+                            const char *dest)
+{
+    GString *key;
+    gboolean resume = FALSE;
+    copy_journal_t *journal;
+
+    key = g_string_new (NULL);
+    g_string_printf (key, "%d\n%s\n%s\n%s", (int) ctx->operation,
+                     vfs_path_as_str (panel->cwd_vpath), dest,
+                     ctx->dest_mask != NULL ? ctx->dest_mask : "");
+
+    /* operation on other files is other operation */
+    if (source != NULL)
+        g_string_append_printf (key, "\n%s", source);
+    else
+    {
+        int i;
+
+        for (i = 0; i < panel->dir.len; i++)
+            if (panel->dir.list[i].f.marked != 0)
+            {
+                g_string_append_c (key, '\n');
+                g_string_append_len (key, panel->dir.list[i].fname->str,
+                                     panel->dir.list[i].fname->len);
+            }
+    }
+
+    if (copy_journal_exists (key->str))
+        resume = query_dialog (op_names[ctx->operation],
+                               _("This operation was interrupted before.\n"
+                                 "Resume it skipping the files copied already?"), D_NORMAL, 2,
+                               _("&Resume"), _("&Start over")) == 0;
+
+    journal = copy_journal_new (key->str, resume);
+    g_string_free (key, TRUE);
+
+    return journal;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef ENABLE_BACKGROUND
+/**
+ * Get device of the source or target of background operation to limit number of jobs on it.
+ * Target file may not exist yet, its directory is used then. All paths on the same remote
+ * host are treated as one device.
+ *
+ * @return device, 0 if it is unknown
+ */
+static dev_t
+panel_operate_get_device (const vfs_path_t *vpath)
+{
+    const vfs_path_element_t *path_element;
+    mc_stat_t st;
+    char *dir;
+    vfs_path_t *dir_vpath;
+    dev_t dev = 0;
+
+    path_element = vfs_path_get_by_index (vpath, -1);
+    if (path_element->host != NULL && path_element->host[0] != '\0')
+    {
+        char *host;
+
+        host = g_strconcat (path_element->class->name, ":", path_element->host, (char *) NULL);
+        /* don't return 0 which means unknown device */
+        dev = (dev_t) (g_str_hash (host) | 1);
+        g_free (host);
+        return dev;
+    }
+
+    if (mc_stat (vpath, &st) == 0)
+        return st.st_dev;
+
+    dir = g_path_get_dirname (vfs_path_as_str (vpath));
+    dir_vpath = vfs_path_from_str (dir);
+    if (mc_stat (dir_vpath, &st) == 0)
+        dev = st.st_dev;
+    vfs_path_free (dir_vpath, TRUE);
+    g_free (dir);
+
+    return dev;
+}
+#endif /* ENABLE_BACKGROUND */
+
 /* --------------------------------------------------------------------------------------------- */
 
 static char *
@@ -2009,6 +2434,9 @@ do_confirm_copy_move (const WPanel *panel, gboolean force_single, const char *so
                             source != NULL ? source : (const void *) &panel->marked, dest_dir,
                             do_bg);
 
+    if (ret != NULL && ctx->verify)
+        panel_operate_open_manifest (ctx);
+
     g_free (format);
     g_free (dest_dir);
 
@@ -2154,9 +2582,13 @@ operate_single_file (const WPanel *panel, file_op_context_t *ctx, const char *sr
 
 /* --------------------------------------------------------------------------------------------- */
 
+/**
+ * @param dest_name destination name built before, NULL to build it from @dest
+ */
+
 static FileProgressStatus
 operate_one_file (const WPanel *panel, file_op_context_t *ctx, const char *src,
-                  mc_stat_t *src_stat, const char *dest)
+                  mc_stat_t *src_stat, const char *dest, const char *dest_name)
 {
     FileProgressStatus value = FILE_CONT;
     vfs_path_t *src_vpath;
@@ -2178,14 +2610,19 @@ operate_one_file (const WPanel *panel, file_op_context_t *ctx, const char *src,
     }
     else
     {
-        char *temp;
+        char *temp = NULL;
 
         src = vfs_path_as_str (src_vpath);
 
-        temp = build_dest (ctx, src, dest, &value);
-        if (temp != NULL)
+        if (dest_name == NULL)
         {
-            dest = temp;
+            temp = build_dest (ctx, src, dest, &value);
+            dest_name = temp;
+        }
+
+        if (dest_name != NULL)
+        {
+            dest = dest_name;
 
             switch (ctx->operation)
             {
@@ -2212,9 +2649,9 @@ operate_one_file (const WPanel *panel, file_op_context_t *ctx, const char *src,
                 /* Unknown file operation */
                 abort ();
             }
-
-            g_free (temp);
         }
+
+        g_free (temp);
     }
 
     vfs_path_free (src_vpath, TRUE);
@@ -2222,6 +2659,86 @@ operate_one_file (const WPanel *panel, file_op_context_t *ctx, const char *src,
     return value;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that the destination mask doesn't give the same name to several marked files.
+ * Names are checked before any file is copied or moved, so the operation can be cancelled
+ * without partially overwritten results.
+ *
+ * @param dest_names array where the destination names are stored by the entry index, so they
+ *        are not built again by the copy loop. Name is NULL if entry is not marked or doesn't
+ *        match the source mask
+ */
+
+static FileProgressStatus
+panel_operate_check_dest_names (const WPanel *panel, file_op_context_t *ctx, const char *dest,
+                                GPtrArray *dest_names)
+{
+    GHashTable *names;
+    FileProgressStatus value = FILE_CONT;
+    gboolean check = TRUE;
+    int i;
+
+    g_ptr_array_set_size (dest_names, panel->dir.len);
+
+    /* destination name -> source name; names are owned by dest_names */
+    names = g_hash_table_new (g_str_hash, g_str_equal);
+
+    for (i = 0; i < panel->dir.len && value != FILE_ABORT; i++)
+    {
+        const char *fname, *other;
+        char *temp;
+
+        if (panel->dir.list[i].f.marked == 0)
+            continue;
+
+        fname = panel->dir.list[i].fname->str;
+
+        temp = build_dest (ctx, fname, dest, &value);
+        if (temp == NULL)
+        {
+            /* file doesn't match the source mask and will be skipped */
+            if (value == FILE_SKIP)
+                value = FILE_CONT;
+            continue;
+        }
+
+        g_ptr_array_index (dest_names, i) = temp;
+
+        /* names of the rest files are built anyway for the copy loop */
+        if (!check)
+            continue;
+
+        other = (const char *) g_hash_table_lookup (names, temp);
+        if (other == NULL)
+            g_hash_table_insert (names, temp, (gpointer) fname);
+        else
+        {
+            char buf[BUF_MEDIUM];
+            char *nfile1, *nfile2;
+
+            nfile1 = g_strdup (path_trunc (other, 15));
+            nfile2 = g_strdup (path_trunc (fname, 15));
+            g_snprintf (buf, sizeof (buf),
+                        _("Files \"%s\" and \"%s\"\nhave the same destination \"%s\""), nfile1,
+                        nfile2, path_trunc (temp, 30));
+            g_free (nfile1);
+            g_free (nfile2);
+
+            value = do_file_error (ctx, FALSE, buf);
+            /* look for other collisions */
+            if (value == FILE_IGNORE)
+                value = FILE_CONT;
+            else if (value != FILE_ABORT)
+                check = FALSE;
+        }
+    }
+
+    g_hash_table_destroy (names);
+
+    return (value == FILE_ABORT) ? FILE_ABORT : FILE_CONT;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 #ifdef ENABLE_BACKGROUND
@@ -2254,29 +2771,745 @@ attrs_ignore_error (const int e)
 }
 
 /* --------------------------------------------------------------------------------------------- */
-/*** public functions ****************************************************************************/
-/* --------------------------------------------------------------------------------------------- */
-
-/* Is file symlink to directory or not.
+/**
+ * Skip a hole of the sparse source file in both source and target files.
+ * If the rest of source file is a hole, target file is positioned to the last byte of it:
+ * caller should write one zero byte to set the target file size.
  *
- * @param path file or directory
- * @param st result of mc_lstat(vpath). If NULL, mc_lstat(vpath) is performed here
- * @param stale_link TRUE if file is stale link to directory
+ * @param src_desc source file descriptor
+ * @param dest_desc target file descriptor
+ * @param pos current position in both files
+ * @param file_size size of the source file
+ * @param data_end where the end of next data chunk is stored
  *
- * @return TRUE if file symlink to directory, ELSE otherwise.
+ * @return size of skipped hole, -1 if holes cannot be found and the rest of file
+ *         should be copied as is
  */
-gboolean
-file_is_symlink_to_dir (const vfs_path_t *vpath, mc_stat_t *st, gboolean *stale_link)
+static mc_off_t
+copy_file_skip_hole (int src_desc, int dest_desc, mc_off_t pos, mc_off_t file_size,
+                     mc_off_t *data_end)
 {
-    mc_stat_t st2;
-    gboolean stale = FALSE;
-    gboolean res = FALSE;
+    mc_off_t data_start = pos;
+    mc_off_t dest_pos;
 
-    if (st == NULL)
+    switch (mc_ctl (src_desc, VFS_CTL_SEEK_DATA, &data_start))
     {
-        st = &st2;
-
-        if (mc_lstat (vpath, st) != 0)
+    case 1:
+        data_start = MIN (data_start, file_size);
+        break;
+    case -1:
+        if (errno == ENXIO)
+        {
+            /* no more data */
+            data_start = file_size;
+            break;
+        }
+        MC_FALLTHROUGH;
+    default:
+        return -1;
+    }
+
+    *data_end = data_start;
+    if (data_start < file_size
+        && (mc_ctl (src_desc, VFS_CTL_SEEK_HOLE, data_end) != 1 || *data_end > file_size))
+        *data_end = file_size;
+
+    if (data_start == pos)
+        return 0;
+
+    dest_pos = data_start < file_size ? data_start : file_size - 1;
+
+    if (mc_lseek (src_desc, data_start, SEEK_SET) != data_start
+        || mc_lseek (dest_desc, dest_pos, SEEK_SET) != dest_pos)
+    {
+        /* restore positions */
+        mc_lseek (src_desc, pos, SEEK_SET);
+        mc_lseek (dest_desc, pos, SEEK_SET);
+        return -1;
+    }
+
+    return data_start - pos;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Streaming copy: start write-out of the newly copied part of the target file, wait for the
+ * part copied before and drop it from the page cache of both files. So the copy doesn't flood
+ * the page cache and dirty pages don't pile up.
+ *
+ * @param src_base offset of the copy start in the source file
+ * @param dst_base offset of the copy start in the target file
+ * @param started size of copied part which write-out is started for
+ * @param flushed size of copied part which is written and dropped from the page cache
+ * @param done size of copied part
+ * @param finish TRUE to wait for write-out of whole copied part
+ */
+static void
+copy_file_stream_flush (int src_desc, mc_off_t src_base, int dest_desc, mc_off_t dst_base,
+                        mc_off_t *started, mc_off_t *flushed, mc_off_t done, gboolean finish)
+{
+    mc_off_t end;
+
+    if (done > *started)
+    {
+        (void) vfs_sync_range (dest_desc, dst_base + *started, done - *started, FALSE);
+        *started = done;
+    }
+
+    end = finish ? done : *started - MIN (*started, FILEOP_STREAM_CHUNK);
+
+    if (end > *flushed)
+    {
+        (void) vfs_sync_range (dest_desc, dst_base + *flushed, end - *flushed, TRUE);
+        (void) vfs_advise (dest_desc, dst_base + *flushed, end - *flushed, VFS_ADVISE_DONTNEED);
+        (void) vfs_advise (src_desc, src_base + *flushed, end - *flushed, VFS_ADVISE_DONTNEED);
+        *flushed = end;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get result of previous attempts to clone files to the file system.
+ *
+ * @param dev device of target file system
+ */
+static clone_support_t
+copy_clone_get_support (const file_op_context_t *ctx, dev_t dev)
+{
+    gint64 key = (gint64) dev;
+
+    if (ctx->clone_support == NULL)
+        return CLONE_UNKNOWN;
+
+    return (clone_support_t) GPOINTER_TO_INT (g_hash_table_lookup (ctx->clone_support, &key));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Remember result of the attempt to clone file to the file system.
+ *
+ * @param dev device of target file system
+ * @param error 0 if file was cloned, errno value otherwise
+ */
+static void
+copy_clone_set_support (file_op_context_t *ctx, dev_t dev, int error)
+{
+    clone_support_t support;
+    gint64 *key;
+
+    if (error == 0)
+        support = CLONE_SUPPORTED;
+    /* EXDEV depends on the source file and EINVAL on the file type or offsets rather than
+       on the target file system */
+    else if (error == EOPNOTSUPP || error == ENOTSUP || error == ENOTTY || error == ENOSYS)
+        support = CLONE_UNSUPPORTED;
+    else
+        return;
+
+    if (copy_clone_get_support (ctx, dev) == support)
+        return;
+
+    if (ctx->clone_support == NULL)
+        ctx->clone_support = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
+    key = g_new (gint64, 1);
+    *key = (gint64) dev;
+    g_hash_table_insert (ctx->clone_support, key, GINT_TO_POINTER (support));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Share data blocks of the source file with the target file. Appended file shares
+ * the appended part. Regotten file shares the whole file including the part present already,
+ * so the copied prefix doesn't occupy the space twice.
+ *
+ * @param dest_desc target file opened for writing
+ * @param appending whether target file is opened for appending
+ * @param src_size size of source file
+ * @param dst_stat status of target file before the copy
+ *
+ * @return TRUE if data blocks are shared
+ */
+static gboolean
+copy_file_clone (file_op_context_t *ctx, const vfs_path_t *dst_vpath, int dest_desc,
+                 int src_desc, gboolean appending, mc_off_t src_size, const mc_stat_t *dst_stat)
+{
+    int result;
+
+    if (!appending)
+        result = vfs_clone_file (dest_desc, src_desc);
+    else
+    {
+        int clone_desc;
+        int error;
+
+        /* FICLONERANGE refuses target file opened with O_APPEND */
+        clone_desc = mc_open (dst_vpath, O_WRONLY);
+        if (clone_desc < 0)
+            return FALSE;
+
+        if (ctx->do_reget > 0)
+            result = vfs_clone_file_range (clone_desc, 0, src_desc, 0, 0);
+        else
+            result = vfs_clone_file_range (clone_desc, dst_stat->st_size, src_desc, 0, 0);
+
+        error = errno;
+        mc_close (clone_desc);
+        errno = error;
+    }
+
+    copy_clone_set_support (ctx, dst_stat->st_dev, result == 0 ? 0 : errno);
+    if (result != 0)
+        return FALSE;
+
+    ctx->shared_bytes += (uintmax_t) src_size;
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check if changed blocks of the target file can be written in place. Remote files which are
+ * kept in a temporary file and sent as a whole on close would be sent entirely anyway.
+ */
+static gboolean
+copy_file_delta_supported (const vfs_path_t *vpath)
+{
+    const struct vfs_class *class;
+
+    if (vfs_file_is_local (vpath))
+        return TRUE;
+
+    class = vfs_path_get_last_path_vfs (vpath);
+    return class != NULL && (class->flags & VFSF_REMOTE) != 0 && (class->flags & VFSF_USETMP) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the next block of the target file and compare it with the copied data.
+ *
+ * @return 1 if the block is the same, 0 if it differs, -1 if the target file is read up to
+ *         the end or cannot be read, so following blocks can't be compared
+ */
+static int
+copy_file_delta_compare (int cmp_desc, const char *data, size_t len, char *cmp_buf)
+{
+    size_t got = 0;
+
+    while (got < len)
+    {
+        const ssize_t n = mc_read (cmp_desc, cmp_buf + got, len - got);
+
+        if (n <= 0)
+            return -1;
+        got += (size_t) n;
+    }
+
+    return memcmp (data, cmp_buf, len) == 0 ? 1 : 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Read the file and compute its checksum. Reading and checksum go in parallel.
+ * Progress of reading is shown like progress of copy, and user can stop it.
+ *
+ * @param size size of the file to show progress
+ * @param status where FILE_ABORT or FILE_SKIP is stored if user stops reading
+ *
+ * @return checksum as a hexadecimal string to free with g_free(), NULL on error (errno is set)
+ *         or if reading is stopped
+ */
+static char *
+copy_file_checksum (file_op_context_t *ctx, const vfs_path_t *vpath, char *buf, size_t bufsize,
+                    mc_off_t size, FileProgressStatus *status)
+{
+    copy_hash_t *hash;
+    char *sum = NULL;
+    mc_off_t done = 0;
+    gint64 tv_last_update = 0;
+    ssize_t n;
+    int fd;
+
+    *status = FILE_CONT;
+
+    fd = mc_open (vpath, O_RDONLY | O_LINEAR);
+    if (fd < 0)
+        return NULL;
+
+    hash = copy_hash_new (FILEOP_VERIFY_CHECKSUM, bufsize);
+
+    vfs_advise (fd, 0, 0, VFS_ADVISE_SEQUENTIAL);
+
+    while ((n = mc_read (fd, buf, bufsize)) > 0)
+    {
+        const gint64 tv_current = g_get_monotonic_time ();
+
+        copy_hash_update (hash, buf, (size_t) n);
+        done += n;
+
+        if (tv_current - tv_last_update > FILEOP_UPDATE_INTERVAL_US / 4)
+        {
+            tv_last_update = tv_current;
+
+            if (verbose)
+            {
+                file_progress_show (ctx, MIN (done, size), size, _("(verifying)"), TRUE);
+                mc_refresh ();
+            }
+            else
+                rotate_dash (TRUE);
+
+            *status = file_progress_check_buttons (ctx);
+            if (*status != FILE_CONT)
+                break;
+        }
+    }
+
+    if (n == 0 && *status == FILE_CONT)
+        sum = copy_hash_finish (hash);
+
+    copy_hash_free (hash);
+
+    n = errno;
+    /* copied file is not needed in the page cache anymore */
+    vfs_advise (fd, 0, 0, VFS_ADVISE_DONTNEED);
+    mc_close (fd);
+    errno = (int) n;
+
+    return sum;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Compare the checksum of copied data with the checksum of the target file read back.
+ * Append the checksum to the manifest if the file is verified successfully.
+ *
+ * @return FILE_CONT if file is verified successfully, other status otherwise
+ */
+static FileProgressStatus
+copy_file_verify (file_op_context_t *ctx, copy_hash_t *hash, const vfs_path_t *dst_vpath,
+                  const char *dst_path, mc_off_t size, char *buf, size_t bufsize)
+{
+    FileProgressStatus status;
+    char *src_sum, *dst_sum;
+
+    src_sum = copy_hash_finish (hash);
+
+    while ((dst_sum = copy_file_checksum (ctx, dst_vpath, buf, bufsize, size, &status)) == NULL)
+    {
+        /* target is not verified, so source of moved file is kept */
+        if (status == FILE_SKIP)
+            status = FILE_IGNORE;
+        if (status != FILE_CONT)
+            goto ret;
+
+        if (ctx->ignore_all)
+        {
+            status = FILE_IGNORE_ALL;
+            goto ret;
+        }
+
+        status = file_error (ctx, TRUE, _("Cannot read target file \"%s\"\n%s"), dst_path);
+        if (status == FILE_RETRY)
+            continue;
+        if (status == FILE_IGNORE_ALL)
+            ctx->ignore_all = TRUE;
+        goto ret;
+    }
+
+    if (strcmp (src_sum, dst_sum) == 0)
+    {
+        status = FILE_CONT;
+
+        if (ctx->verify_manifest != NULL)
+        {
+            fprintf (ctx->verify_manifest, "%s  %s\n", dst_sum, dst_path);
+            fflush (ctx->verify_manifest);
+        }
+    }
+    else if (ctx->ignore_all)
+        status = FILE_IGNORE_ALL;
+    else
+    {
+        errno = 0;
+        status = file_error (ctx, FALSE, _("Checksum of target file \"%s\"\ndoesn't match the source"),
+                             dst_path);
+        if (status == FILE_IGNORE_ALL)
+            ctx->ignore_all = TRUE;
+        /* keep the source of moved file */
+        if (status == FILE_CONT)
+            status = FILE_IGNORE;
+    }
+
+  ret:
+    g_free (dst_sum);
+    g_free (src_sum);
+    return status;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#if defined(ENABLE_COPY_POOL) || defined(ENABLE_SFTPFS_TRANSFER)
+/**
+ * Get permissions of the file copied by another thread. Such file is created with the final
+ * permissions, so they are got here as copy_file_file() does it.
+ *
+ * @param src_stat status of source file
+ *
+ * @return mode of target file
+ */
+static mode_t
+copy_file_get_mode (const file_op_context_t *ctx, const mc_stat_t *src_stat)
+{
+    mode_t mask;
+
+    if (ctx->preserve)
+        return src_stat->st_mode & ctx->umask_kill;
+
+    mask = umask (-1);
+    umask (mask);
+    return 0100666 & ~mask & ctx->umask_kill;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Process files copied by other threads. Wait for the first one no longer than
+ * FILEOP_POOL_WAIT_US, then check the progress buttons.
+ * Files which failed to copy are copied again by copy_file_file() to ask user what to do.
+ *
+ * @param ops functions to get finished files of the threads
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+file_pool_process (file_op_context_t *ctx, const file_pool_ops_t *ops)
+{
+    FileProgressStatus status = FILE_CONT;
+    file_pool_done_t done;
+    gpointer job;
+    gint64 timeout = FILEOP_POOL_WAIT_US;
+
+    while (status != FILE_ABORT && (job = ops->get (ctx, timeout, &done)) != NULL)
+    {
+        const gint64 tv_current = g_get_monotonic_time ();
+
+        timeout = 0;
+
+        if (done.error == 0)
+        {
+            if (verbose && tv_current - ctx->pool_last_update > FILEOP_UPDATE_INTERVAL_US / 4)
+            {
+                vfs_path_t *vpath;
+
+                vpath = vfs_path_from_str (done.src_path);
+                file_progress_show_source (ctx, vpath);
+                vfs_path_free (vpath, TRUE);
+                vpath = vfs_path_from_str (done.dst_path);
+                file_progress_show_target (ctx, vpath);
+                vfs_path_free (vpath, TRUE);
+                ctx->pool_last_update = tv_current;
+            }
+
+            if (done.cloned)
+                ctx->shared_bytes += (uintmax_t) done.size;
+            progress_update_one (TRUE, ctx, done.size);
+            if (ctx->journal != NULL)
+                copy_journal_add_done (ctx->journal, done.src_path, (uintmax_t) done.size);
+        }
+        else if (!ops->is_cancelled (ctx))
+            status = copy_file_file (ctx, done.src_path, done.dst_path);
+
+        ops->finish (job);
+    }
+
+    if (status != FILE_ABORT)
+    {
+        mc_refresh ();
+        status = file_progress_check_buttons (ctx);
+    }
+
+    if (status == FILE_ABORT)
+    {
+        ops->cancel (ctx);
+        return FILE_ABORT;
+    }
+
+    return FILE_CONT;
+}
+#endif
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef ENABLE_COPY_POOL
+static gpointer
+copy_pool_get_done (file_op_context_t *ctx, gint64 timeout, file_pool_done_t *done)
+{
+    copy_job_t *job;
+
+    job = copy_pool_pop (ctx->copy_pool, timeout);
+    if (job == NULL)
+        return NULL;
+
+    (*job->pending)--;
+
+    if (job->cloned || job->clone_error != 0)
+        copy_clone_set_support (ctx, job->dst_dev, job->clone_error);
+
+    done->src_path = job->src_path;
+    done->dst_path = job->dst_path;
+    done->size = job->src_stat.st_size;
+    done->cloned = job->cloned;
+    done->error = job->error;
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_pool_finish_done (gpointer job)
+{
+    copy_job_free ((copy_job_t *) job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+copy_pool_is_cancelled_cb (file_op_context_t *ctx)
+{
+    return copy_pool_is_cancelled (ctx->copy_pool);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+copy_pool_cancel_cb (file_op_context_t *ctx)
+{
+    copy_pool_cancel (ctx->copy_pool);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Process files copied by the thread pool.
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+copy_pool_process (file_op_context_t *ctx)
+{
+    static const file_pool_ops_t ops = {
+        copy_pool_get_done,
+        copy_pool_finish_done,
+        copy_pool_is_cancelled_cb,
+        copy_pool_cancel_cb
+    };
+
+    return file_pool_process (ctx, &ops);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the thread pool if it is not created yet and either several threads are requested
+ * or files are cloned to the target file system. Cloning takes no time, so files are cloned
+ * in parallel to hide the latency of creation of target files.
+ *
+ * @param dst_dev device of target directory
+ *
+ * @return TRUE if the pool is created and the caller owns it
+ */
+static gboolean
+copy_pool_start (file_op_context_t *ctx, dev_t dst_dev)
+{
+    if (ctx->copy_pool != NULL)
+        return FALSE;
+
+    if (ctx->workers > 1)
+        ctx->copy_pool = copy_pool_new (ctx->workers);
+    else if (copy_clone_get_support (ctx, dst_dev) == CLONE_SUPPORTED)
+        ctx->copy_pool = copy_pool_new (FILEOP_CLONE_WORKERS);
+
+    return ctx->copy_pool != NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue regular file to copy by the thread pool.
+ *
+ * @param dst_dev device of target directory
+ * @param pending counter of unfinished files of the current directory
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+copy_pool_push_file (file_op_context_t *ctx, const char *src_path, const char *dst_path,
+                     const mc_stat_t *src_stat, dev_t dst_dev, int *pending)
+{
+    copy_job_t *job;
+    uintmax_t done_size;
+
+    /* file is copied already by the interrupted operation which is resumed now */
+    if (copy_journal_check_done (ctx, src_path, dst_path, &done_size))
+    {
+        progress_update_one (TRUE, ctx, (mc_off_t) done_size);
+        return FILE_CONT;
+    }
+
+    /* keep the queue short to not get ahead of the replace and error dialogs too much */
+    while (copy_pool_get_running (ctx->copy_pool) >=
+           (guint) copy_pool_get_workers (ctx->copy_pool) * FILEOP_POOL_JOBS_PER_WORKER)
+        if (copy_pool_process (ctx) == FILE_ABORT)
+            return FILE_ABORT;
+
+    job = g_new0 (copy_job_t, 1);
+    job->src_path = g_strdup (src_path);
+    job->dst_path = g_strdup (dst_path);
+    job->src_stat = *src_stat;
+    job->preserve_uidgid = ctx->preserve_uidgid;
+    job->preserve_attrs = ctx->preserve;
+    job->dst_dev = dst_dev;
+    job->try_clone = copy_clone_get_support (ctx, dst_dev) != CLONE_UNSUPPORTED;
+    job->pending = pending;
+    job->dst_mode = copy_file_get_mode (ctx, src_stat) & (mode_t) 07777;
+
+    (*pending)++;
+    copy_pool_push (ctx->copy_pool, job);
+
+    return FILE_CONT;
+}
+#endif /* ENABLE_COPY_POOL */
+
+/* --------------------------------------------------------------------------------------------- */
+
+#ifdef ENABLE_SFTPFS_TRANSFER
+static gpointer
+sftp_transfer_get_done (file_op_context_t *ctx, gint64 timeout, file_pool_done_t *done)
+{
+    sftpfs_transfer_job_t *job;
+
+    job = sftpfs_transfer_pop (ctx->sftp_transfer, timeout);
+    if (job == NULL)
+        return NULL;
+
+    (*job->pending)--;
+
+    done->src_path = job->src_path;
+    done->dst_path = job->dst_path;
+    done->size = job->src_stat.st_size;
+    done->cloned = FALSE;
+    done->error = job->error;
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sftp_transfer_finish_done (gpointer job)
+{
+    sftpfs_transfer_job_free ((sftpfs_transfer_job_t *) job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sftp_transfer_is_cancelled_cb (file_op_context_t *ctx)
+{
+    return sftpfs_transfer_is_cancelled (ctx->sftp_transfer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sftp_transfer_cancel_cb (file_op_context_t *ctx)
+{
+    sftpfs_transfer_cancel (ctx->sftp_transfer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Process files copied over the parallel SFTP connections.
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+sftp_transfer_process (file_op_context_t *ctx)
+{
+    static const file_pool_ops_t ops = {
+        sftp_transfer_get_done,
+        sftp_transfer_finish_done,
+        sftp_transfer_is_cancelled_cb,
+        sftp_transfer_cancel_cb
+    };
+
+    return file_pool_process (ctx, &ops);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue regular file to copy over the parallel SFTP connections. The file is copied by
+ * copy_file_file() if no connection to the host could be opened.
+ *
+ * @param pending counter of unfinished files of the current directory
+ *
+ * @return FILE_ABORT if operation was aborted, FILE_CONT otherwise
+ */
+static FileProgressStatus
+sftp_transfer_push_file (file_op_context_t *ctx, const char *src_path, const char *dst_path,
+                         const mc_stat_t *src_stat, int *pending)
+{
+    sftpfs_transfer_job_t *job;
+    uintmax_t done_size;
+
+    /* file is copied already by the interrupted operation which is resumed now */
+    if (copy_journal_check_done (ctx, src_path, dst_path, &done_size))
+    {
+        progress_update_one (TRUE, ctx, (mc_off_t) done_size);
+        return FILE_CONT;
+    }
+
+    /* keep the queue short to not get ahead of the replace and error dialogs too much */
+    while (sftpfs_transfer_get_running (ctx->sftp_transfer) >=
+           (guint) sftpfs_transfer_get_channels (ctx->sftp_transfer) * FILEOP_POOL_JOBS_PER_WORKER)
+        if (sftp_transfer_process (ctx) == FILE_ABORT)
+            return FILE_ABORT;
+
+    job = sftpfs_transfer_job_new (ctx->sftp_transfer, src_path, dst_path, src_stat,
+                                   copy_file_get_mode (ctx, src_stat));
+    job->pending = pending;
+
+    (*pending)++;
+    if (sftpfs_transfer_push (ctx->sftp_transfer, job))
+        return FILE_CONT;
+
+    (*pending)--;
+    sftpfs_transfer_job_free (job);
+    return copy_file_file (ctx, src_path, dst_path);
+}
+#endif /* ENABLE_SFTPFS_TRANSFER */
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+/* Is file symlink to directory or not.
+ *
+ * @param path file or directory
+ * @param st result of mc_lstat(vpath). If NULL, mc_lstat(vpath) is performed here
+ * @param stale_link TRUE if file is stale link to directory
+ *
+ * @return TRUE if file symlink to directory, ELSE otherwise.
+ */
+gboolean
+file_is_symlink_to_dir (const vfs_path_t *vpath, mc_stat_t *st, gboolean *stale_link)
+{
+    mc_stat_t st2;
+    gboolean stale = FALSE;
+    gboolean res = FALSE;
+
+    if (st == NULL)
+    {
+        st = &st2;
+
+        if (mc_lstat (vpath, st) != 0)
             goto ret;
     }
 
@@ -2306,18 +3539,30 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
     gid_t src_gid = (gid_t) (-1);
 
     int src_desc, dest_desc = -1;
+    /* target file opened for reading to compare it with the source */
+    int cmp_desc = -1;
+    char *cmp_buf = NULL;
+    gboolean delta;
     mode_t src_mode = 0;        /* The mode of the source file */
     mc_stat_t src_stat, dst_stat;
     mc_timesbuf_t times;
     unsigned long attrs = 0;
     gboolean attrs_ok = ctx->preserve;
     gboolean dst_exists = FALSE, appending = FALSE;
+    gboolean sparse_copy = FALSE;
+    /* checksum of copied data to verify the target file */
+    copy_hash_t *hash = NULL;
+    FileProgressStatus verify_status = FILE_CONT;
+    size_t bufsize = 0;
+    uintmax_t done_size;
+    mc_off_t resume_offset;
     mc_off_t file_size = -1;
     FileProgressStatus return_status, temp_status;
     dest_status_t dst_status = DEST_NONE;
     int open_flags;
     vfs_path_t *src_vpath = NULL, *dst_vpath = NULL;
-    char *buf = NULL;
+    char *buf = NULL, *buf_mem = NULL;
+    copy_pipe_t *cpipe = NULL;
 
     /* Keep the non-default value applied in chain of calls:
        move_file_file() -> file_progress_real_query_replace()
@@ -2325,6 +3570,13 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
     if (ctx->do_reget < 0)
         ctx->do_reget = 0;
 
+    /* file is copied already by the interrupted operation which is resumed now */
+    if (copy_journal_check_done (ctx, src_path, dst_path, &done_size))
+    {
+        progress_update_one (TRUE, ctx, (mc_off_t) done_size);
+        return FILE_CONT;
+    }
+
     return_status = FILE_RETRY;
 
     dst_vpath = vfs_path_from_str (dst_path);
@@ -2422,8 +3674,17 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
         if (check_same_file (ctx, src_path, &src_stat, dst_path, &dst_stat, &return_status))
             goto ret_fast;
 
+        /* Continue the file copied partially by the interrupted operation. Target file
+           shorter than it was recorded in the journal is changed by someone else */
+        if (ctx->journal != NULL && S_ISREG (src_stat.st_mode) && S_ISREG (dst_stat.st_mode)
+            && copy_journal_get_partial (ctx->journal, src_path, &resume_offset)
+            && dst_stat.st_size >= resume_offset && dst_stat.st_size <= src_stat.st_size)
+        {
+            ctx->do_reget = dst_stat.st_size;
+            ctx->do_append = TRUE;
+        }
         /* Should we replace destination? */
-        if (ctx->ask_overwrite)
+        else if (ctx->ask_overwrite)
         {
             ctx->do_reget = 0;
             return_status = query_replace (ctx, src_path, &src_stat, dst_path, &dst_stat);
@@ -2622,12 +3883,19 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
     src_gid = src_stat.st_gid;
     file_size = src_stat.st_size;
 
+    /* Update copy of large file: overwrite only blocks which differ. Target file is not
+       truncated, so it should not be larger than the source */
+    delta = ctx->do_delta && dst_exists && !ctx->do_append && S_ISREG (src_mode)
+        && S_ISREG (dst_stat.st_mode) && dst_stat.st_size <= file_size
+        && file_size >= FILEOP_DELTA_MIN_SIZE && copy_file_delta_supported (dst_vpath);
+    ctx->do_delta = FALSE;
+
     open_flags = O_WRONLY;
     if (!dst_exists)
         open_flags |= O_CREAT | O_EXCL;
     else if (ctx->do_append)
         open_flags |= O_APPEND;
-    else
+    else if (!delta)
         open_flags |= O_CREAT | O_TRUNC;
 
     while ((dest_desc = mc_open (dst_vpath, open_flags, src_mode)) < 0)
@@ -2653,17 +3921,13 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
     /* file opened, but not fully copied */
     dst_status = DEST_SHORT_QUERY;
 
+    /* Partially updated file can't be resumed from its size */
+    if (ctx->journal != NULL && !delta)
+        copy_journal_add_partial (ctx->journal, src_path, ctx->do_reget);
+
     appending = ctx->do_append;
     ctx->do_append = FALSE;
 
-    /* Try clone the file first. */
-    if (vfs_clone_file (dest_desc, src_desc) == 0)
-    {
-        dst_status = DEST_FULL;
-        return_status = FILE_CONT;
-        goto ret;
-    }
-
     /* Find out the optimal buffer size.  */
     while (mc_fstat (dest_desc, &dst_stat) != 0)
     {
@@ -2681,8 +3945,33 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
         goto ret;
     }
 
-    /* try preallocate space; if fail, try copy anyway */
-    while (mc_global.vfs.preallocate_space &&
+    /* Try clone the file first. File systems which can't clone are not tried again */
+    if (vfs_file_is_local (src_vpath) && vfs_file_is_local (dst_vpath)
+        && copy_clone_get_support (ctx, dst_stat.st_dev) != CLONE_UNSUPPORTED
+        && copy_file_clone (ctx, dst_vpath, dest_desc, src_desc, appending, file_size, &dst_stat))
+    {
+        dst_status = DEST_FULL;
+        return_status = FILE_CONT;
+        goto ret;
+    }
+
+    /* If target can't be read, it is overwritten entirely: it isn't larger than the source */
+    if (delta)
+        cmp_desc = mc_open (dst_vpath, O_RDONLY | O_LINEAR);
+
+    /* Keep holes of sparse file if they can be recreated by lseek() in the target file.
+       Verified file is copied as is: all data should pass through the checksum */
+    if (!appending && !ctx->verify && cmp_desc == -1 && S_ISREG (src_mode) && file_size > 0
+        && S_ISREG (dst_stat.st_mode) && vfs_file_is_local (dst_vpath))
+    {
+        mc_off_t hole = ctx->do_reget;
+
+        sparse_copy = mc_ctl (src_desc, VFS_CTL_SEEK_HOLE, &hole) == 1 && hole < file_size;
+    }
+
+    /* try preallocate space; if fail, try copy anyway.
+       Don't preallocate space for sparse file: it would fill the holes */
+    while (!sparse_copy && mc_global.vfs.preallocate_space &&
            vfs_preallocate (dest_desc, file_size, appending ? dst_stat.st_size : 0) != 0)
     {
         if (ctx->ignore_all)
@@ -2738,18 +4027,195 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
         gint64 tv_last_update = ctx->transfer_start;
         gint64 tv_last_input = 0;
         gboolean is_first_time = TRUE;
+        /* Try copy in the kernel if both files are local. O_APPEND target is not supported.
+           Data copied in the kernel can't be verified */
+        gboolean kernel_copy = !appending && !ctx->verify && cmp_desc == -1 && S_ISREG (src_mode)
+            && file_size > 0 && vfs_file_is_local (src_vpath) && vfs_file_is_local (dst_vpath);
+        /* end of current data chunk of sparse file */
+        mc_off_t data_end = 0;
+        /* writer thread failed, write the rest of its data in the usual way */
+        gboolean cpipe_failed = FALSE;
+        /* source file is read bypassing the page cache */
+        gboolean direct_io = FALSE;
+        /* streaming copy state */
+        mc_off_t stream_started = 0, stream_flushed = 0;
+        /* copied size saved in the journal */
+        mc_off_t journal_part = 0;
+        const mc_off_t dst_base = appending ? dst_stat.st_size : 0;
+
+        /* token bucket is shared by all files of the operation */
+        if (ctx->speed_limit > 0 && ctx->io_limit == NULL)
+            ctx->io_limit = io_limit_new ((uintmax_t) ctx->speed_limit * 1024);
+
+        bufsize = io_blksize (dst_stat);
+        /* buffer is aligned for the direct I/O */
+        buf_mem = g_malloc (bufsize + FILEOP_DIRECT_IO_ALIGN);
+        buf = (char *) (((guintptr) buf_mem + FILEOP_DIRECT_IO_ALIGN - 1)
+                        & ~((guintptr) FILEOP_DIRECT_IO_ALIGN - 1));
+
+        /* If only one file is local, read or write it in a thread while other one is accessed
+           via VFS. Kernel copy and sparse copy require both files to be local.
+           Update copy decides whether to write each block, so the target is not written
+           in a thread. Thread would read ahead of the speed limit */
+        if (copymove_pipe_buffers > 1 && !sparse_copy && S_ISREG (src_mode)
+            && ctx->io_limit == NULL)
+        {
+            const gboolean src_local = vfs_file_is_local (src_vpath);
+
+            if (src_local != vfs_file_is_local (dst_vpath) && (cmp_desc == -1 || src_local))
+                cpipe = copy_pipe_new (vfs_get_local_fd (src_local ? src_desc : dest_desc),
+                                       src_local, copymove_pipe_buffers,
+                                       (size_t) copymove_pipe_buffer_size * 1024);
+        }
+
+        if (cmp_desc != -1)
+            cmp_buf =
+                g_malloc (cpipe != NULL ? MAX (bufsize, copy_pipe_get_size (cpipe)) : bufsize);
 
-        const size_t bufsize = io_blksize (dst_stat);
-        buf = g_malloc (bufsize);
+        /* Only whole file can be verified */
+        if (ctx->verify && !appending && ctx->do_reget == 0 && S_ISREG (src_mode))
+            hash = copy_hash_new (FILEOP_VERIFY_CHECKSUM, bufsize);
+
+        if (copymove_streaming)
+        {
+            vfs_advise (src_desc, ctx->do_reget, 0, VFS_ADVISE_SEQUENTIAL);
+            vfs_advise (dest_desc, dst_base, 0, VFS_ADVISE_SEQUENTIAL);
+
+            /* Read large local files bypassing the page cache. Read-ahead thread and sparse copy
+               use unaligned buffers or offsets. The kernel copy (copy_file_range()) is turned
+               off: it would read the source through the page cache anyway */
+            if (copymove_direct_io_threshold > 0 && cpipe == NULL && !sparse_copy
+                && file_size >= (mc_off_t) copymove_direct_io_threshold * 1024 * 1024
+                && ctx->do_reget % FILEOP_DIRECT_IO_ALIGN == 0
+                && bufsize % FILEOP_DIRECT_IO_ALIGN == 0 && vfs_set_direct_io (src_desc, TRUE) == 0)
+            {
+                direct_io = TRUE;
+                kernel_copy = FALSE;
+            }
+        }
 
         while (TRUE)
         {
             ssize_t n_read = -1;
+            char *data = buf;
+            gboolean copied_in_kernel = FALSE;
+            gboolean tail_hole = FALSE;
+            /* data are passed to the writer thread */
+            gboolean queued = FALSE;
+            /* data are counted already */
+            gboolean rewrite = FALSE;
+            /* the same data are in the target file already */
+            gboolean unchanged = FALSE;
+            /* limited speed: short blocks to not sleep long after each of them */
+            size_t count = io_limit_get_chunk (ctx->io_limit, bufsize);
+            size_t kernel_count = io_limit_get_chunk (ctx->io_limit, FILEOP_KERNEL_COPY_CHUNK);
+            /* size of data read in this iteration */
+            size_t transferred = 0;
+
+            if (sparse_copy)
+            {
+                mc_off_t pos = ctx->do_reget + file_part;
+
+                if (pos >= data_end)
+                {
+                    mc_off_t hole = -1;
+
+                    /* file is grown or holes cannot be found anymore: copy the rest as is */
+                    if (pos >= file_size
+                        || (hole = copy_file_skip_hole (src_desc, dest_desc, pos, file_size,
+                                                        &data_end)) < 0)
+                        sparse_copy = FALSE;
+                    else
+                    {
+                        /* skipped hole is a part of copied file for progress and ETA */
+                        file_part += hole;
+                        pos += hole;
+
+                        if (pos >= file_size)
+                        {
+                            /* write the last zero byte to set the target file size */
+                            tail_hole = TRUE;
+                            file_part--;
+                            buf[0] = '\0';
+                            n_read = 1;
+                        }
+                    }
+                }
+
+                if (sparse_copy && pos < data_end)
+                {
+                    count = (size_t) MIN ((mc_off_t) count, data_end - pos);
+                    kernel_count = (size_t) MIN ((mc_off_t) kernel_count, data_end - pos);
+                }
+            }
+
+            if (kernel_copy && !tail_hole)
+            {
+                n_read = vfs_copy_file_chunk (dest_desc, src_desc, kernel_count);
+
+                /* Some pseudo filesystems report zero bytes copied for non-empty files */
+                if (n_read > 0 || (n_read == 0 && file_part + ctx->do_reget >= file_size))
+                    copied_in_kernel = TRUE;
+                else
+                {
+                    /* Kernel can't copy these files or copy failed: continue with the buffered
+                       copy from the current position, it will report errors if any */
+                    kernel_copy = FALSE;
+                    n_read = -1;
+                }
+            }
+
+            if (cpipe != NULL && copy_pipe_is_reading (cpipe))
+            {
+                n_read = copy_pipe_read (cpipe, &data);
+                if (n_read < 0)
+                {
+                    /* read it again in the usual way to ask user what to do */
+                    copy_pipe_free (cpipe);
+                    cpipe = NULL;
+                    data = buf;
+                }
+            }
+            else if (cpipe != NULL && cpipe_failed)
+            {
+                size_t len;
+
+                if (copy_pipe_get_unwritten (cpipe, &data, &len))
+                {
+                    n_read = (ssize_t) len;
+                    rewrite = TRUE;
+                }
+                else
+                {
+                    /* all data of the thread are written, continue without it */
+                    copy_pipe_free (cpipe);
+                    cpipe = NULL;
+                    data = buf;
+                }
+            }
+            else if (cpipe != NULL)
+            {
+                data = copy_pipe_get_buffer (cpipe);
+                if (data == NULL)
+                {
+                    cpipe_failed = TRUE;
+                    continue;
+                }
+                count = copy_pipe_get_size (cpipe);
+            }
 
             /* src_read */
-            if (mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
-                while ((n_read = mc_read (src_desc, buf, bufsize)) < 0 && !ctx->ignore_all)
+            if (n_read < 0 && mc_ctl (src_desc, VFS_CTL_IS_NOTREADY, 0) == 0)
+                while ((n_read = mc_read (src_desc, data, count)) < 0 && !ctx->ignore_all)
                 {
+                    if (direct_io && errno == EINVAL)
+                    {
+                        /* file system refuses the direct I/O: read file in the usual way */
+                        direct_io = FALSE;
+                        vfs_set_direct_io (src_desc, FALSE);
+                        continue;
+                    }
+
                     return_status =
                         file_error (ctx, TRUE, _("Cannot read source file \"%s\"\n%s"), src_path);
                     if (return_status == FILE_RETRY)
@@ -2759,22 +4225,58 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
                     goto ret;
                 }
 
+            if (cpipe != NULL && !copy_pipe_is_reading (cpipe) && !cpipe_failed && n_read >= 0)
+            {
+                /* write behind in the thread */
+                copy_pipe_commit (cpipe, (size_t) n_read);
+                queued = TRUE;
+
+                if (n_read == 0 && copy_pipe_flush (cpipe) != 0)
+                {
+                    cpipe_failed = TRUE;
+                    continue;
+                }
+            }
+
             if (n_read == 0)
                 break;
 
+            if (hash != NULL && n_read > 0 && !rewrite)
+                copy_hash_update (hash, data, (size_t) n_read);
+
             const gint64 tv_current = g_get_monotonic_time ();
 
             if (n_read > 0)
             {
                 ssize_t n_written;
-                char *t = buf;
+                char *t = data;
 
-                file_part += n_read;
+                if (!rewrite)
+                {
+                    file_part += n_read;
+                    transferred = (size_t) n_read;
+                }
 
                 tv_last_input = tv_current;
 
+                if (cmp_desc != -1)
+                {
+                    const int same =
+                        copy_file_delta_compare (cmp_desc, t, (size_t) n_read, cmp_buf);
+
+                    if (same < 0)
+                    {
+                        /* the rest is appended */
+                        mc_close (cmp_desc);
+                        cmp_desc = -1;
+                    }
+                    else if (same > 0)
+                        unchanged = mc_lseek (dest_desc, n_read, SEEK_CUR) >= 0;
+                }
+
                 /* dst_write */
-                while ((n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
+                while (!copied_in_kernel && !queued && !unchanged
+                       && (n_written = mc_write (dest_desc, t, (size_t) n_read)) < n_read)
                 {
                     gboolean write_errno_nospace;
 
@@ -2813,12 +4315,28 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
 
             ctx->progress_bytes = file_part + ctx->do_reget;
 
+            io_limit_consume (ctx->io_limit, transferred);
+
+            if (ctx->journal != NULL && file_part - journal_part >= FILEOP_JOURNAL_CHECKPOINT)
+            {
+                copy_journal_add_partial (ctx->journal, src_path, ctx->do_reget + file_part);
+                journal_part = file_part;
+            }
+
+            if (copymove_streaming && file_part - stream_started >= FILEOP_STREAM_CHUNK)
+                copy_file_stream_flush (src_desc, ctx->do_reget, dest_desc, dst_base,
+                                        &stream_started, &stream_flushed, file_part, FALSE);
+
             const gint64 usecs = tv_current - tv_last_update;
 
             if (is_first_time || usecs > FILEOP_UPDATE_INTERVAL_US)
             {
                 calc_copy_file_progress (ctx, tv_current, file_part, file_size - ctx->do_reget);
                 tv_last_update = tv_current;
+#ifdef ENABLE_BACKGROUND
+                background_report_progress (ctx->total_progress_bytes + ctx->progress_bytes,
+                                            ctx->total_bytes, ctx->bps);
+#endif
             }
 
             is_first_time = FALSE;
@@ -2878,12 +4396,29 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
             }
         }
 
+        if (copymove_streaming)
+            copy_file_stream_flush (src_desc, ctx->do_reget, dest_desc, dst_base, &stream_started,
+                                    &stream_flushed, file_part, TRUE);
+
+        if (hash != NULL)
+        {
+            /* write the target file to the disk and drop it from the page cache to read it back
+               from the disk rather than from memory */
+            (void) vfs_sync_range (dest_desc, 0, 0, TRUE);
+            (void) vfs_advise (dest_desc, 0, 0, VFS_ADVISE_DONTNEED);
+        }
+
         /* copy successful */
         dst_status = DEST_FULL;
     }
 
   ret:
-    g_free (buf);
+    /* stop the thread before the file is closed */
+    copy_pipe_free (cpipe);
+
+    if (cmp_desc != -1)
+        mc_close (cmp_desc);
+    g_free (cmp_buf);
 
     rotate_dash (FALSE);
     while (src_desc != -1 && mc_close (src_desc) < 0 && !ctx->ignore_all)
@@ -2909,6 +4444,13 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
         break;
     }
 
+    /* target file is kept even if it differs from the source */
+    if (hash != NULL && dst_status == DEST_FULL && return_status == FILE_CONT)
+        verify_status = copy_file_verify (ctx, hash, dst_vpath, dst_path, file_size, buf, bufsize);
+
+    copy_hash_free (hash);
+    g_free (buf_mem);
+
     if (dst_status == DEST_SHORT_QUERY)
     {
         /* Query to remove short file */
@@ -3018,6 +4560,13 @@ copy_file_file (file_op_context_t *ctx, const char *src_path, const char *dst_pa
         return_status = file_progress_check_buttons (ctx);
 
   ret_fast:
+    /* don't erase the source of moved file if the target is not verified */
+    if (return_status == FILE_CONT)
+        return_status = verify_status;
+
+    if (return_status == FILE_CONT && ctx->journal != NULL)
+        copy_journal_add_done (ctx->journal, src_path, (uintmax_t) MAX (file_size, 0));
+
     vfs_path_free (src_vpath, TRUE);
     vfs_path_free (dst_vpath, TRUE);
     return return_status;
@@ -3039,11 +4588,24 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
     mc_stat_t dst_stat, src_stat;
     unsigned long attrs = 0;
     gboolean attrs_ok = ctx->preserve;
-    DIR *reading;
+    DIR *reading = NULL;
+    /* names of directory entries got from the background scan of totals */
+    GPtrArray *names = NULL;
+    guint name_idx = 0;
     FileProgressStatus return_status = FILE_CONT;
     link_t *lp;
     vfs_path_t *src_vpath, *dst_vpath;
     gboolean do_mkdir = TRUE;
+#ifdef ENABLE_COPY_POOL
+    gboolean own_pool = FALSE;
+    gboolean use_pool;
+    dev_t dst_dev;
+    int pending = 0;
+#endif
+#ifdef ENABLE_SFTPFS_TRANSFER
+    gboolean own_transfer = FALSE;
+    int transfer_pending = 0;
+#endif
 
     src_vpath = vfs_path_from_str (s);
     dst_vpath = vfs_path_from_str (d);
@@ -3093,7 +4655,7 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
         attrs_ok = TRUE;
     }
 
-    if (is_in_linklist (dest_dirs, src_vpath, &src_stat) != NULL)
+    if (find_in_linklist (dest_dirs, src_vpath, &src_stat) != NULL)
     {
         /* Don't copy a directory we created before (we don't want to copy
            infinitely if a directory is copied into itself) */
@@ -3225,7 +4787,7 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
         lp->vfs = vfs_path_get_last_path_vfs (dst_vpath);
         lp->ino = dst_stat.st_ino;
         lp->dev = dst_stat.st_dev;
-        dest_dirs = g_slist_prepend (dest_dirs, lp);
+        add_to_linklist (&dest_dirs, lp);
     }
 
     if (ctx->preserve_uidgid)
@@ -3246,32 +4808,78 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
         }
     }
 
+#ifdef ENABLE_DIR_SCAN
+    /* directory was read by the background scan already */
+    if (ctx->dir_scan != NULL)
+        names = dir_scan_take_listing (ctx->dir_scan, s);
+#endif
+
     /* open the source dir for reading */
-    reading = mc_opendir (src_vpath);
-    if (reading == NULL)
-        goto ret;
+    if (names == NULL)
+    {
+        reading = mc_opendir (src_vpath);
+        if (reading == NULL)
+            goto ret;
+    }
 
-    while ((next = mc_readdir (reading)) && return_status != FILE_ABORT)
+#ifdef ENABLE_COPY_POOL
+    /* Copy local files in parallel. Moved files are erased right after the copy, so copy them
+       one by one. Verified files and files copied with limited speed are copied by
+       copy_file_file() as well */
+    use_pool = !do_delete && !ctx->verify && ctx->speed_limit == 0
+        && vfs_file_is_local (src_vpath) && vfs_file_is_local (dst_vpath);
+    dst_dev = dst_stat.st_dev;
+    if (use_pool)
+        own_pool = copy_pool_start (ctx, dst_dev);
+#endif
+
+#ifdef ENABLE_SFTPFS_TRANSFER
+    /* Copy files between local directory and SFTP host over several connections with the same
+       restrictions */
+    if (ctx->sftp_transfer == NULL && !do_delete && !ctx->verify && ctx->speed_limit == 0)
+    {
+        ctx->sftp_transfer = sftpfs_transfer_new (src_vpath, dst_vpath);
+        own_transfer = ctx->sftp_transfer != NULL;
+    }
+#endif
+
+    while (return_status != FILE_ABORT)
     {
+        const char *name;
         char *path;
         vfs_path_t *tmp_vpath;
+        gboolean stat_ok;
+
+        if (names != NULL)
+        {
+            if (name_idx >= names->len)
+                break;
+            name = (const char *) g_ptr_array_index (names, name_idx++);
+        }
+        else
+        {
+            next = mc_readdir (reading);
+            if (next == NULL)
+                break;
+            name = next->d_name;
+        }
 
         /*
          * Now, we don't want '.' and '..' to be created / copied at any time
          */
-        if (DIR_IS_DOT (next->d_name) || DIR_IS_DOTDOT (next->d_name))
+        if (DIR_IS_DOT (name) || DIR_IS_DOTDOT (name))
             continue;
 
         /* get the filename and add it to the src directory */
-        path = mc_build_filename (s, next->d_name, (char *) NULL);
+        path = mc_build_filename (s, name, (char *) NULL);
         tmp_vpath = vfs_path_from_str (path);
 
-        (*ctx->stat_func) (tmp_vpath, &dst_stat);
-        if (S_ISDIR (dst_stat.st_mode))
+        stat_ok = (*ctx->stat_func) (tmp_vpath, &dst_stat) == 0;
+        if (stat_ok && S_ISDIR (dst_stat.st_mode))
         {
             char *mdpath;
 
-            mdpath = mc_build_filename (d, next->d_name, (char *) NULL);
+            mdpath = mc_build_filename (d, name, (char *) NULL);
             /*
              * From here, we just intend to recursively copy subdirs, not
              * the double functionality of copying different when the target
@@ -3286,7 +4894,29 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
             char *dest_file;
 
             dest_file = mc_build_filename (d, x_basename (path), (char *) NULL);
-            return_status = copy_file_file (ctx, path, dest_file);
+#ifdef ENABLE_SFTPFS_TRANSFER
+            if (ctx->sftp_transfer != NULL && stat_ok && S_ISREG (dst_stat.st_mode)
+                && dst_stat.st_nlink == 1)
+                return_status = sftp_transfer_push_file (ctx, path, dest_file, &dst_stat,
+                                                         &transfer_pending);
+            else
+#endif
+#ifdef ENABLE_COPY_POOL
+            /* hard links are handled by copy_file_file() */
+            if (use_pool && stat_ok && S_ISREG (dst_stat.st_mode) && dst_stat.st_nlink == 1)
+            {
+                /* the first file copied one by one could find out that files can be cloned */
+                if (!own_pool)
+                    own_pool = copy_pool_start (ctx, dst_dev);
+                if (ctx->copy_pool == NULL)
+                    return_status = copy_file_file (ctx, path, dest_file);
+                else
+                    return_status =
+                        copy_pool_push_file (ctx, path, dest_file, &dst_stat, dst_dev, &pending);
+            }
+            else
+#endif
+                return_status = copy_file_file (ctx, path, dest_file);
             g_free (dest_file);
         }
 
@@ -3312,7 +4942,36 @@ copy_dir_dir (file_op_context_t *ctx, const char *s, const char *d, gboolean top
         }
         vfs_path_free (tmp_vpath, TRUE);
     }
-    mc_closedir (reading);
+
+    if (names != NULL)
+        g_ptr_array_free (names, TRUE);
+    else
+        mc_closedir (reading);
+
+#ifdef ENABLE_COPY_POOL
+    /* Wait for files of this directory before setting its attributes */
+    while (pending > 0)
+        if (copy_pool_process (ctx) == FILE_ABORT)
+            return_status = FILE_ABORT;
+
+    if (own_pool)
+    {
+        copy_pool_free (ctx->copy_pool);
+        ctx->copy_pool = NULL;
+    }
+#endif
+
+#ifdef ENABLE_SFTPFS_TRANSFER
+    while (transfer_pending > 0)
+        if (sftp_transfer_process (ctx) == FILE_ABORT)
+            return_status = FILE_ABORT;
+
+    if (own_transfer)
+    {
+        sftpfs_transfer_free (ctx->sftp_transfer);
+        ctx->sftp_transfer = NULL;
+    }
+#endif
 
     if (ctx->preserve)
     {
@@ -3387,6 +5046,30 @@ erase_dir (file_op_context_t *ctx, const vfs_path_t *vpath)
     {
         /* not empty */
         error = query_recursive (ctx, vfs_path_as_str (vpath));
+#ifdef ENABLE_ERASE_STAGE
+        if (error == FILE_CONT && delete_staging)
+        {
+            char *failed;
+
+            /* trees deleted before are removed in the background, report failures now */
+            while ((failed = erase_stage_get_failed ()) != NULL)
+            {
+                message (D_ERROR, MSG_ERROR,
+                         _("Cannot remove all files of deleted directory\n\"%s\"\n"
+                           "It is kept, removal is retried on the next start"), failed);
+                g_free (failed);
+            }
+
+            if (vfs_file_is_local (vpath) && erase_stage_move (vfs_path_as_str (vpath)))
+                return FILE_CONT;
+        }
+#endif
+#ifdef ENABLE_DIR_ERASE
+        /* remove the bulk of local tree fast, the rest including the directory itself
+           is removed below */
+        if (error == FILE_CONT && vfs_file_is_local (vpath))
+            error = erase_dir_fast (ctx, vpath);
+#endif
         if (error == FILE_CONT)
             error = recursive_erase (ctx, vpath);
         return error;
@@ -3538,11 +5221,15 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
     mc_stat_t src_stat;
     gboolean ret_val = TRUE;
     int i;
+    int old_io_priority = -1;
     FileProgressStatus value;
     file_op_context_t *ctx;
     filegui_dialog_type_t dialog_type = FILEGUI_DIALOG_ONE_ITEM;
 
     gboolean do_bg = FALSE;     /* do background operation? */
+    gboolean finished = FALSE;
+    /* destination names of marked entries built by the check of collisions */
+    GPtrArray *dest_names = NULL;
 
     static gboolean i18n_flag = FALSE;
     if (!i18n_flag)
@@ -3552,6 +5239,10 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         i18n_flag = TRUE;
     }
 
+    /* marked files are looked for in the whole directory */
+    if (!single_entry && !panel_load_whole (panel))
+        return FALSE;
+
     linklist = free_linklist (linklist);
     dest_dirs = free_linklist (dest_dirs);
 
@@ -3578,6 +5269,9 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         }
 
         dest_vpath = vfs_path_from_str (dest);
+
+        if (copymove_journal)
+            ctx->journal = panel_operate_open_journal (panel, ctx, source, dest);
     }
     else if (confirm_delete && !do_confirm_erase (panel, source, &src_stat))
     {
@@ -3595,7 +5289,10 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
         v = do_background (ctx,
                            g_strconcat (op_names[operation], ": ",
-                                        vfs_path_as_str (panel->cwd_vpath), (char *) NULL));
+                                        vfs_path_as_str (panel->cwd_vpath), (char *) NULL),
+                           panel_operate_get_device (panel->cwd_vpath),
+                           panel_operate_get_device (dest_vpath != NULL ? dest_vpath :
+                                                     panel->cwd_vpath));
         if (v == -1)
             message (D_ERROR, MSG_ERROR, _("Sorry, I could not put the job in background"));
 
@@ -3607,6 +5304,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
             mc_setctl (dest_vpath, VFS_SETCTL_FORGET, NULL);
             vfs_path_free (dest_vpath, TRUE);
             g_free (dest);
+            /* journal is written by the child */
+            copy_journal_free (ctx->journal, FALSE);
             /*          file_op_context_destroy (ctx); */
             return FALSE;
         }
@@ -3627,6 +5326,10 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
             dialog_type = FILEGUI_DIALOG_MULTI_ITEM;
     }
 
+    /* Background job changes priority of its own process only */
+    if (ctx->idle_io && operation != OP_DELETE)
+        old_io_priority = io_priority_set_idle ();
+
     /* Initialize things */
     /* We do not want to trash cache every time file is
        created/touched. However, this will make our cache contain
@@ -3665,6 +5368,7 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         value = operate_single_file (panel, ctx, source, &src_stat, dest, dialog_type);
         if ((value == FILE_CONT) && !force_single)
             unmark_files (panel);
+        finished = value != FILE_ABORT;
     }
     else
     {
@@ -3687,6 +5391,16 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                 goto clean_up;
         }
 
+        /* Several files can get the same name by the mask or from different directories of
+         * panelized list */
+        if (operation != OP_DELETE && !ctx->ignore_all
+            && (strcmp (ctx->dest_mask, "\\0") != 0 || panel->is_panelized))
+        {
+            dest_names = g_ptr_array_new_with_free_func (g_free);
+            if (panel_operate_check_dest_names (panel, ctx, dest, dest_names) == FILE_ABORT)
+                goto clean_up;
+        }
+
         /* TODO: the good way is required to skip directories scanning in case of rename/move
          * of several directories. Since reqular expression can be used for destination,
          * some directory movements can be a cross-filesystem and directory scanning is useful
@@ -3706,7 +5420,13 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
                 source2 = panel->dir.list[i].fname->str;
                 src_stat = panel->dir.list[i].st;
 
-                value = operate_one_file (panel, ctx, source2, &src_stat, dest);
+                if (dest_names == NULL)
+                    value = operate_one_file (panel, ctx, source2, &src_stat, dest, NULL);
+                else if (g_ptr_array_index (dest_names, i) == NULL)
+                    value = FILE_SKIP;  /* file doesn't match the source mask */
+                else
+                    value = operate_one_file (panel, ctx, source2, &src_stat, dest,
+                                              g_ptr_array_index (dest_names, i));
                 if (value == FILE_ABORT)
                     break;
 
@@ -3715,6 +5435,8 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
 
                 mc_refresh ();
             }                   /* Loop for every file */
+
+        finished = value != FILE_ABORT;
     }                           /* Many entries */
 
   clean_up:
@@ -3731,11 +5453,35 @@ panel_operate (void *source_panel, FileOperation operation, gboolean force_singl
         vfs_path_free (save_dest, TRUE);
     }
 
+    if (dest_names != NULL)
+        g_ptr_array_free (dest_names, TRUE);
     linklist = free_linklist (linklist);
     dest_dirs = free_linklist (dest_dirs);
+    /* keep the journal of interrupted operation to resume it */
+    copy_journal_free (ctx->journal, finished);
+    ctx->journal = NULL;
+    io_limit_free (ctx->io_limit);
+    ctx->io_limit = NULL;
+    if (ctx->clone_support != NULL)
+    {
+        g_hash_table_destroy (ctx->clone_support);
+        ctx->clone_support = NULL;
+    }
+    if (!io_priority_restore (old_io_priority))
+        message (D_ERROR, MSG_ERROR, "%s",
+                 _("Cannot restore I/O priority of Midnight Commander.\n"
+                   "It stays idle until restart"));
+#ifdef ENABLE_DIR_SCAN
+    dir_scan_free (ctx->dir_scan);
+    ctx->dir_scan = NULL;
+#endif
     g_free (dest);
     vfs_path_free (dest_vpath, TRUE);
     MC_PTR_FREE (ctx->dest_mask);
+    mc_search_replace_free (ctx->dest_mask_replace);
+    ctx->dest_mask_replace = NULL;
+    mc_search_replace_free (ctx->dest_replace);
+    ctx->dest_replace = NULL;
 
 #ifdef ENABLE_BACKGROUND
     /* Let our parent know we are saying bye bye */
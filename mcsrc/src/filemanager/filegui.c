@@ -157,6 +157,8 @@ statfs (char const *filename, struct fs_info *buf)
 
 #include "filemanager.h"
 
+#include "copypool.h"           /* ENABLE_COPY_POOL */
+#include "iosched.h"            /* ENABLE_IO_PRIORITY */
 #include "filegui.h"
 
 /* }}} */
@@ -195,6 +197,7 @@ typedef enum
     REPLACE_NONE,
     REPLACE_SMALLER,
     REPLACE_SIZE,
+    REPLACE_UPDATE,
     REPLACE_ABORT
 } replace_action_t;
 
@@ -412,21 +415,21 @@ file_ui_op_dlg_callback (Widget *w, Widget *sender, widget_msg_t msg, int parm,
 
 /* The dialog layout:
  *
- * +---------------------- File exists -----------------------+
- * | New     : /path/to/original_file_name                    |   // 0, 1
- * |                    1234567             feb  4 2017 13:38 |   // 2, 3
- * | Existing: /path/to/target_file_name                      |   // 4, 5
- * |                 1234567890             feb  4 2017 13:37 |   // 6, 7
- * +----------------------------------------------------------+
- * |                   Overwrite this file?                   |   // 8
- * |            [ Yes ] [ No ] [ Append ] [ Reget ]           |   // 9, 10, 11, 12
- * +----------------------------------------------------------+
- * |                   Overwrite all files?                   |   // 13
- * |  [ ] Don't overwrite with zero length file               |   // 14
- * |  [ All ] [ Older ] [None] [ Smaller ] [ Size differs ]   |   // 15, 16, 17, 18, 19
- * +----------------------------------------------------------|
- * |                         [ Abort ]                        |   // 20
- * +----------------------------------------------------------+
+ * +--------------------------- File exists ----------------------------+
+ * | New     : /path/to/original_file_name                              |   // 0, 1
+ * |                    1234567                       feb  4 2017 13:38 |   // 2, 3
+ * | Existing: /path/to/target_file_name                                |   // 4, 5
+ * |                 1234567890                       feb  4 2017 13:37 |   // 6, 7
+ * +--------------------------------------------------------------------+
+ * |                        Overwrite this file?                        |   // 8
+ * |                [ Yes ] [ No ] [ Append ] [ Reget ]                 |   // 9, 10, 11, 12
+ * +--------------------------------------------------------------------+
+ * |                        Overwrite all files?                        |   // 13
+ * |  [ ] Don't overwrite with zero length file                         |   // 14
+ * |  [ All ] [ Older ] [None] [ Smaller ] [ Size differs ] [ Update ]  |   // 15 - 20
+ * +--------------------------------------------------------------------|
+ * |                             [ Abort ]                              |   // 21
+ * +--------------------------------------------------------------------+
  */
 
 static replace_action_t
@@ -507,8 +510,10 @@ overwrite_query_dialog (file_op_context_t *ctx, enum OperationMode mode)
         { NULL, N_("S&maller"), 12, 25, WPOS_KEEP_DEFAULT, REPLACE_SMALLER },
         /* 19 - button */
         { NULL, N_("&Size differs"), 12, 40, WPOS_KEEP_DEFAULT, REPLACE_SIZE },
-        /* --------------------------------------------------- */
         /* 20 - button */
+        { NULL, N_("&Update"), 12, 55, WPOS_KEEP_DEFAULT, REPLACE_UPDATE },
+        /* --------------------------------------------------- */
+        /* 21 - button */
         { NULL, N_("&Abort"), 14, 27, WPOS_KEEP_TOP | WPOS_CENTER_HORZ, REPLACE_ABORT }
         /* *INDENT-ON* */
     };
@@ -595,7 +600,7 @@ overwrite_query_dialog (file_op_context_t *ctx, enum OperationMode mode)
     NEW_LABEL (13, dlg_widgets[13].text);
     dlg_widgets[14].widget =
         WIDGET (check_new (dlg_widgets[14].y, dlg_widgets[14].x, FALSE, dlg_widgets[14].text));
-    for (i = 15; i <= 20; i++)
+    for (i = 15; i <= 21; i++)
         NEW_BUTTON (i);
 
     /* place widgets */
@@ -610,7 +615,7 @@ overwrite_query_dialog (file_op_context_t *ctx, enum OperationMode mode)
     dlg_width = MAX (dlg_width, bw1);
 
     bw2 = WCOLS (15);
-    for (i = 16; i <= 19; i++)
+    for (i = 16; i <= 20; i++)
         bw2 += gap + WCOLS (i);
     dlg_width = MAX (dlg_width, bw2);
 
@@ -662,7 +667,7 @@ overwrite_query_dialog (file_op_context_t *ctx, enum OperationMode mode)
         WX (12) = WX (11) + WCOLS (11) + gap;
 
     WX (15) = dlg_width / 2 - bw2 / 2;
-    for (i = 16; i <= 19; i++)
+    for (i = 16; i <= 20; i++)
         WX (i) = WX (i - 1) + WCOLS (i - 1) + gap;
 
     /* TODO: write help (ticket #3970) */
@@ -690,11 +695,11 @@ overwrite_query_dialog (file_op_context_t *ctx, enum OperationMode mode)
     /* label & buttons */
     ADD_LABEL (13);             /* Overwrite all files? */
     group_add_widget (g, dlg_widgets[14].widget);
-    for (i = 15; i <= 19; i++)
+    for (i = 15; i <= 20; i++)
         ADD_BUTTON (i);
-    group_add_widget (g, hline_new (WY (19) - wd->rect.y + 1, -1, -1));
+    group_add_widget (g, hline_new (WY (20) - wd->rect.y + 1, -1, -1));
 
-    ADD_BUTTON (20);            /* Abort */
+    ADD_BUTTON (21);            /* Abort */
 
     group_select_widget_by_id (g, safe_overwrite ? no_id : yes_id);
 
@@ -796,6 +801,7 @@ file_op_context_new (FileOperation op)
     ctx->preserve_uidgid = (geteuid () == 0);
     ctx->umask_kill = (mode_t) (~0);
     ctx->erase_at_end = TRUE;
+    ctx->workers = 1;
     ctx->do_reget = -1;
     ctx->stat_func = mc_lstat;
     ctx->ask_overwrite = TRUE;
@@ -819,6 +825,8 @@ file_op_context_destroy (file_op_context_t *ctx)
     {
         file_progress_ui_destroy (ctx);
         mc_search_free (ctx->search_handle);
+        if (ctx->verify_manifest != NULL)
+            fclose (ctx->verify_manifest);
         g_free (ctx);
     }
 }
@@ -1069,7 +1077,18 @@ file_progress_show (file_op_context_t *ctx, mc_off_t done, mc_off_t total,
         return;
 
     if (!ui->showing_eta || ctx->eta_secs <= 0.5)
-        label_set_text (ui->progress_file_label, stalled_msg);
+    {
+        /* show throughput even if ETA is unknown */
+        if (!ui->showing_bps || ctx->bps == 0)
+            label_set_text (ui->progress_file_label, stalled_msg);
+        else
+        {
+            char buffer3[BUF_TINY];
+
+            file_bps_prepare_for_show (buffer3, ctx->bps);
+            label_set_textv (ui->progress_file_label, "(%s) %s", buffer3, stalled_msg);
+        }
+    }
     else
     {
         char buffer2[BUF_TINY];
@@ -1103,7 +1122,10 @@ file_progress_show_count (file_op_context_t *ctx)
     if (ui->total_files_processed_label == NULL)
         return;
 
-    if (ctx->totals_computed)
+    if (ctx->totals_partial)
+        label_set_textv (ui->total_files_processed_label, _("Files processed: %zu / at least %zu"),
+                         ctx->total_progress_count, ctx->total_count);
+    else if (ctx->totals_computed)
         label_set_textv (ui->total_files_processed_label, _("Files processed: %zu / %zu"),
                          ctx->total_progress_count, ctx->total_count);
     else
@@ -1132,8 +1154,9 @@ file_progress_show_total (file_op_context_t *ctx, uintmax_t copied_bytes, gint64
             gauge_show (ui->progress_total_gauge, FALSE);
         else
         {
+            /* copy can outrun the background scan of totals */
             gauge_set_value (ui->progress_total_gauge, 1024,
-                             (int) (1024 * copied_bytes / ctx->total_bytes));
+                             (int) (1024 * MIN (copied_bytes, ctx->total_bytes) / ctx->total_bytes));
             gauge_show (ui->progress_total_gauge, TRUE);
         }
     }
@@ -1148,7 +1171,8 @@ file_progress_show_total (file_op_context_t *ctx, uintmax_t copied_bytes, gint64
         file_frmt_time (buffer2,
                         (tv_current - ctx->pauses - ctx->total_transfer_start) / G_USEC_PER_SEC);
 
-        if (ctx->totals_computed)
+        /* ETA is unknown until all totals are computed */
+        if (ctx->totals_computed && !ctx->totals_partial)
         {
             file_eta_prepare_for_show (buffer3, ctx->total_eta_secs, TRUE);
             if (ctx->total_bps == 0)
@@ -1175,12 +1199,26 @@ file_progress_show_total (file_op_context_t *ctx, uintmax_t copied_bytes, gint64
     {
         size_trunc_len (buffer2, 5, copied_bytes, 0, panels_options.kilobyte_si);
 
+        /* part of data is not copied physically, the blocks are shared with source files */
+        if (ctx->shared_bytes != 0)
+        {
+            char copied[BUF_TINY];
+
+            g_strlcpy (copied, buffer2, sizeof (copied));
+            size_trunc_len (buffer3, 5, ctx->shared_bytes, 0, panels_options.kilobyte_si);
+            g_snprintf (buffer2, sizeof (buffer2), _("%s, shared %s"), copied, buffer3);
+        }
+
         if (!ctx->totals_computed)
             hline_set_textv (ui->total_bytes_label, _(" Total: %s "), buffer2);
         else
         {
             size_trunc_len (buffer3, 5, ctx->total_bytes, 0, panels_options.kilobyte_si);
-            hline_set_textv (ui->total_bytes_label, _(" Total: %s / %s "), buffer2, buffer3);
+            if (ctx->totals_partial)
+                hline_set_textv (ui->total_bytes_label, _(" Total: %s / at least %s "), buffer2,
+                                 buffer3);
+            else
+                hline_set_textv (ui->total_bytes_label, _(" Total: %s / %s "), buffer2, buffer3);
         }
     }
 }
@@ -1285,6 +1323,7 @@ file_progress_real_query_replace (file_op_context_t *ctx, enum OperationMode mod
         return FILE_CONT;
 
     ui = ctx->ui;
+    ctx->do_delta = FALSE;
 
     if (ui->replace_result == REPLACE_YES || ui->replace_result == REPLACE_NO
         || ui->replace_result == REPLACE_APPEND)
@@ -1322,6 +1361,15 @@ file_progress_real_query_replace (file_op_context_t *ctx, enum OperationMode mod
         else
             return FILE_SKIP;
 
+    case REPLACE_UPDATE:
+        do_refresh ();
+        /* quick check: file of the same size and modification time is not changed */
+        if (src_stat->st_size == dst_stat->st_size && src_stat->st_mtime == dst_stat->st_mtime)
+            return FILE_SKIP;
+        /* write changed blocks only */
+        ctx->do_delta = TRUE;
+        return replace_with_zero;
+
     case REPLACE_ALL:
         do_refresh ();
         return replace_with_zero;
@@ -1372,6 +1420,8 @@ file_mask_dialog (file_op_context_t *ctx, gboolean only_one, const char *format,
     preserve = copymove_persistent_attr && filegui__check_attrs_on_fs (def_text);
 
     ctx->stable_symlinks = FALSE;
+    ctx->verify = copymove_verify;
+    ctx->idle_io = copymove_idle_io;
     *do_bg = FALSE;
 
     /* filter out a possible password from def_text */
@@ -1419,12 +1469,21 @@ file_mask_dialog (file_op_context_t *ctx, gboolean only_one, const char *format,
         char *orig_mask;
         int val;
         mc_stat_t buf;
+        char speed[BUF_TINY];
+        char *speed_new = NULL;
+#ifdef ENABLE_COPY_POOL
+        char workers[BUF_TINY];
+        char *workers_new = NULL;
+
+        g_snprintf (workers, sizeof (workers), "%d", copymove_workers);
+#endif
+        g_snprintf (speed, sizeof (speed), "%d", copymove_speed_limit);
 
 #if defined(WIN32)  //WIN32, quick
 #ifdef ENABLE_BACKGROUND
-        quick_widget_t quick_widgets[20] = {0},
+        quick_widget_t quick_widgets[22] = {0},
 #else
-        quick_widget_t quick_widgets[19] = {0},
+        quick_widget_t quick_widgets[21] = {0},
 #endif
             *qc = quick_widgets;
 #else
@@ -1444,9 +1503,20 @@ file_mask_dialog (file_op_context_t *ctx, gboolean only_one, const char *format,
             QUICK_START_COLUMNS,
                 QUICK_CHECKBOX (N_("Follow &links"), &ctx->follow_links, NULL),
                 QUICK_CHECKBOX (N_("Preserve &attributes"), &preserve, NULL),
+#ifdef ENABLE_COPY_POOL
+                QUICK_LABELED_INPUT (N_("&Workers:"), input_label_left, workers, "input-workers",
+                                     &workers_new, NULL, FALSE, FALSE, INPUT_COMPLETE_NONE),
+#endif
+                QUICK_LABELED_INPUT (N_("Spee&d limit, KiB/s:"), input_label_left, speed,
+                                     "input-speed-limit", &speed_new, NULL, FALSE, FALSE,
+                                     INPUT_COMPLETE_NONE),
             QUICK_NEXT_COLUMN,
                 QUICK_CHECKBOX (N_("Di&ve into subdir if exists"), &ctx->dive_into_subdirs, NULL),
                 QUICK_CHECKBOX (N_("&Stable symlinks"), &ctx->stable_symlinks, NULL),
+                QUICK_CHECKBOX (N_("Veri&fy"), &ctx->verify, NULL),
+#ifdef ENABLE_IO_PRIORITY
+                QUICK_CHECKBOX (N_("&Idle I/O priority"), &ctx->idle_io, NULL),
+#endif
             QUICK_STOP_COLUMNS,
             QUICK_START_BUTTONS (TRUE, TRUE),
                 QUICK_BUTTON (N_("&OK"), B_ENTER, NULL, NULL),
@@ -1481,9 +1551,12 @@ file_mask_dialog (file_op_context_t *ctx, gboolean only_one, const char *format,
         qc = XQUICK_START_COLUMNS (qc);
         qc =      XQUICK_CHECKBOX (qc, N_("Follow &links"), &ctx->follow_links, NULL);
         qc =      XQUICK_CHECKBOX (qc, N_("Preserve &attributes"), &preserve, NULL);
+        qc =      XQUICK_LABELED_INPUT (qc, N_("Spee&d limit, KiB/s:"), input_label_left, speed,
+                                       "input-speed-limit", &speed_new, NULL, FALSE, FALSE, INPUT_COMPLETE_NONE);
         qc = XQUICK_NEXT_COLUMN (qc);
         qc =      XQUICK_CHECKBOX (qc, N_("Di&ve into subdir if exists"), &ctx->dive_into_subdirs, NULL);
         qc =      XQUICK_CHECKBOX (qc, N_("&Stable symlinks"), &ctx->stable_symlinks, NULL);
+        qc =      XQUICK_CHECKBOX (qc, N_("Veri&fy"), &ctx->verify, NULL);
         qc = XQUICK_STOP_COLUMNS (qc);
         qc = XQUICK_START_BUTTONS (qc, TRUE, TRUE);
         qc =      XQUICK_BUTTON (qc, N_("&OK"), B_ENTER, NULL, NULL);
@@ -1499,6 +1572,21 @@ file_mask_dialog (file_op_context_t *ctx, gboolean only_one, const char *format,
         {
             val = quick_dialog_skip (&qdlg, 4);
 
+#ifdef ENABLE_COPY_POOL
+            if (workers_new != NULL && workers_new[0] != '\0')
+                copymove_workers = CLAMP (atoi (workers_new), 1, COPY_POOL_MAX_WORKERS);
+            MC_PTR_FREE (workers_new);
+            g_snprintf (workers, sizeof (workers), "%d", copymove_workers);
+            ctx->workers = copymove_workers;
+#endif
+            copymove_verify = ctx->verify;
+            copymove_idle_io = ctx->idle_io;
+            if (speed_new != NULL && speed_new[0] != '\0')
+                copymove_speed_limit = MAX (atoi (speed_new), 0);
+            MC_PTR_FREE (speed_new);
+            g_snprintf (speed, sizeof (speed), "%d", copymove_speed_limit);
+            ctx->speed_limit = copymove_speed_limit;
+
             if (val == B_CANCEL)
             {
                 g_free (def_text_secure);
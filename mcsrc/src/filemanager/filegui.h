@@ -8,6 +8,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <inttypes.h>           /* uintmax_t */
+#include <stdio.h>              /* FILE */
 
 #include "lib/global.h"
 #include "lib/vfs/vfs.h"
@@ -63,6 +64,9 @@ enum OperationMode
 /*** structures declarations (and typedefs of structures)*****************************************/
 
 struct mc_search_struct;
+struct copy_pool_t;
+struct sftpfs_transfer_t;
+struct dir_scan_t;
 
 /* This structure describes a context for file operations.  It is used to update
  * the progress windows and pass around options.
@@ -99,16 +103,44 @@ typedef struct
      * successful copy (Note: this behavior is not tested and at the moment
      * it can't be changed at runtime). */
     gboolean erase_at_end;
+    /* Number of threads to copy local files in parallel, 1 to copy files one by one */
+    int workers;
+    /* Thread pool to copy local files. Owned by copy_dir_dir() which created it */
+    struct copy_pool_t *copy_pool;
+    /* Target file systems which were tried to clone files to, see clone_support_t */
+    GHashTable *clone_support;
+    /* Connections to copy files to or from SFTP host in parallel. Owned by copy_dir_dir()
+       which created it */
+    struct sftpfs_transfer_t *sftp_transfer;
+    /* Time when a file copied by the pool or over the connections was shown the last time */
+    gint64 pool_last_update;
+    /* Whether to compare checksums of source and copied file */
+    gboolean verify;
+    /* Checksums of verified files, opened on the first one */
+    FILE *verify_manifest;
+    /* Maximum speed in KiB/s, 0 for no limit */
+    int speed_limit;
+    /* Token bucket of the speed limit, created on the first copied file */
+    struct io_limit_t *io_limit;
+    /* Whether to copy with the idle I/O priority */
+    gboolean idle_io;
+    /* Journal of copied files to resume the operation if it is interrupted */
+    struct copy_journal_t *journal;
 
     /* Whether to do a reget */
     mc_off_t do_reget;
     /* Controls appending to files */
     gboolean do_append;
+    /* Whether to write only blocks which differ from the existing target file */
+    gboolean do_delta;
 
     /* Pointer to the stat function we will use */
     mc_stat_fn stat_func;
     /* search handler */
     struct mc_search_struct *search_handle;
+    /* Destination mask and directory compiled for search handler, see build_dest() */
+    struct mc_search_replace_struct *dest_mask_replace;
+    struct mc_search_replace_struct *dest_replace;
     /* toggle if all errors should be ignored */
     gboolean ignore_all;
     /* Whether the file operation is in pause */
@@ -133,6 +165,10 @@ typedef struct
     /* Total statuses */
     /* Whether the panel total has been computed */
     gboolean totals_computed;
+    /* Totals are still being computed in the background, so they are lower bounds */
+    gboolean totals_partial;
+    /* Background computation of totals */
+    struct dir_scan_t *dir_scan;
     /* Files transfer start time */
     gint64 total_transfer_start;
     /* Counters for progress indicators */
@@ -140,6 +176,8 @@ typedef struct
     size_t total_count;
     uintmax_t total_progress_bytes;
     uintmax_t total_bytes;
+    /* Part of total_progress_bytes shared with source files rather than copied */
+    uintmax_t shared_bytes;
     /* The estimated time of arrival in seconds */
     double total_eta_secs;
     /* Transferred bytes per second */
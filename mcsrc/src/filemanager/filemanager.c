@@ -72,6 +72,7 @@
 #include "panelize.h"
 #include "command.h"            /* cmdline */
 #include "dir.h"                /* dir_list_clean() */
+#include "erasestage.h"
 
 #ifdef USE_INTERNAL_EDIT
 #include "src/editor/edit.h"
@@ -890,6 +891,10 @@ done_mc (void)
 
     save_setup (auto_save_setup, panels_options.auto_save_setup);
 
+#ifdef ENABLE_ERASE_STAGE
+    erase_stage_done ();
+#endif
+
     vfs_stamp_path (vfs_get_raw_current_dir ());
 }
 
@@ -1493,11 +1498,32 @@ handle_cmdline_enter (void)
     return FALSE;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load next part of directories which are loaded in the background.
+ *
+ * @return TRUE if some directory is still being loaded, FALSE otherwise
+ */
+
+static gboolean
+load_panels_step (void)
+{
+    gboolean loading = FALSE;
+    int i;
+
+    for (i = 0; i < 2; i++)
+        if (get_panel_type (i) == view_listing && panel_load_step (PANEL (get_panel_widget (i))))
+            loading = TRUE;
+
+    return loading;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static cb_ret_t
 midnight_callback (Widget *w, Widget *sender, widget_msg_t msg, int parm, void *data)
 {
+    static gboolean started = FALSE;
     long command;
 
     switch (msg)
@@ -1527,16 +1553,23 @@ midnight_callback (Widget *w, Widget *sender, widget_msg_t msg, int parm, void *
         return MSG_HANDLED;
 
     case MSG_IDLE:
+        /* Idle events are needed while some directory is loaded in the background */
+        if (!load_panels_step ())
+            widget_idle (w, FALSE);
+
         /* We only need the first idle event to show user menu after start */
-        widget_idle (w, FALSE);
+        if (!started)
+        {
+            started = TRUE;
 
-        if (boot_current_is_left)
-            widget_select (get_panel_widget (0));
-        else
-            widget_select (get_panel_widget (1));
+            if (boot_current_is_left)
+                widget_select (get_panel_widget (0));
+            else
+                widget_select (get_panel_widget (1));
 
-        if (auto_menu)
-            midnight_execute_cmd (NULL, CK_UserMenu);
+            if (auto_menu)
+                midnight_execute_cmd (NULL, CK_UserMenu);
+        }
         return MSG_HANDLED;
 
     case MSG_KEY:
@@ -1838,6 +1871,10 @@ do_nc (void)
 
         setup_mc ();
         mc_filehighlight = mc_fhl_new (TRUE);
+#ifdef ENABLE_ERASE_STAGE
+        /* remove trees staged for deletion by previous session */
+        erase_stage_init ();
+#endif
 
         create_file_manager ();
         (void) dlg_run (filemanager);
@@ -0,0 +1,239 @@
+/*
+   I/O scheduling of file operations.
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file  iosched.c
+ *  \brief Source: I/O scheduling of file operations
+ *
+ *  Several copies started at once compete for the same disk or network link. The speed of
+ *  a copy can be limited with a token bucket: each copied block takes tokens which are
+ *  refilled with the configured rate, and the copy sleeps while the bucket is empty.
+ *  Blocks are made small enough that the copy doesn't sleep longer than a fraction of
+ *  a second, so the progress dialog stays responsive.
+ *
+ *  On Linux the copy can also run with the idle I/O priority, so the disk is given to it
+ *  only when nobody else uses it.
+ */
+
+#include <config.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "lib/global.h"
+
+#include "iosched.h"
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+/* Bucket holds tokens for this part of a second */
+#define IO_LIMIT_BURST_DIV 4
+/* Block holds data for this part of a second */
+#define IO_LIMIT_CHUNK_DIV 10
+/* Block size is a multiple of it to keep the direct I/O aligned */
+#define IO_LIMIT_MIN_CHUNK 4096
+
+#if defined(__linux__) && defined(SYS_ioprio_set) && defined(SYS_ioprio_get)
+#define IOPRIO_CLASS_NONE 0
+#define IOPRIO_CLASS_IDLE 3
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_PRIO_CLASS(prio) ((prio) >> IOPRIO_CLASS_SHIFT)
+#define IOPRIO_PRIO_VALUE(class, data) (((class) << IOPRIO_CLASS_SHIFT) | (data))
+#define IOPRIO_WHO_PROCESS 1
+#endif
+
+/*** file scope type declarations ****************************************************************/
+
+struct io_limit_t
+{
+    /* bytes per second */
+    gint64 rate;
+    /* bytes which can be transferred now, negative if more was transferred */
+    gint64 tokens;
+    /* time of the last refill */
+    gint64 last;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+io_limit_refill (io_limit_t *limit)
+{
+    const gint64 now = g_get_monotonic_time ();
+    gint64 elapsed;
+
+    /* bucket is full after a second anyway */
+    elapsed = MIN (now - limit->last, G_USEC_PER_SEC);
+    limit->last = now;
+
+    limit->tokens += elapsed * limit->rate / G_USEC_PER_SEC;
+    limit->tokens = MIN (limit->tokens, limit->rate / IO_LIMIT_BURST_DIV);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the speed limit.
+ *
+ * @param bytes_per_sec maximum speed
+ *
+ * @return new limit, NULL if speed is not limited
+ */
+
+io_limit_t *
+io_limit_new (uintmax_t bytes_per_sec)
+{
+    io_limit_t *limit;
+
+    if (bytes_per_sec == 0)
+        return NULL;
+
+    limit = g_new (io_limit_t, 1);
+    limit->rate = (gint64) MIN (bytes_per_sec, (uintmax_t) G_MAXINT32 * 1024);
+    limit->tokens = 0;
+    limit->last = g_get_monotonic_time ();
+
+    return limit;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+io_limit_free (io_limit_t *limit)
+{
+    g_free (limit);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get size of the next block to transfer.
+ *
+ * @param limit speed limit, NULL if speed is not limited
+ * @param count size of the buffer
+ *
+ * @return block size not greater than @count
+ */
+
+size_t
+io_limit_get_chunk (const io_limit_t *limit, size_t count)
+{
+    gint64 chunk;
+
+    if (limit == NULL)
+        return count;
+
+    chunk = limit->rate / IO_LIMIT_CHUNK_DIV;
+    chunk = MAX (chunk - chunk % IO_LIMIT_MIN_CHUNK, IO_LIMIT_MIN_CHUNK);
+
+    return MIN (count, (size_t) chunk);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Take tokens for transferred data. Sleep if the data were transferred faster than allowed.
+ *
+ * @param limit speed limit, NULL if speed is not limited
+ * @param bytes size of transferred data
+ */
+
+void
+io_limit_consume (io_limit_t *limit, size_t bytes)
+{
+    if (limit == NULL)
+        return;
+
+    io_limit_refill (limit);
+    limit->tokens -= (gint64) bytes;
+
+    if (limit->tokens < 0)
+    {
+        g_usleep ((gulong) (-limit->tokens * G_USEC_PER_SEC / limit->rate));
+        io_limit_refill (limit);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Give the disk to the calling thread only when nobody else uses it. Threads created by it
+ * later inherit the priority.
+ *
+ * @return previous I/O priority to pass to io_priority_restore(), -1 if it cannot be changed
+ */
+
+int
+io_priority_set_idle (void)
+{
+#ifdef IOPRIO_CLASS_IDLE
+    int prio;
+
+    prio = (int) syscall (SYS_ioprio_get, IOPRIO_WHO_PROCESS, 0);
+    if (prio < 0
+        || syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                    IOPRIO_PRIO_VALUE (IOPRIO_CLASS_IDLE, 0)) != 0)
+        return -1;
+
+    /* Thread without explicit priority is reported as class NONE with data derived from
+       the nice value. Such value is rejected by ioprio_set() on some kernels */
+    if (IOPRIO_PRIO_CLASS (prio) == IOPRIO_CLASS_NONE)
+        prio = IOPRIO_PRIO_VALUE (IOPRIO_CLASS_NONE, 0);
+
+    return prio;
+#else
+    return -1;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Restore I/O priority changed by io_priority_set_idle(). If the previous priority cannot be
+ * set, the default one derived from the nice value is set.
+ *
+ * @return FALSE if the calling thread is left with the idle I/O priority
+ */
+
+gboolean
+io_priority_restore (int prio)
+{
+#ifdef IOPRIO_CLASS_IDLE
+    if (prio < 0 || syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, prio) == 0)
+        return TRUE;
+
+    return syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                    IOPRIO_PRIO_VALUE (IOPRIO_CLASS_NONE, 0)) == 0;
+#else
+    (void) prio;
+
+    return TRUE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,40 @@
+/** \file  iosched.h
+ *  \brief Header: I/O scheduling of file operations
+ */
+
+#ifndef MC__IOSCHED_H
+#define MC__IOSCHED_H
+
+#include <inttypes.h>           /* uintmax_t */
+
+#include "lib/global.h"
+
+/*** typedefs(not structures) and defined constants **********************************************/
+
+/* I/O priority of the process can be changed */
+#ifdef __linux__
+#define ENABLE_IO_PRIORITY 1
+#endif
+
+/*** enums ***************************************************************************************/
+
+/*** structures declarations (and typedefs of structures)*****************************************/
+
+typedef struct io_limit_t io_limit_t;
+
+/*** global variables defined in .c file *********************************************************/
+
+/*** declarations of public functions ************************************************************/
+
+io_limit_t *io_limit_new (uintmax_t bytes_per_sec);
+void io_limit_free (io_limit_t * limit);
+
+size_t io_limit_get_chunk (const io_limit_t * limit, size_t count);
+void io_limit_consume (io_limit_t * limit, size_t bytes);
+
+int io_priority_set_idle (void);
+gboolean io_priority_restore (int prio);
+
+/*** inline functions ****************************************************************************/
+
+#endif /* MC__IOSCHED_H */
@@ -109,6 +109,13 @@ typedef enum
 #define MOUSE_BELOW_FILE_LIST (-2)
 #define MOUSE_AFTER_LAST_FILE (-3)
 
+/* Directory is loaded for this time before the panel is shown */
+#define PANEL_LOAD_SYNC_US (G_USEC_PER_SEC / 5)
+/* Directory is loaded for this time in one idle step */
+#define PANEL_LOAD_STEP_US (G_USEC_PER_SEC / 50)
+/* Panel is redrawn with this interval while directory is loaded */
+#define PANEL_LOAD_DRAW_US (G_USEC_PER_SEC / 4)
+
 /*** file scope type declarations ****************************************************************/
 
 typedef enum
@@ -174,7 +181,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|u"),
      N_("&Unsorted"), TRUE, FALSE,
      string_file_name,
-     (GCompareFunc) unsorted
+     (GCompareDataFunc) unsorted
     }
     ,
     {
@@ -184,7 +191,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|n"),
      N_("&Name"), TRUE, TRUE,
      string_file_name,
-     (GCompareFunc) sort_name
+     (GCompareDataFunc) sort_name
     }
     ,
     {
@@ -194,7 +201,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|v"),
      N_("&Version"), TRUE, FALSE,
      string_file_name,
-     (GCompareFunc) sort_vers
+     (GCompareDataFunc) sort_vers
     }
     ,
     {
@@ -204,7 +211,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|e"),
      N_("E&xtension"), TRUE, FALSE,
      string_file_name,          /* TODO: string_file_ext */
-     (GCompareFunc) sort_ext
+     (GCompareDataFunc) sort_ext
     }
     ,
     {
@@ -214,7 +221,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|s"),
      N_("&Size"), TRUE, TRUE,
      string_file_size,
-     (GCompareFunc) sort_size
+     (GCompareDataFunc) sort_size
     }
     ,
     {
@@ -222,7 +229,7 @@ static panel_field_t panel_fields[] = {
      "",
      N_("Block Size"), FALSE, FALSE,
      string_file_size_brief,
-     (GCompareFunc) sort_size
+     (GCompareDataFunc) sort_size
     }
     ,
     {
@@ -240,7 +247,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|m"),
      N_("&Modify time"), TRUE, TRUE,
      string_file_mtime,
-     (GCompareFunc) sort_time
+     (GCompareDataFunc) sort_time
     }
     ,
     {
@@ -250,7 +257,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|a"),
      N_("&Access time"), TRUE, TRUE,
      string_file_atime,
-     (GCompareFunc) sort_atime
+     (GCompareDataFunc) sort_atime
     }
     ,
     {
@@ -260,7 +267,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|h"),
      N_("C&hange time"), TRUE, TRUE,
      string_file_ctime,
-     (GCompareFunc) sort_ctime
+     (GCompareDataFunc) sort_ctime
     }
     ,
     {
@@ -293,7 +300,7 @@ static panel_field_t panel_fields[] = {
      N_("sort|i"),
      N_("&Inode"), TRUE, TRUE,
      string_inode,
-     (GCompareFunc) sort_inode
+     (GCompareDataFunc) sort_inode
     }
     ,
     {
@@ -1374,7 +1381,27 @@ show_dir (const WPanel *panel)
     tty_printf (" %s ", str_term_trim (tmp, MIN (MAX (w->rect.cols - 12, 0), w->rect.cols)));
     g_free (tmp);
 
-    if (!panels_options.show_mini_info)
+    if (panel->load.loader != NULL)
+    {
+        char buffer[BUF_MEDIUM];
+
+        /* Show number of entries loaded so far in the bottom of panel */
+        g_snprintf (buffer, sizeof (buffer), _(" Loading %d entries "), panel->dir.len);
+        tty_setcolor (NORMAL_COLOR);
+        widget_gotoyx (w, w->rect.lines - 1, 2);
+        tty_print_string (str_trunc (buffer, MAX (w->rect.cols - 4, 0)));
+    }
+    else if (panel->load.partial)
+    {
+        char buffer[BUF_MEDIUM];
+
+        /* Loading was stopped: the list isn't complete until the panel is reloaded */
+        g_snprintf (buffer, sizeof (buffer), _(" Partial: %d entries "), panel->dir.len);
+        tty_setcolor (MARKED_COLOR);
+        widget_gotoyx (w, w->rect.lines - 1, 2);
+        tty_print_string (str_trunc (buffer, MAX (w->rect.cols - 4, 0)));
+    }
+    else if (!panels_options.show_mini_info)
     {
         if (panel->marked == 0)
         {
@@ -2125,6 +2152,9 @@ panel_select_ext_cmd (WPanel *panel)
     mc_search_t *search;
     int i;
 
+    if (!panel_load_whole (panel))
+        return;
+
     fe = panel_current_entry (panel);
     if (fe == NULL)
         return;
@@ -2756,6 +2786,9 @@ panel_select_unselect_files (WPanel *panel, const char *title, const char *histo
     gboolean files_only;
     int i;
 
+    if (!panel_load_whole (panel))
+        return;
+
     search = panel_select_unselect_files_dialog (&panels_options.select_flags, title, history_name,
                                                  help_section, NULL);
     if (search == NULL || search == SELECT_RESET || search == SELECT_ERROR)
@@ -2803,6 +2836,9 @@ panel_select_invert_files (WPanel *panel)
 {
     int i;
 
+    if (!panel_load_whole (panel))
+        return;
+
     for (i = 0; i < panel->dir.len; i++)
     {
         file_entry_t *file = &panel->dir.list[i];
@@ -3482,6 +3518,196 @@ get_parent_dir_name (const vfs_path_t *cwd_vpath, const vfs_path_t *lwd_vpath)
     return (p != lwd || IS_PATH_SEP (*p)) ? p + 1 : p;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+panel_watch_stop (WPanel *panel)
+{
+#ifdef ENABLE_DIR_WATCH
+    dir_watch_free (panel->watch.dir);
+#endif
+    panel->watch.dir = NULL;
+    MC_PTR_FREE (panel->watch.filter);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start to watch changes of the panel directory. It is done before the directory is read,
+ * so changes made while it is read are not lost.
+ */
+
+static void
+panel_watch_start (WPanel *panel)
+{
+    panel_watch_stop (panel);
+#ifdef ENABLE_DIR_WATCH
+    panel->watch.dir = dir_watch_new (panel->cwd_vpath);
+#endif
+    panel->watch.show_dot_files = panels_options.show_dot_files;
+    panel->watch.show_backups = panels_options.show_backups;
+    panel->watch.filter = g_strdup (panel->filter.value);
+    panel->watch.filter_flags = panel->filter.flags;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Apply changes of the panel directory reported since it was read to the loaded list.
+ * Only changed entries are read again, so the directory is reloaded if options which hide
+ * entries are changed.
+ *
+ * @return TRUE if the list is up to date, FALSE if the directory must be reloaded
+ */
+
+static gboolean
+panel_watch_update (WPanel *panel)
+{
+#ifdef ENABLE_DIR_WATCH
+    GHashTable *names;
+    gboolean ret;
+
+    if (panel->watch.show_dot_files != panels_options.show_dot_files
+        || panel->watch.show_backups != panels_options.show_backups
+        || g_strcmp0 (panel->watch.filter, panel->filter.value) != 0
+        || panel->watch.filter_flags != panel->filter.flags)
+        return FALSE;
+
+    if (!dir_watch_is_for (panel->watch.dir, panel->cwd_vpath)
+        || !dir_watch_take_changes (panel->watch.dir, &names))
+        return FALSE;
+
+    if (names == NULL)
+        return TRUE;
+
+    ret = dir_list_update (&panel->dir, panel->cwd_vpath, names,
+                           panel->sort_field->sort_routine, &panel->sort_info, &panel->filter);
+    g_hash_table_destroy (names);
+
+    return ret;
+#else
+    (void) panel;
+
+    return FALSE;
+#endif
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Sort entries loaded so far. Keep the current entry and its position on the screen.
+ * If the entry which should be current is loaded already, make it current.
+ */
+
+static void
+panel_load_sort (WPanel *panel)
+{
+    const file_entry_t *fe;
+    char *filename = NULL;
+    int offset = 0;
+    int i;
+
+    fe = panel_current_entry (panel);
+    if (fe != NULL)
+    {
+        filename = g_strndup (fe->fname->str, fe->fname->len);
+        offset = panel->current - panel->top;
+    }
+
+    dir_list_sort (&panel->dir, panel->sort_field->sort_routine, &panel->sort_info);
+    panel->load.sorted = panel->dir.len;
+
+    if (filename != NULL)
+    {
+        for (i = panel->dir.len; i != 0; i--)
+            if (strcmp (panel->dir.list[i - 1].fname->str, filename) == 0)
+            {
+                panel->current = i - 1;
+                panel->top = MAX (panel->current - offset, 0);
+                break;
+            }
+
+        g_free (filename);
+    }
+    else if (panel->dir.len != 0)
+    {
+        panel->current = 0;
+        panel->top = 0;
+    }
+
+    if (panel->load.select_name != NULL)
+        for (i = 0; i < panel->dir.len; i++)
+            if (strcmp (panel->dir.list[i].fname->str, panel->load.select_name) == 0)
+            {
+                panel_set_current (panel, i);
+                MC_PTR_FREE (panel->load.select_name);
+                break;
+            }
+
+    panel->dirty = TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop loading of directory. Entries loaded so far are left in the panel.
+ *
+ * @return TRUE if directory was loaded completely, FALSE if loading was stopped or failed
+ */
+
+static gboolean
+panel_load_finish (WPanel *panel)
+{
+    gboolean ret;
+
+    ret = dir_list_loader_free (panel->load.loader);
+    panel->load.loader = NULL;
+    panel->load.partial = !ret;
+
+    /* changes of partially loaded directory cannot be applied to it */
+    if (!ret)
+        panel_watch_stop (panel);
+
+    panel_load_sort (panel);
+    MC_PTR_FREE (panel->load.select_name);
+    recalculate_panel_summary (panel);
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load directory of the panel. If directory is not loaded in a short time, show entries
+ * loaded so far and load the rest in the background by panel_load_step().
+ *
+ * @return FALSE if directory cannot be read, TRUE otherwise
+ */
+
+static gboolean
+panel_load_start (WPanel *panel)
+{
+    dir_list_loader_t *loader;
+
+    panel_watch_start (panel);
+
+    loader = dir_list_loader_new (&panel->dir, panel->cwd_vpath, &panel->filter);
+    if (loader == NULL)
+    {
+        panel_watch_stop (panel);
+        return FALSE;
+    }
+
+    panel->load.loader = loader;
+    panel->load.sorted = 0;
+    panel->load.last_draw = g_get_monotonic_time ();
+
+    /* without the owner there is nobody to load the rest */
+    if (dir_list_loader_step (loader, WIDGET (panel)->owner == NULL ? -1 : PANEL_LOAD_SYNC_US))
+        return panel_load_finish (panel);
+
+    panel_load_sort (panel);
+    /* load the rest when user does nothing */
+    widget_idle (WIDGET (WIDGET (panel)->owner), TRUE);
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 /**
  * Changes the current directory of the panel.
@@ -3492,6 +3718,7 @@ static gboolean
 panel_do_cd_int (WPanel *panel, const vfs_path_t *new_dir_vpath, enum cd_enum cd_type)
 {
     vfs_path_t *olddir_vpath;
+    const char *parent_name;
 
     /* Convert *new_path to a suitable pathname, handle ~user */
     if (cd_type == cd_parse_command)
@@ -3524,14 +3751,18 @@ panel_do_cd_int (WPanel *panel, const vfs_path_t *new_dir_vpath, enum cd_enum cd
     /* Reload current panel */
     panel_clean_dir (panel);
 
-    if (!dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                        &panel->sort_info, &panel->filter))
+    if (!panel_load_start (panel))
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
 
     if (panel->dir.len == 0)
         panel_set_current (panel, -1);
 
-    panel_set_current_by_name (panel, get_parent_dir_name (panel->cwd_vpath, olddir_vpath));
+    parent_name = get_parent_dir_name (panel->cwd_vpath, olddir_vpath);
+    panel_set_current_by_name (panel, parent_name);
+
+    /* the directory we came from can be not loaded yet */
+    if (panel->load.loader != NULL && parent_name != NULL)
+        panel->load.select_name = vfs_strip_suffix_from_filename (x_basename (parent_name));
 
     load_hint (FALSE);
     panel->dirty = TRUE;
@@ -3845,8 +4076,13 @@ panel_key (WPanel *panel, int key)
 {
     long command;
 
+    /* the user takes over the cursor */
+    MC_PTR_FREE (panel->load.select_name);
+
     if (is_abort_char (key))
     {
+        if (panel->load.loader != NULL && !panel->quick_search.active)
+            panel_load_finish (panel);
         stop_search (panel);
         return MSG_HANDLED;
     }
@@ -4124,6 +4360,7 @@ panel_mouse_callback (Widget *w, mouse_msg_t msg, mouse_event_t *event)
     switch (msg)
     {
     case MSG_MOUSE_DOWN:
+        MC_PTR_FREE (panel->load.select_name);
         if (event->y == 0)
         {
             /* top frame */
@@ -4255,7 +4492,7 @@ reload_panelized (WPanel *panel)
 
         vpath = vfs_path_from_str (list->list[i].fname->str);
         if (mc_lstat (vpath, &list->list[i].st) != 0)
-            g_string_free (list->list[i].fname, TRUE);
+            dir_list_free_entry (list, i);
         else
         {
             if (j != i)
@@ -4285,6 +4522,9 @@ update_one_panel_widget (WPanel *panel, panel_update_flags_t flags, const char *
 
     if ((flags & UP_RELOAD) != 0)
     {
+        /* changes of directory cannot be applied to the panelized list */
+        if (panel->is_panelized)
+            panel_watch_stop (panel);
         panel->is_panelized = FALSE;
         mc_setctl (panel->cwd_vpath, VFS_SETCTL_FLUSH, NULL);
         memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
@@ -4544,6 +4784,15 @@ panel_clean_dir (WPanel *panel)
     panel->content_shift = -1;
     panel->max_shift = -1;
 
+    if (panel->load.loader != NULL)
+    {
+        dir_list_loader_free (panel->load.loader);
+        panel->load.loader = NULL;
+    }
+    MC_PTR_FREE (panel->load.select_name);
+    panel->load.partial = FALSE;
+
+    panel_watch_stop (panel);
     dir_list_free_list (&panel->dir);
 }
 
@@ -4723,9 +4972,13 @@ panel_sized_with_dir_new (const char *panel_name, const WRect *r, const vfs_path
     }
 
     /* Load the default format */
+    panel_watch_start (panel);
     if (!dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
                         &panel->sort_info, &panel->filter))
+    {
+        panel_watch_stop (panel);
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
+    }
 
     if (panel->dir.len == 0)
         panel_set_current (panel, -1);
@@ -4751,6 +5004,7 @@ panel_reload (WPanel *panel)
 {
     mc_stat_t current_stat;
     vfs_path_t *cwd_vpath;
+    gboolean ok;
 
     if (panels_options.fast_reload && stat (vfs_path_as_str (panel->cwd_vpath), &current_stat) == 0
         && current_stat.st_ctime == panel->dir_stat.st_ctime
@@ -4772,9 +5026,28 @@ panel_reload (WPanel *panel)
     memset (&(panel->dir_stat), 0, sizeof (panel->dir_stat));
     show_dir (panel);
 
-    if (!dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
-                          &panel->sort_info, &panel->filter))
+    if (panel->load.loader != NULL)
+    {
+        /* directory is not loaded yet, so load it from the start */
+        panel_clean_dir (panel);
+        ok = panel_load_start (panel);
+    }
+    else if (panel_watch_update (panel))
+        ok = TRUE;
+    else
+    {
+        panel_watch_start (panel);
+        ok = dir_list_reload (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
+                              &panel->sort_info, &panel->filter);
+        /* the whole directory is read again */
+        panel->load.partial = FALSE;
+    }
+
+    if (!ok)
+    {
+        panel_watch_stop (panel);
         message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
+    }
 
     panel->dirty = TRUE;
 
@@ -5032,6 +5305,74 @@ panel_get_marked_file (const WPanel *panel, int *current_file)
     return (fe == NULL ? NULL : fe->fname);
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load next part of directory which is loaded in the background. It is called on idle of
+ * the main screen only, so loading is paused while a modal dialog is open.
+ *
+ * @return TRUE if directory is still being loaded, FALSE otherwise
+ */
+
+gboolean
+panel_load_step (WPanel *panel)
+{
+    gint64 now;
+
+    if (panel->load.loader == NULL)
+        return FALSE;
+
+    if (dir_list_loader_step (panel->load.loader, PANEL_LOAD_STEP_US))
+    {
+        if (!panel_load_finish (panel))
+            message (D_ERROR, MSG_ERROR, _("Cannot read directory contents"));
+        widget_draw (WIDGET (panel));
+        return FALSE;
+    }
+
+    /* sort again only when number of entries is doubled to keep the total time linear */
+    if (panel->dir.len >= 2 * panel->load.sorted)
+        panel_load_sort (panel);
+
+    now = g_get_monotonic_time ();
+    if (now - panel->load.last_draw >= PANEL_LOAD_DRAW_US)
+    {
+        panel->load.last_draw = now;
+        widget_draw (WIDGET (panel));
+        mc_refresh ();
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Load the rest of directory at once before an action on all entries of the panel, like
+ * marking by pattern or operation on marked files.
+ *
+ * @return TRUE if the whole directory is listed, FALSE if only a part of it was loaded
+ *         (the message is shown then)
+ */
+
+gboolean
+panel_load_whole (WPanel *panel)
+{
+    if (panel->load.loader != NULL)
+    {
+        dir_list_loader_step (panel->load.loader, -1);
+        panel_load_finish (panel);
+        widget_draw (WIDGET (panel));
+    }
+
+    if (panel->load.partial)
+    {
+        message (D_ERROR, MSG_ERROR, "%s",
+                 _("Only a part of directory is listed.\nReload it with C-r to list all entries"));
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 void
@@ -5077,7 +5418,7 @@ panel_set_sort_order (WPanel *panel, const panel_field_t *sort_order)
     panel->sort_field = sort_order;
 
     /* The directory is already sorted, we have to load the unsorted stuff */
-    if (sort_order->sort_routine == (GCompareFunc) unsorted)
+    if (sort_order->sort_routine == (GCompareDataFunc) unsorted)
     {
         const file_entry_t *fe;
         char *current_file = NULL;
@@ -5085,6 +5426,8 @@ panel_set_sort_order (WPanel *panel, const panel_field_t *sort_order)
         fe = panel_current_entry (panel);
         if (fe != NULL)
             current_file = g_strndup (fe->fname->str, fe->fname->len);
+        /* order of entries in the directory is got by reading it again */
+        panel_watch_stop (panel);
         panel_reload (panel);
         panel_set_current_by_name (panel, current_file);
         g_free (current_file);
@@ -5394,33 +5737,36 @@ panel_panelize_cd (void)
 
     if (plist->len < 1)
         dir_list_init (plist);
-    else if (plist->len > panel->dir.size)
-        dir_list_grow (&panel->dir, plist->len - panel->dir.size);
 
     list = &panel->dir;
-    list->len = plist->len;
 
     panelized_same = vfs_path_equal (pdescr->root_vpath, panel->cwd_vpath);
 
     for (i = 0; i < plist->len; i++)
     {
-        if (panelized_same || DIR_IS_DOTDOT (plist->list[i].fname->str))
-            list->list[i].fname = mc_g_string_dup (plist->list[i].fname);
+        const file_entry_t *pfe = &plist->list[i];
+        file_entry_t *fe;
+        gboolean ok;
+
+        if (panelized_same || DIR_IS_DOTDOT (pfe->fname->str))
+            ok = dir_list_append (list, pfe->fname->str, &pfe->st, pfe->f.link_to_dir != 0,
+                                  pfe->f.stale_link != 0);
         else
         {
             vfs_path_t *tmp_vpath;
 
-            tmp_vpath =
-                vfs_path_append_new (pdescr->root_vpath, plist->list[i].fname->str, (char *) NULL);
-            list->list[i].fname = g_string_new_take (vfs_path_free (tmp_vpath, FALSE));
+            tmp_vpath = vfs_path_append_new (pdescr->root_vpath, pfe->fname->str, (char *) NULL);
+            ok = dir_list_append (list, vfs_path_as_str (tmp_vpath), &pfe->st,
+                                  pfe->f.link_to_dir != 0, pfe->f.stale_link != 0);
+            vfs_path_free (tmp_vpath, TRUE);
         }
-        list->list[i].f.link_to_dir = plist->list[i].f.link_to_dir;
-        list->list[i].f.stale_link = plist->list[i].f.stale_link;
-        list->list[i].f.dir_size_computed = plist->list[i].f.dir_size_computed;
-        list->list[i].f.marked = plist->list[i].f.marked;
-        list->list[i].st = plist->list[i].st;
-        list->list[i].name_sort_key = plist->list[i].name_sort_key;
-        list->list[i].extension_sort_key = plist->list[i].extension_sort_key;
+
+        if (!ok)
+            break;
+
+        fe = &list->list[list->len - 1];
+        fe->f.dir_size_computed = pfe->f.dir_size_computed;
+        fe->f.marked = pfe->f.marked;
     }
 
     panel->is_panelized = TRUE;
@@ -5500,23 +5846,19 @@ panel_panelize_save (WPanel *panel)
 
     if (plist->len > 0)
         dir_list_clean (plist);
-    if (panel->dir.len == 0)
-        return;
-
-    if (panel->dir.len > plist->size)
-        dir_list_grow (plist, panel->dir.len - plist->size);
-    plist->len = panel->dir.len;
 
-    for (i = 0; i < panel->dir.len; i++)
+    for (i = 0; i < list->len; i++)
     {
-        plist->list[i].fname = mc_g_string_dup (list->list[i].fname);
-        plist->list[i].f.link_to_dir = list->list[i].f.link_to_dir;
-        plist->list[i].f.stale_link = list->list[i].f.stale_link;
-        plist->list[i].f.dir_size_computed = list->list[i].f.dir_size_computed;
-        plist->list[i].f.marked = list->list[i].f.marked;
-        plist->list[i].st = list->list[i].st;
-        plist->list[i].name_sort_key = list->list[i].name_sort_key;
-        plist->list[i].extension_sort_key = list->list[i].extension_sort_key;
+        const file_entry_t *fe = &list->list[i];
+        file_entry_t *pfe;
+
+        if (!dir_list_append (plist, fe->fname->str, &fe->st, fe->f.link_to_dir != 0,
+                              fe->f.stale_link != 0))
+            break;
+
+        pfe = &plist->list[plist->len - 1];
+        pfe->f.dir_size_computed = fe->f.dir_size_computed;
+        pfe->f.marked = fe->f.marked;
     }
 }
 
@@ -16,6 +16,7 @@
 #include "lib/file-entry.h"
 
 #include "dir.h"                /* dir_list */
+#include "dirwatch.h"           /* dir_watch_t */
 
 /*** typedefs(not structures) and defined constants **********************************************/
 
@@ -68,7 +69,7 @@ typedef struct panel_field_struct
     gboolean is_user_choice;
     gboolean use_in_user_format;
     const char *(*string_fn) (const file_entry_t * fe, int len);
-    GCompareFunc sort_routine;  /* used by mouse_sort_col() */
+    GCompareDataFunc sort_routine;      /* used by mouse_sort_col() */
 } panel_field_t;
 
 typedef struct
@@ -141,6 +142,23 @@ typedef struct
 
     int content_shift;          /* Number of characters of filename need to skip from left side. */
     int max_shift;              /* Max shift for visible part of current panel */
+
+    struct
+    {
+        dir_list_loader_t *loader;      /* Directory loaded in background, NULL if loaded */
+        int sorted;             /* Number of entries at the last sort */
+        gint64 last_draw;       /* Time of the last redraw */
+        char *select_name;      /* Entry to make current when it is loaded, NULL if none */
+        gboolean partial;       /* Loading was stopped, only a part of directory is listed */
+    } load;
+    struct
+    {
+        dir_watch_t *dir;       /* Changes of loaded directory, NULL if it isn't watched */
+        gboolean show_dot_files;        /* Options the directory was read with */
+        gboolean show_backups;
+        char *filter;
+        select_flags_t filter_flags;
+    } watch;
 } WPanel;
 
 /*** global variables defined in .c file *********************************************************/
@@ -158,6 +176,8 @@ WPanel *panel_sized_with_dir_new (const char *panel_name, const WRect * r,
 void panel_clean_dir (WPanel * panel);
 
 void panel_reload (WPanel * panel);
+gboolean panel_load_step (WPanel * panel);
+gboolean panel_load_whole (WPanel * panel);
 void panel_set_sort_order (WPanel * panel, const panel_field_t * sort_order);
 void panel_re_sort (WPanel * panel);
 
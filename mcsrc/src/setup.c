@@ -117,6 +117,32 @@ panel_view_mode_t startup_right_mode;
 
 gboolean copymove_persistent_attr = TRUE;
 
+/* Number of threads to copy local files in parallel, 1 to copy files one by one */
+int copymove_workers = 1;
+/* Number and size (in KiB) of buffers to read or write local file in a thread when other file
+   is not local. Less than 2 buffers disable the thread */
+int copymove_pipe_buffers = 4;
+int copymove_pipe_buffer_size = 1024;
+/* Don't flood the page cache on file copy */
+gboolean copymove_streaming = FALSE;
+/* Size (in MiB) of files which are read bypassing the page cache in the streaming copy.
+   0 disables the direct I/O */
+int copymove_direct_io_threshold = 64;
+/* Verify copied files by checksum */
+gboolean copymove_verify = FALSE;
+/* File to append checksums of verified files to, empty to not write it */
+char *copymove_verify_manifest = NULL;
+/* Maximum speed (in KiB/s) of copy or move, 0 for no limit */
+int copymove_speed_limit = 0;
+/* Copy or move with the idle I/O priority */
+gboolean copymove_idle_io = FALSE;
+/* Keep journal of copied files to resume interrupted copy or move */
+gboolean copymove_journal = FALSE;
+/* Delete directories by rename into staging directory and remove them in the background */
+gboolean delete_staging = FALSE;
+/* Number of background jobs which run on the same device at once, 0 for no limit */
+int background_jobs_per_device = 0;
+
 /* Tab size */
 int option_tab_spacing = DEFAULT_TAB_SPACING;
 
@@ -175,6 +201,8 @@ gboolean verbose = TRUE;
  * at the expense of some speed
  */
 gboolean file_op_compute_totals = TRUE;
+/* Compute totals in the background while the operation is already running */
+gboolean file_op_background_totals = FALSE;
 
 /* If true use the internal viewer */
 gboolean use_internal_view = TRUE;
@@ -335,6 +363,7 @@ static const struct
     { "show_output_starts_shell", &output_starts_shell },
     { "xtree_mode", &xtree_mode },
     { "file_op_compute_totals", &file_op_compute_totals },
+    { "file_op_background_totals", &file_op_background_totals },
     { "classic_progressbar", &classic_progressbar },
 #ifdef ENABLE_VFS
 #ifdef ENABLE_VFS_FTP
@@ -376,6 +405,11 @@ static const struct
     { "mcview_remember_file_position", &mcview_remember_file_position },
     { "auto_fill_mkdir_name", &auto_fill_mkdir_name },
     { "copymove_persistent_attr", &copymove_persistent_attr },
+    { "copymove_streaming", &copymove_streaming },
+    { "copymove_verify", &copymove_verify },
+    { "copymove_journal", &copymove_journal },
+    { "copymove_idle_io", &copymove_idle_io },
+    { "delete_staging", &delete_staging },
     { NULL, NULL }
 };
 
@@ -388,6 +422,14 @@ static const struct
     { "mouse_repeat_rate", &mou_auto_repeat },
     { "double_click_speed", &double_click_speed },
     { "old_esc_mode_timeout", &old_esc_mode_timeout },
+    { "copymove_workers", &copymove_workers },
+    { "copymove_pipe_buffers", &copymove_pipe_buffers },
+    { "copymove_pipe_buffer_size", &copymove_pipe_buffer_size },
+    { "copymove_direct_io_threshold", &copymove_direct_io_threshold },
+    { "copymove_speed_limit", &copymove_speed_limit },
+#ifdef ENABLE_BACKGROUND
+    { "background_jobs_per_device", &background_jobs_per_device },
+#endif
 #if defined(WIN32)  //WIN32, alert-options
     { "console_alert_mode", &console_alert_mode },
 #endif
@@ -424,6 +466,7 @@ static const struct
     { "editor_stop_format_chars", &edit_options.stop_format_chars, "-+*\\,.;:&>" },
 #endif
     { "mcview_eof", &mcview_show_eof, "" },
+    { "copymove_verify_manifest", &copymove_verify_manifest, "" },
     {  NULL, NULL, NULL }
 };
 
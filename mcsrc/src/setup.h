@@ -87,6 +87,18 @@ extern gboolean auto_menu;
 extern gboolean drop_menus;
 extern gboolean verbose;
 extern gboolean copymove_persistent_attr;
+extern int copymove_workers;
+extern int copymove_pipe_buffers;
+extern int copymove_pipe_buffer_size;
+extern gboolean copymove_streaming;
+extern int copymove_direct_io_threshold;
+extern gboolean copymove_verify;
+extern char *copymove_verify_manifest;
+extern int copymove_speed_limit;
+extern gboolean copymove_idle_io;
+extern gboolean copymove_journal;
+extern gboolean delete_staging;
+extern int background_jobs_per_device;
 extern gboolean classic_progressbar;
 extern gboolean easy_patterns;
 extern int option_tab_spacing;
@@ -99,6 +111,7 @@ extern gboolean output_starts_shell;
 extern gboolean use_file_to_check_type;
 #endif
 extern gboolean file_op_compute_totals;
+extern gboolean file_op_background_totals;
 extern gboolean editor_ask_filename_before_edit;
 
 extern panels_options_t panels_options;
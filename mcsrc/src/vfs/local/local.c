@@ -460,6 +460,55 @@ local_lseek (void *data, mc_off_t offset, int whence)
 
 /* --------------------------------------------------------------------------------------------- */
 
+static int
+local_ctl (void *data, int ctlop, void *arg)
+{
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    int fd = *(int *) data;
+    mc_off_t *offset = (mc_off_t *) arg;
+    mc_off_t pos, res;
+    int saved_errno;
+
+    switch (ctlop)
+    {
+    case VFS_CTL_SEEK_DATA:
+    case VFS_CTL_SEEK_HOLE:
+        /* keep the file position unchanged */
+        pos = lseek (fd, 0, SEEK_CUR);
+        if (pos == -1)
+            return -1;
+
+        res = lseek (fd, *offset, ctlop == VFS_CTL_SEEK_DATA ? SEEK_DATA : SEEK_HOLE);
+        saved_errno = errno;
+        (void) lseek (fd, pos, SEEK_SET);
+
+        if (res != -1)
+        {
+            *offset = res;
+            return 1;
+        }
+
+        /* file system doesn't support holes */
+        if (saved_errno == EINVAL || saved_errno == ENOTSUP || saved_errno == EOPNOTSUPP)
+            return 0;
+
+        errno = saved_errno;
+        return -1;
+
+    default:
+        break;
+    }
+#else
+    (void) data;
+    (void) ctlop;
+    (void) arg;
+#endif
+
+    return 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
 static gboolean
 local_nothingisopen (vfsid id)
 {
@@ -503,6 +552,7 @@ vfs_init_localfs (void)
     vfs_local_ops->chdir = local_chdir;
     vfs_local_ops->ferrno = local_errno;
     vfs_local_ops->lseek = local_lseek;
+    vfs_local_ops->ctl = local_ctl;
     vfs_local_ops->mknod = local_mknod;
     vfs_local_ops->getlocalcopy = local_getlocalcopy;
     vfs_local_ops->ungetlocalcopy = local_ungetlocalcopy;
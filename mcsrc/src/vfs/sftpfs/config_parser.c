@@ -58,6 +58,7 @@ typedef struct
     gboolean identities_only;   /* TRUE - no ssh agent (default FALSE) */
     gboolean pubkey_auth;       /* FALSE - disable public key authentication (default TRUE) */
     char *identity_file;        /* A file from which the user's DSA, ECDSA or DSA authentication identity is read. */
+    int channels;               /* number of connections to copy files in parallel (default 1) */
 } sftpfs_ssh_config_entity_t;
 
 enum config_var_type
@@ -88,6 +89,7 @@ static struct
     {"^\\s*Port\\s+(.*)$", NULL, CVT_INTEGER, offsetof (sftpfs_ssh_config_entity_t, port)},
     {"^\\s*PasswordAuthentication\\s+(.*)$", NULL, CVT_BOOLEAN, offsetof (sftpfs_ssh_config_entity_t, password_auth)},
     {"^\\s*PubkeyAuthentication\\s+(.*)$", NULL, CVT_STRING, offsetof (sftpfs_ssh_config_entity_t, pubkey_auth)},
+    {"^\\s*SftpChannels\\s+(.*)$", NULL, CVT_INTEGER, offsetof (sftpfs_ssh_config_entity_t, channels)},
     {NULL, NULL, 0, 0}
 };
 /* *INDENT-ON* */
@@ -326,6 +328,7 @@ sftpfs_get_config_entity (const vfs_path_element_t *vpath_element, GError **mcer
     config_entity->identities_only = FALSE;
     config_entity->pubkey_auth = TRUE;
     config_entity->port = SFTP_DEFAULT_PORT;
+    config_entity->channels = 1;
 
     config_filename = sftpfs_correct_file_name (SFTPFS_SSH_CONFIG);
     ssh_config_handler = fopen (config_filename, "r");
@@ -384,6 +387,7 @@ sftpfs_fill_connection_data_from_config (struct vfs_s_super *super, GError **mce
     sftpfs_super->config_auth_type = (config_entity->pubkey_auth) ? PUBKEY : 0;
     sftpfs_super->config_auth_type |= (config_entity->identities_only) ? 0 : AGENT;
     sftpfs_super->config_auth_type |= (config_entity->password_auth) ? PASSWORD : 0;
+    sftpfs_super->channels = CLAMP (config_entity->channels, 1, SFTPFS_MAX_CHANNELS);
 
     if (super->path_element->port == 0)
         super->path_element->port = config_entity->port;
@@ -16,6 +16,9 @@
 
 #define SFTP_DEFAULT_PORT 22
 
+/* maximum number of connections to copy files in parallel */
+#define SFTPFS_MAX_CHANNELS 16
+
 /* LIBSSH2_INVALID_SOCKET is defined in libssh2 >= 1.4.1 */
 #ifndef LIBSSH2_INVALID_SOCKET
 #define LIBSSH2_INVALID_SOCKET -1
@@ -56,6 +59,9 @@ typedef struct
     int socket_handle;
     const char *ip_address;
     vfs_path_element_t *original_connection_info;
+
+    /* number of connections to copy files in parallel */
+    int channels;
 } sftpfs_super_t;
 
 /*** global variables defined in .c file *********************************************************/
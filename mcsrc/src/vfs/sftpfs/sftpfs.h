@@ -6,18 +6,66 @@
 #ifndef MC__VFS_SFTPFS_H
 #define MC__VFS_SFTPFS_H
 
+#include "lib/vfs/vfs.h"
+
 /*** typedefs(not structures) and defined constants **********************************************/
 
+/* Files can be copied in parallel over several connections */
+#ifndef WIN32
+#define ENABLE_SFTPFS_TRANSFER 1
+#endif
+
 /*** enums ***************************************************************************************/
 
 /*** structures declarations (and typedefs of structures)*****************************************/
 
+typedef struct sftpfs_transfer_t sftpfs_transfer_t;
+
+/* Copy of one regular file */
+typedef struct
+{
+    /* source and target file names as they are shown to user */
+    char *src_path;
+    char *dst_path;
+    mc_stat_t src_stat;
+    /* permission bits of created target file */
+    mode_t dst_mode;
+
+    /* set by sftpfs_transfer_job_new(): file names on both sides of the connection */
+    char *local_path;
+    char *remote_path;
+
+    /* counter of unfinished jobs of the owner, not used by the transfer */
+    int *pending;
+
+    /* result: 0 if file was copied, errno otherwise; target file is removed on error */
+    int error;
+} sftpfs_transfer_job_t;
+
 /*** global variables defined in .c file *********************************************************/
 
 /*** declarations of public functions ************************************************************/
 
 void vfs_init_sftpfs (void);
 
+#ifdef ENABLE_SFTPFS_TRANSFER
+sftpfs_transfer_t *sftpfs_transfer_new (const vfs_path_t * src_vpath, const vfs_path_t * dst_vpath);
+void sftpfs_transfer_free (sftpfs_transfer_t * transfer);
+int sftpfs_transfer_get_channels (const sftpfs_transfer_t * transfer);
+
+sftpfs_transfer_job_t *sftpfs_transfer_job_new (const sftpfs_transfer_t * transfer,
+                                                const char *src_path, const char *dst_path,
+                                                const mc_stat_t * src_stat, mode_t dst_mode);
+void sftpfs_transfer_job_free (sftpfs_transfer_job_t * job);
+
+gboolean sftpfs_transfer_push (sftpfs_transfer_t * transfer, sftpfs_transfer_job_t * job);
+sftpfs_transfer_job_t *sftpfs_transfer_pop (sftpfs_transfer_t * transfer, gint64 timeout);
+guint sftpfs_transfer_get_running (const sftpfs_transfer_t * transfer);
+
+void sftpfs_transfer_cancel (sftpfs_transfer_t * transfer);
+gboolean sftpfs_transfer_is_cancelled (sftpfs_transfer_t * transfer);
+#endif
+
 /*** inline functions ****************************************************************************/
 
 #endif /* MC__VFS_SFTPFS_H */
@@ -0,0 +1,603 @@
+/* Virtual File System: SFTP file system.
+   The internal functions: parallel copy of files over several connections
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** \file transfer.c
+ *  \brief Source: SFTP FS: parallel copy of files over several connections
+ *
+ *  Copy of a lot of files over a link with high latency is dominated by round trips of
+ *  open/close/setstat requests of each file. Files are copied in parallel by worker threads,
+ *  each one over its own SSH connection (channel). Channels are opened on demand, up to
+ *  the number set by the SftpChannels keyword of the host in ~/.ssh/config.
+ *
+ *  libssh2 session is not thread-safe and authentication can require the password dialog,
+ *  so channels are opened by the owner of the transfer and each one is used by one thread at
+ *  a time. A job which failed by any reason is reported back with the target file removed,
+ *  and the owner copies that file again in the usual way to show an error or replace dialog.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/util.h"
+#include "lib/vfs/utilvfs.h"    /* vfs_utime(), vfs_get_timesbuf_from_stat() */
+
+#include "internal.h"
+#include "sftpfs.h"
+
+#ifdef ENABLE_SFTPFS_TRANSFER
+
+/*** global variables ****************************************************************************/
+
+/*** file scope macro definitions ****************************************************************/
+
+#define SFTPFS_TRANSFER_BUFSIZE (64 * 1024)
+
+/*** file scope type declarations ****************************************************************/
+
+struct sftpfs_transfer_t
+{
+    /* TRUE to copy local files to the host */
+    gboolean upload;
+
+    /* Connection data of the host got from the main connection */
+    vfs_path_element_t *path_element;
+    sftpfs_auth_type_t config_auth_type;
+    char *pubkey;
+    char *privkey;
+
+    /* maximum and current number of channels */
+    int channels;
+    GPtrArray *opened;
+    /* channels which are not used by worker threads */
+    GAsyncQueue *idle;
+
+    GThreadPool *threads;
+    /* finished jobs */
+    GAsyncQueue *results;
+    /* number of pushed jobs which are not popped yet */
+    guint running;
+    gint cancelled;
+};
+
+/*** forward declarations (file scope functions) *************************************************/
+
+/*** file scope variables ************************************************************************/
+
+/* --------------------------------------------------------------------------------------------- */
+/*** file scope functions ************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sftpfs_transfer_close_channel (sftpfs_super_t *channel)
+{
+    sftpfs_close_connection (VFS_SUPER (channel), "Normal Shutdown", NULL);
+    vfs_path_element_free (channel->base.path_element);
+    g_free (channel->pubkey);
+    g_free (channel->privkey);
+    g_free (channel);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Open one more connection to the host. Connection is not registered in the VFS, it is used
+ * by the transfer only.
+ *
+ * @return TRUE if connection was opened
+ */
+
+static gboolean
+sftpfs_transfer_open_channel (sftpfs_transfer_t *transfer)
+{
+    sftpfs_super_t *channel;
+    GError *mcerror = NULL;
+
+    channel = g_new0 (sftpfs_super_t, 1);
+    channel->base.me = vfs_sftpfs_ops;
+    channel->base.path_element = vfs_path_element_clone (transfer->path_element);
+    channel->config_auth_type = transfer->config_auth_type;
+    channel->pubkey = g_strdup (transfer->pubkey);
+    channel->privkey = g_strdup (transfer->privkey);
+    channel->socket_handle = LIBSSH2_INVALID_SOCKET;
+
+    if (sftpfs_open_connection (VFS_SUPER (channel), &mcerror) != 0)
+    {
+        /* files are copied over the connections opened already or over the main one */
+        g_clear_error (&mcerror);
+        sftpfs_transfer_close_channel (channel);
+        return FALSE;
+    }
+
+    g_ptr_array_add (transfer->opened, channel);
+    g_async_queue_push (transfer->idle, channel);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sftpfs_transfer_errno (const sftpfs_super_t *channel)
+{
+    if (libssh2_session_last_errno (channel->session) == LIBSSH2_ERROR_SFTP_PROTOCOL)
+        switch (libssh2_sftp_last_error (channel->sftp_session))
+        {
+        case LIBSSH2_FX_NO_SUCH_FILE:
+        case LIBSSH2_FX_NO_SUCH_PATH:
+            return ENOENT;
+        case LIBSSH2_FX_PERMISSION_DENIED:
+            return EACCES;
+        case LIBSSH2_FX_FILE_ALREADY_EXISTS:
+            return EEXIST;
+        case LIBSSH2_FX_NO_SPACE_ON_FILESYSTEM:
+        case LIBSSH2_FX_QUOTA_EXCEEDED:
+            return ENOSPC;
+        default:
+            break;
+        }
+
+    return EIO;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+sftpfs_transfer_is_cancelled_job (sftpfs_transfer_t *transfer)
+{
+    return g_atomic_int_get (&transfer->cancelled) != 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sftpfs_transfer_upload (sftpfs_transfer_t *transfer, sftpfs_super_t *channel,
+                        sftpfs_transfer_job_t *job)
+{
+    const unsigned int len = (unsigned int) strlen (job->remote_path);
+    LIBSSH2_SFTP_HANDLE *handle;
+    LIBSSH2_SFTP_ATTRIBUTES attrs;
+    char *buf;
+    int fd;
+    int error = 0;
+
+    fd = open (job->local_path, O_RDONLY);
+    if (fd == -1)
+        return errno;
+
+    /* permissions are set when the file is written */
+    handle = libssh2_sftp_open_ex (channel->sftp_session, job->remote_path, len,
+                                   LIBSSH2_FXF_WRITE | LIBSSH2_FXF_CREAT | LIBSSH2_FXF_EXCL,
+                                   LIBSSH2_SFTP_S_IRUSR | LIBSSH2_SFTP_S_IWUSR,
+                                   LIBSSH2_SFTP_OPENFILE);
+    if (handle == NULL)
+    {
+        error = sftpfs_transfer_errno (channel);
+        close (fd);
+        return error;
+    }
+
+    buf = g_malloc (SFTPFS_TRANSFER_BUFSIZE);
+
+    while (error == 0)
+    {
+        ssize_t n, done;
+
+        n = read (fd, buf, SFTPFS_TRANSFER_BUFSIZE);
+        if (n < 0)
+        {
+            if (errno != EINTR)
+                error = errno;
+            continue;
+        }
+
+        if (n == 0)
+            break;
+
+        for (done = 0; error == 0 && done < n;)
+        {
+            ssize_t written;
+
+            written = libssh2_sftp_write (handle, buf + done, (size_t) (n - done));
+            if (written < 0)
+                error = sftpfs_transfer_errno (channel);
+            else
+                done += written;
+        }
+
+        if (error == 0 && sftpfs_transfer_is_cancelled_job (transfer))
+            error = ECANCELED;
+    }
+
+    g_free (buf);
+    close (fd);
+
+    if (error == 0)
+    {
+        memset (&attrs, 0, sizeof (attrs));
+        attrs.flags = LIBSSH2_SFTP_ATTR_PERMISSIONS | LIBSSH2_SFTP_ATTR_ACMODTIME;
+        attrs.permissions = job->dst_mode;
+        attrs.atime = (unsigned long) job->src_stat.st_atime;
+        attrs.mtime = (unsigned long) job->src_stat.st_mtime;
+
+        if (libssh2_sftp_fsetstat (handle, &attrs) != 0)
+            error = sftpfs_transfer_errno (channel);
+    }
+
+    if (libssh2_sftp_close_handle (handle) != 0 && error == 0)
+        error = sftpfs_transfer_errno (channel);
+
+    if (error != 0)
+        (void) libssh2_sftp_unlink_ex (channel->sftp_session, job->remote_path, len);
+
+    return error;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+sftpfs_transfer_download (sftpfs_transfer_t *transfer, sftpfs_super_t *channel,
+                          sftpfs_transfer_job_t *job)
+{
+    LIBSSH2_SFTP_HANDLE *handle;
+    mc_timesbuf_t times;
+    char *buf;
+    int fd;
+    int error = 0;
+
+    handle = libssh2_sftp_open_ex (channel->sftp_session, job->remote_path,
+                                   (unsigned int) strlen (job->remote_path), LIBSSH2_FXF_READ, 0,
+                                   LIBSSH2_SFTP_OPENFILE);
+    if (handle == NULL)
+        return sftpfs_transfer_errno (channel);
+
+    /* permissions are set when the file is written */
+    fd = open (job->local_path, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd == -1)
+    {
+        error = errno;
+        libssh2_sftp_close_handle (handle);
+        return error;
+    }
+
+    buf = g_malloc (SFTPFS_TRANSFER_BUFSIZE);
+
+    while (error == 0)
+    {
+        ssize_t n, done;
+
+        n = libssh2_sftp_read (handle, buf, SFTPFS_TRANSFER_BUFSIZE);
+        if (n < 0)
+        {
+            error = sftpfs_transfer_errno (channel);
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        for (done = 0; error == 0 && done < n;)
+        {
+            ssize_t written;
+
+            written = write (fd, buf + done, (size_t) (n - done));
+            if (written >= 0)
+                done += written;
+            else if (errno != EINTR)
+                error = errno;
+        }
+
+        if (error == 0 && sftpfs_transfer_is_cancelled_job (transfer))
+            error = ECANCELED;
+    }
+
+    g_free (buf);
+    libssh2_sftp_close_handle (handle);
+
+    if (error == 0 && fchmod (fd, job->dst_mode) != 0)
+        error = errno;
+
+    if (close (fd) != 0 && error == 0)
+        error = errno;
+
+    if (error == 0)
+    {
+        vfs_get_timesbuf_from_stat (&job->src_stat, &times);
+        (void) vfs_utime (job->local_path, &times);
+    }
+    else
+        unlink (job->local_path);
+
+    return error;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sftpfs_transfer_worker (gpointer data, gpointer user_data)
+{
+    sftpfs_transfer_job_t *job = (sftpfs_transfer_job_t *) data;
+    sftpfs_transfer_t *transfer = (sftpfs_transfer_t *) user_data;
+    sftpfs_super_t *channel;
+
+    channel = (sftpfs_super_t *) g_async_queue_pop (transfer->idle);
+
+    if (sftpfs_transfer_is_cancelled_job (transfer))
+        job->error = ECANCELED;
+    else if (transfer->upload)
+        job->error = sftpfs_transfer_upload (transfer, channel, job);
+    else
+        job->error = sftpfs_transfer_download (transfer, channel, job);
+
+    g_async_queue_push (transfer->idle, channel);
+    g_async_queue_push (transfer->results, job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/*** public functions ****************************************************************************/
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create parallel copy of files between local directory and directory on SFTP host.
+ *
+ * @param src_vpath source directory
+ * @param dst_vpath target directory
+ *
+ * @return new transfer, NULL if one of directories is not on SFTP host, another one is not
+ *         local, or only one connection to the host is allowed
+ */
+
+sftpfs_transfer_t *
+sftpfs_transfer_new (const vfs_path_t *src_vpath, const vfs_path_t *dst_vpath)
+{
+    sftpfs_transfer_t *transfer;
+    const vfs_path_t *remote_vpath;
+    sftpfs_super_t *super = NULL;
+    const vfs_path_element_t *path_element = NULL;
+    gboolean upload;
+
+    if (vfs_file_is_local (src_vpath) && vfs_path_get_last_path_vfs (dst_vpath) == vfs_sftpfs_ops)
+    {
+        upload = TRUE;
+        remote_vpath = dst_vpath;
+    }
+    else if (vfs_file_is_local (dst_vpath)
+             && vfs_path_get_last_path_vfs (src_vpath) == vfs_sftpfs_ops)
+    {
+        upload = FALSE;
+        remote_vpath = src_vpath;
+    }
+    else
+        return NULL;
+
+    if (!sftpfs_op_init (&super, &path_element, remote_vpath, NULL) || super->channels <= 1)
+        return NULL;
+
+    transfer = g_new0 (sftpfs_transfer_t, 1);
+    transfer->upload = upload;
+    /* password entered for the main connection is kept there */
+    transfer->path_element = vfs_path_element_clone (super->base.path_element);
+    transfer->config_auth_type = super->config_auth_type;
+    transfer->pubkey = g_strdup (super->pubkey);
+    transfer->privkey = g_strdup (super->privkey);
+    transfer->channels = super->channels;
+    transfer->opened = g_ptr_array_new ();
+    transfer->idle = g_async_queue_new ();
+    transfer->results = g_async_queue_new ();
+    transfer->threads = g_thread_pool_new (sftpfs_transfer_worker, transfer, transfer->channels,
+                                           FALSE, NULL);
+    if (transfer->threads == NULL)
+    {
+        sftpfs_transfer_free (transfer);
+        return NULL;
+    }
+
+    return transfer;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for all jobs, close channels and destroy the transfer. Results which were not popped
+ * are dropped.
+ */
+
+void
+sftpfs_transfer_free (sftpfs_transfer_t *transfer)
+{
+    sftpfs_transfer_job_t *job;
+
+    if (transfer == NULL)
+        return;
+
+    if (transfer->threads != NULL)
+        g_thread_pool_free (transfer->threads, FALSE, TRUE);
+
+    while ((job = g_async_queue_try_pop (transfer->results)) != NULL)
+        sftpfs_transfer_job_free (job);
+
+    g_ptr_array_foreach (transfer->opened, (GFunc) sftpfs_transfer_close_channel, NULL);
+    g_ptr_array_free (transfer->opened, TRUE);
+    g_async_queue_unref (transfer->idle);
+    g_async_queue_unref (transfer->results);
+
+    vfs_path_element_free (transfer->path_element);
+    g_free (transfer->pubkey);
+    g_free (transfer->privkey);
+    g_free (transfer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get maximum number of channels.
+ */
+
+int
+sftpfs_transfer_get_channels (const sftpfs_transfer_t *transfer)
+{
+    return transfer->channels;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create the job to copy one regular file.
+ *
+ * @param src_path source file name
+ * @param dst_path target file name
+ * @param src_stat status of source file
+ * @param dst_mode permission bits of created target file
+ *
+ * @return new job
+ */
+
+sftpfs_transfer_job_t *
+sftpfs_transfer_job_new (const sftpfs_transfer_t *transfer, const char *src_path,
+                         const char *dst_path, const mc_stat_t *src_stat, mode_t dst_mode)
+{
+    sftpfs_transfer_job_t *job;
+    vfs_path_t *local_vpath, *remote_vpath;
+    const vfs_path_element_t *remote_element;
+
+    job = g_new0 (sftpfs_transfer_job_t, 1);
+    job->src_path = g_strdup (src_path);
+    job->dst_path = g_strdup (dst_path);
+    job->src_stat = *src_stat;
+    job->dst_mode = dst_mode & (mode_t) 07777;
+
+    local_vpath = vfs_path_from_str (transfer->upload ? src_path : dst_path);
+    remote_vpath = vfs_path_from_str (transfer->upload ? dst_path : src_path);
+    remote_element = vfs_path_get_by_index (remote_vpath, -1);
+
+    job->local_path = g_strdup (vfs_path_get_last_path_str (local_vpath));
+    job->remote_path = g_strdup (sftpfs_fix_filename (remote_element->path)->str);
+
+    vfs_path_free (remote_vpath, TRUE);
+    vfs_path_free (local_vpath, TRUE);
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+void
+sftpfs_transfer_job_free (sftpfs_transfer_job_t *job)
+{
+    if (job == NULL)
+        return;
+
+    g_free (job->src_path);
+    g_free (job->dst_path);
+    g_free (job->local_path);
+    g_free (job->remote_path);
+    g_free (job);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue the job to copy. Transfer owns the job until it is popped. Another channel is opened
+ * if all opened ones are busy.
+ *
+ * @return FALSE if no channel could be opened, the job is not queued then
+ */
+
+gboolean
+sftpfs_transfer_push (sftpfs_transfer_t *transfer, sftpfs_transfer_job_t *job)
+{
+    if ((int) transfer->opened->len < transfer->channels
+        && transfer->running >= transfer->opened->len
+        && !sftpfs_transfer_open_channel (transfer))
+    {
+        /* don't try again if the host refuses more connections */
+        transfer->channels = (int) transfer->opened->len;
+    }
+
+    if (transfer->opened->len == 0)
+        return FALSE;
+
+    transfer->running++;
+    g_thread_pool_push (transfer->threads, job, NULL);
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get the next finished job.
+ *
+ * @param timeout how long to wait in microseconds, 0 to not wait
+ *
+ * @return finished job to be freed by caller, NULL if no job finished in time
+ */
+
+sftpfs_transfer_job_t *
+sftpfs_transfer_pop (sftpfs_transfer_t *transfer, gint64 timeout)
+{
+    sftpfs_transfer_job_t *job;
+
+    if (transfer->running == 0)
+        return NULL;
+
+    if (timeout == 0)
+        job = g_async_queue_try_pop (transfer->results);
+    else
+        job = g_async_queue_timeout_pop (transfer->results, (guint64) timeout);
+
+    if (job != NULL)
+        transfer->running--;
+
+    return job;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get number of jobs which are queued, being copied or finished but not popped.
+ */
+
+guint
+sftpfs_transfer_get_running (const sftpfs_transfer_t *transfer)
+{
+    return transfer->running;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Stop copying. Unfinished jobs are popped with ECANCELED error.
+ */
+
+void
+sftpfs_transfer_cancel (sftpfs_transfer_t *transfer)
+{
+    g_atomic_int_set (&transfer->cancelled, 1);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+gboolean
+sftpfs_transfer_is_cancelled (sftpfs_transfer_t *transfer)
+{
+    return sftpfs_transfer_is_cancelled_job (transfer);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+#endif /* ENABLE_SFTPFS_TRANSFER */
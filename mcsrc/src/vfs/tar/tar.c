@@ -1273,6 +1273,83 @@ tar_read (void *fh, char *buffer, size_t count)
     return res;
 }
 
+/* --------------------------------------------------------------------------------------------- */
+/* Find the next data or hole in a sparse file using its sparse map.
+ *
+ * @param fh file handler
+ * @param seek_data TRUE to find a data chunk, FALSE to find a hole
+ * @param offset offset to start search from; it's replaced with found one
+ *
+ * @return 1 on success, -1 with errno ENXIO if offset is beyond the data
+ */
+
+static int
+tar_seek_sparse_data (vfs_file_handler_t *fh, gboolean seek_data, mc_off_t *offset)
+{
+    const GArray *sm = (const GArray *) fh->ino->user_data;
+    const mc_off_t size = fh->ino->st.st_size;
+    ssize_t chunk_idx;
+    const struct sp_array *chunk;
+
+    if (*offset < 0 || *offset >= size)
+    {
+        errno = ENXIO;
+        return -1;
+    }
+
+    chunk_idx = tar_get_sparse_chunk_idx (sm, *offset);
+
+    if (seek_data)
+    {
+        /* no data after last chunk */
+        if (chunk_idx == 0)
+        {
+            errno = ENXIO;
+            return -1;
+        }
+
+        /* we are in the hole -- go to the next chunk start */
+        if (chunk_idx < 0)
+            *offset = g_array_index (sm, struct sp_array, -chunk_idx - 1).offset;
+
+        return 1;
+    }
+
+    /* we are in the chunk -- go to its end skipping adjacent chunks */
+    for (; chunk_idx > 0 && (size_t) chunk_idx <= sm->len; chunk_idx++)
+    {
+        chunk = &g_array_index (sm, struct sp_array, chunk_idx - 1);
+        if (chunk->offset > *offset)
+            break;
+        *offset = chunk->offset + chunk->numbytes;
+    }
+
+    *offset = MIN (*offset, size);
+
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+tar_ctl (void *fh, int ctlop, void *arg)
+{
+    vfs_file_handler_t *file = VFS_FILE_HANDLER (fh);
+
+    switch (ctlop)
+    {
+    case VFS_CTL_SEEK_DATA:
+    case VFS_CTL_SEEK_HOLE:
+        /* only sparse files have holes */
+        if (file->ino->user_data == NULL)
+            return 0;
+        return tar_seek_sparse_data (file, ctlop == VFS_CTL_SEEK_DATA, (mc_off_t *) arg);
+
+    default:
+        return 0;
+    }
+}
+
 /* --------------------------------------------------------------------------------------------- */
 
 static int
@@ -1296,6 +1373,7 @@ vfs_init_tarfs (void)
     /* FIXME: tarfs used own temp files */
     vfs_init_subclass (&tarfs_subclass, "tarfs", VFSF_READONLY, "utar");
     vfs_tarfs_ops->read = tar_read;
+    vfs_tarfs_ops->ctl = tar_ctl;
     vfs_tarfs_ops->setctl = NULL;
     tarfs_subclass.archive_check = tar_super_check;
     tarfs_subclass.archive_same = tar_super_same;
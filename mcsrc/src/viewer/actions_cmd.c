@@ -256,7 +256,7 @@ mcview_load_next_prev_init (WView *view)
         view->dir_idx = g_new (int, 1);
 
         if (dir_list_load
-            (view->dir, view->workdir_vpath, (GCompareFunc) sort_name, &sort_op, NULL))
+            (view->dir, view->workdir_vpath, (GCompareDataFunc) sort_name, &sort_op, NULL))
         {
             const char *fname;
             size_t fname_len;
@@ -0,0 +1,194 @@
+/*
+   libmc - checks for compiled replace string
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "lib/search"
+
+#include "tests/mctest.h"
+
+#include "lib/search.h"
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_replace_compiled_ds") */
+/* *INDENT-OFF* */
+static const struct test_replace_compiled_ds
+{
+    const mc_search_type_t type;
+    const char *input_value;
+    const char *search_str;
+    const char *replace_str;
+    const char *expected_result;
+} test_replace_compiled_ds[] =
+{
+    { /* 0. */
+        MC_SEARCH_T_GLOB,
+        "qqwwee",
+        "*ww*",
+        "\\1AA\\2",
+        "qqAAee"
+    },
+    { /* 1. */
+        MC_SEARCH_T_GLOB,
+        "report.txt",
+        "*.txt",
+        "*.bak",
+        "report.bak"
+    },
+    { /* 2. */
+        MC_SEARCH_T_REGEX,
+        "file.txt",
+        "^(.*)\\.txt$",
+        "\\1.bak",
+        "file.bak"
+    },
+    { /* 3. */
+        MC_SEARCH_T_REGEX,
+        "abc-def",
+        "^(\\w+)-(\\w+)$",
+        "\\U\\2\\E_\\1",
+        "DEF_abc"
+    },
+    { /* 4. */
+        MC_SEARCH_T_REGEX,
+        "abc-def",
+        "^(\\w+)-(\\w+)$",
+        "\\u\\1\\u\\2",
+        "AbcDef"
+    },
+    { /* 5. */
+        MC_SEARCH_T_REGEX,
+        "abc",
+        "^(abc)$",
+        "${1}-\\\\1",
+        "abc-\\1"
+    },
+    { /* 6. */
+        MC_SEARCH_T_NORMAL,
+        "abc",
+        "b",
+        "x\\1",
+        "x\\1"
+    },
+    { /* 7. invalid capture buffer number */
+        MC_SEARCH_T_REGEX,
+        "abc",
+        "^(abc)$",
+        "\\2",
+        NULL
+    }
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_replace_compiled_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_replace_compiled, test_replace_compiled_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    mc_search_replace_t *replace;
+    char *dest_str, *etalon_str;
+
+    s = mc_search_new (data->search_str, NULL);
+    s->is_case_sensitive = TRUE;
+    s->search_type = data->type;
+    replace = mc_search_replace_new (s, data->replace_str);
+
+    /* when */
+    mc_search_run (s, data->input_value, 0, strlen (data->input_value), NULL);
+    dest_str = mc_search_replace_apply (s, replace);
+    etalon_str = mc_search_prepare_replace_str2 (s, data->replace_str);
+
+    /* then */
+    mctest_assert_str_eq (dest_str, data->expected_result);
+    mctest_assert_str_eq (dest_str, etalon_str);
+
+    g_free (etalon_str);
+    g_free (dest_str);
+    mc_search_replace_free (replace);
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_replace_compiled_many)
+/* *INDENT-ON* */
+{
+    /* given */
+    mc_search_t *s;
+    mc_search_replace_t *replace;
+    int i;
+
+    s = mc_search_new ("^img_([0-9]+)\\.(.*)$", NULL);
+    s->is_case_sensitive = TRUE;
+    s->search_type = MC_SEARCH_T_REGEX;
+
+    /* when */
+    replace = mc_search_replace_new (s, "photo-\\1.\\U\\2");
+
+    /* then */
+    for (i = 0; i < 1000; i++)
+    {
+        char *name, *expected, *dest_str;
+
+        name = g_strdup_printf ("img_%d.jpg", i);
+        expected = g_strdup_printf ("photo-%d.JPG", i);
+
+        ck_assert_msg (mc_search_run (s, name, 0, strlen (name), NULL), "%s is not found", name);
+        dest_str = mc_search_replace_apply (s, replace);
+        mctest_assert_str_eq (dest_str, expected);
+
+        g_free (dest_str);
+        g_free (expected);
+        g_free (name);
+    }
+
+    mc_search_replace_free (replace);
+    mc_search_free (s);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_replace_compiled, test_replace_compiled_ds);
+    tcase_add_test (tc_core, test_replace_compiled_many);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,262 @@
+/*
+   src/filemanager - tests for sorting of directory list
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include "src/filemanager/dir.c"
+
+/* more than DIR_SORT_PARALLEL_MIN entries, so the list is sorted by several threads */
+#define ENTRY_COUNT 20001
+
+/* sort functions which are compared with qsort() */
+static const GCompareDataFunc sort_routines[] = {
+    (GCompareDataFunc) sort_name,
+    (GCompareDataFunc) sort_vers,
+    (GCompareDataFunc) sort_ext,
+    (GCompareDataFunc) sort_time,
+    (GCompareDataFunc) sort_atime,
+    (GCompareDataFunc) sort_ctime,
+    (GCompareDataFunc) sort_size,
+    (GCompareDataFunc) sort_inode
+};
+
+static dir_list list;
+
+/* sort function and options for qsort() */
+static GCompareDataFunc qsort_routine;
+static const dir_sort_options_t *qsort_op;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static int
+qsort_compare (const void *a, const void *b)
+{
+    return qsort_routine (a, b, (gpointer) qsort_op);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Fill the list with random entries. Sizes and times are in small ranges, so many entries
+ * have equal keys and are ordered by names.
+ */
+
+static void
+fill_list (GRand *rand)
+{
+    static const char chars[] = "abcABC._-019";
+    static const char *extensions[] = { "", ".c", ".h", ".txt", ".tar.gz", "." };
+    int i;
+
+    ck_assert (dir_list_init (&list));
+
+    for (i = 0; i < ENTRY_COUNT; i++)
+    {
+        char prefix[8];
+        char *name;
+        mc_stat_t st;
+        gboolean link_to_dir = FALSE, stale_link = FALSE;
+        int j, len;
+
+        len = g_rand_int_range (rand, 1, (gint32) sizeof (prefix));
+        for (j = 0; j < len - 1; j++)
+            prefix[j] = chars[g_rand_int_range (rand, 0, (gint32) sizeof (chars) - 1)];
+        prefix[j] = '\0';
+
+        /* names are unique like in the real directory */
+        name = g_strdup_printf ("%s%d%s", prefix, i,
+                                extensions[g_rand_int_range (rand, 0,
+                                                             G_N_ELEMENTS (extensions))]);
+
+        memset (&st, 0, sizeof (st));
+        switch (g_rand_int_range (rand, 0, 6))
+        {
+        case 0:
+            st.st_mode = S_IFDIR | 0755;
+            break;
+        case 1:
+            st.st_mode = S_IFREG | 0755;
+            break;
+        case 2:
+            st.st_mode = S_IFLNK | 0777;
+            link_to_dir = TRUE;
+            break;
+        case 3:
+            st.st_mode = S_IFLNK | 0777;
+            stale_link = TRUE;
+            break;
+        default:
+            st.st_mode = S_IFREG | 0644;
+            break;
+        }
+        st.st_size = g_rand_int_range (rand, 0, 64);
+        st.st_mtime = 1000000 + g_rand_int_range (rand, 0, 32);
+        st.st_atime = 1000000 + g_rand_int_range (rand, 0, 32);
+        st.st_ctime = 1000000 + g_rand_int_range (rand, 0, 32);
+        st.st_ino = g_rand_int (rand);
+
+        ck_assert (dir_list_append (&list, name, &st, link_to_dir, stale_link));
+        g_free (name);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    memset (&list, 0, sizeof (list));
+    panels_options.mix_all_files = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    dir_list_free_list (&list);
+
+    panels_options.mix_all_files = FALSE;
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @DataSource("test_dir_list_sort_ds") */
+/* *INDENT-OFF* */
+static const struct test_dir_list_sort_ds
+{
+    gboolean reverse;
+    gboolean case_sensitive;
+    gboolean exec_first;
+    gboolean mix_all_files;
+} test_dir_list_sort_ds[] =
+{
+    { /* 0 */
+        FALSE, TRUE, FALSE, FALSE
+    },
+    { /* 1 */
+        TRUE, TRUE, FALSE, FALSE
+    },
+    { /* 2 */
+        FALSE, FALSE, FALSE, FALSE
+    },
+    { /* 3 */
+        FALSE, TRUE, TRUE, FALSE
+    },
+    { /* 4 */
+        TRUE, FALSE, TRUE, FALSE
+    },
+    { /* 5 */
+        FALSE, TRUE, FALSE, TRUE
+    },
+    { /* 6 */
+        TRUE, TRUE, TRUE, TRUE
+    },
+};
+/* *INDENT-ON* */
+
+/* @Test(dataSource = "test_dir_list_sort_ds") */
+/* *INDENT-OFF* */
+START_PARAMETRIZED_TEST (test_dir_list_sort, test_dir_list_sort_ds)
+/* *INDENT-ON* */
+{
+    /* given */
+    dir_sort_options_t sort_op;
+    GRand *rand;
+    size_t r;
+
+    sort_op.reverse = data->reverse;
+    sort_op.case_sensitive = data->case_sensitive;
+    sort_op.exec_first = data->exec_first;
+    panels_options.mix_all_files = data->mix_all_files;
+
+    rand = g_rand_new_with_seed (20250101 + _i);
+    fill_list (rand);
+
+    for (r = 0; r < G_N_ELEMENTS (sort_routines); r++)
+    {
+        file_entry_t *expected;
+        int i;
+
+        /* when */
+        dir_list_sort (&list, sort_routines[r], &sort_op);
+
+        /* then */
+        ck_assert_str_eq (list.list[0].fname->str, "..");
+
+        /* entries share sort keys created by dir_list_sort(), they are shuffled to not
+           give qsort() the sorted list */
+        expected = g_new (file_entry_t, list.len - 1);
+        memcpy (expected, &list.list[1], (list.len - 1) * sizeof (file_entry_t));
+        for (i = list.len - 2; i > 0; i--)
+        {
+            const int j = g_rand_int_range (rand, 0, i + 1);
+            const file_entry_t tmp = expected[i];
+
+            expected[i] = expected[j];
+            expected[j] = tmp;
+        }
+
+        qsort_routine = sort_routines[r];
+        qsort_op = &sort_op;
+        qsort (expected, list.len - 1, sizeof (file_entry_t), qsort_compare);
+
+        /* entries with equal keys can be in any order */
+        for (i = 1; i < list.len; i++)
+            ck_assert_msg (sort_routines[r] (&list.list[i], &expected[i - 1], &sort_op) == 0,
+                           "sort function %zu, entry %d: %s instead of %s", r, i,
+                           list.list[i].fname->str, expected[i - 1].fname->str);
+
+        g_free (expected);
+    }
+
+    g_rand_free (rand);
+}
+/* *INDENT-OFF* */
+END_PARAMETRIZED_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    mctest_add_parameterized_test (tc_core, test_dir_list_sort, test_dir_list_sort_ds);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,823 @@
+/*
+   src/filemanager - benchmark of file operations
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * The benchmark is not run by "make check". Run "make bench" or
+ *
+ *     ./file_bench --dir=/dev/shm --scale=0.1
+ *
+ * Each workload is generated in the work directory, copied, moved and erased by the same
+ * functions which are used by the file manager, without user interface. Every operation runs
+ * in a separate process, so caches of one operation don't help another one and the peak RSS
+ * belongs to the operation only.
+ *
+ * Calls per file are calls of the local VFS. Threads of parallel copy and fast erase use
+ * the POSIX API directly and are not counted.
+ *
+ * Cache is the growth of the system page cache during the operation, as "Cached" of
+ * /proc/meminfo shows it. It is affected by other processes, so run the benchmark on an idle
+ * system. Compare it with and without --streaming to see how much of the copied data are
+ * left in the page cache.
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib/global.h"
+#include "lib/strutil.h"
+#include "lib/util.h"
+#include "lib/vfs/vfs.h"
+
+#include "src/vfs/local/local.c"
+
+#include "src/setup.h"          /* verbose, delete_staging, copymove_streaming */
+#include "src/filemanager/layout.h"     /* nice_rotating_dash */
+#include "src/filemanager/file.h"
+
+/* size of block written to the generated files */
+#define BENCH_BLOCK (1024 * 1024)
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Generated files */
+typedef struct
+{
+    size_t count;
+    uintmax_t bytes;
+} bench_size_t;
+
+typedef struct
+{
+    const char *name;
+    /* The workload is a single file copied by copy_file_file() */
+    gboolean single_file;
+    gboolean (*make) (const char *dir, double scale, bench_size_t * size);
+} bench_workload_t;
+
+typedef enum
+{
+    BENCH_COPY = 0,
+    BENCH_MOVE,
+    BENCH_ERASE
+} bench_op_t;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static char *opt_dir = NULL;
+static char *opt_target = NULL;
+static char *opt_workloads = NULL;
+static double opt_scale = 1.0;
+static int opt_workers = 1;
+static gboolean opt_csv = FALSE;
+static gboolean opt_streaming = FALSE;
+static int opt_direct_io = -1;
+
+/* number of calls of the local VFS */
+static size_t bench_calls = 0;
+
+/* original methods of the local VFS */
+static struct vfs_class local_orig;
+
+/* zero block written to the generated files */
+static char *bench_block = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mc_refresh (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Counting methods of the local VFS */
+
+static void *
+bench_open (const vfs_path_t *vpath, int flags, mode_t mode)
+{
+    bench_calls++;
+    return local_orig.open (vpath, flags, mode);
+}
+
+static int
+bench_close (void *data)
+{
+    bench_calls++;
+    return local_orig.close (data);
+}
+
+static ssize_t
+bench_read (void *data, char *buffer, size_t count)
+{
+    bench_calls++;
+    return local_orig.read (data, buffer, count);
+}
+
+static ssize_t
+bench_write (void *data, const char *buf, size_t nbyte)
+{
+    bench_calls++;
+    return local_orig.write (data, buf, nbyte);
+}
+
+static void *
+bench_opendir (const vfs_path_t *vpath)
+{
+    bench_calls++;
+    return local_orig.opendir (vpath);
+}
+
+static struct vfs_dirent *
+bench_readdir (void *data)
+{
+    bench_calls++;
+    return local_orig.readdir (data);
+}
+
+static int
+bench_closedir (void *data)
+{
+    bench_calls++;
+    return local_orig.closedir (data);
+}
+
+static int
+bench_stat (const vfs_path_t *vpath, mc_stat_t *buf)
+{
+    bench_calls++;
+    return local_orig.stat (vpath, buf);
+}
+
+static int
+bench_lstat (const vfs_path_t *vpath, mc_stat_t *buf)
+{
+    bench_calls++;
+    return local_orig.lstat (vpath, buf);
+}
+
+static int
+bench_fstat (void *data, mc_stat_t *buf)
+{
+    bench_calls++;
+    return local_orig.fstat (data, buf);
+}
+
+static int
+bench_chmod (const vfs_path_t *vpath, mode_t mode)
+{
+    bench_calls++;
+    return local_orig.chmod (vpath, mode);
+}
+
+static int
+bench_chown (const vfs_path_t *vpath, uid_t owner, gid_t group)
+{
+    bench_calls++;
+    return local_orig.chown (vpath, owner, group);
+}
+
+static int
+bench_utime (const vfs_path_t *vpath, mc_timesbuf_t *times)
+{
+    bench_calls++;
+    return local_orig.utime (vpath, times);
+}
+
+static int
+bench_link (const vfs_path_t *vpath1, const vfs_path_t *vpath2)
+{
+    bench_calls++;
+    return local_orig.link (vpath1, vpath2);
+}
+
+static int
+bench_unlink (const vfs_path_t *vpath)
+{
+    bench_calls++;
+    return local_orig.unlink (vpath);
+}
+
+static int
+bench_rename (const vfs_path_t *vpath1, const vfs_path_t *vpath2)
+{
+    bench_calls++;
+    return local_orig.rename (vpath1, vpath2);
+}
+
+static mc_off_t
+bench_lseek (void *data, mc_off_t offset, int whence)
+{
+    bench_calls++;
+    return local_orig.lseek (data, offset, whence);
+}
+
+static int
+bench_mkdir (const vfs_path_t *vpath, mode_t mode)
+{
+    bench_calls++;
+    return local_orig.mkdir (vpath, mode);
+}
+
+static int
+bench_rmdir (const vfs_path_t *vpath)
+{
+    bench_calls++;
+    return local_orig.rmdir (vpath);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_count_calls (void)
+{
+    local_orig = *vfs_local_ops;
+
+    vfs_local_ops->open = bench_open;
+    vfs_local_ops->close = bench_close;
+    vfs_local_ops->read = bench_read;
+    vfs_local_ops->write = bench_write;
+    vfs_local_ops->opendir = bench_opendir;
+    vfs_local_ops->readdir = bench_readdir;
+    vfs_local_ops->closedir = bench_closedir;
+    vfs_local_ops->stat = bench_stat;
+    vfs_local_ops->lstat = bench_lstat;
+    vfs_local_ops->fstat = bench_fstat;
+    vfs_local_ops->chmod = bench_chmod;
+    vfs_local_ops->chown = bench_chown;
+    vfs_local_ops->utime = bench_utime;
+    vfs_local_ops->link = bench_link;
+    vfs_local_ops->unlink = bench_unlink;
+    vfs_local_ops->rename = bench_rename;
+    vfs_local_ops->lseek = bench_lseek;
+    vfs_local_ops->mkdir = bench_mkdir;
+    vfs_local_ops->rmdir = bench_rmdir;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Workload generators. They use plain system calls to not disturb the counters */
+
+static size_t
+bench_scaled (size_t base, double scale)
+{
+    return MAX ((size_t) 1, (size_t) (base * scale));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+bench_make_dir (const char *path)
+{
+    if (mkdir (path, 0755) == 0)
+        return TRUE;
+
+    fprintf (stderr, "cannot create %s: %s\n", path, unix_error_string (errno));
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create file of @size bytes. If @hole is not 0, only the first block of each @hole bytes
+ * is written and the rest is a hole.
+ */
+
+static gboolean
+bench_make_file (const char *path, uintmax_t size, uintmax_t hole)
+{
+    int fd;
+    uintmax_t pos = 0;
+    gboolean ok = TRUE;
+
+    fd = open (path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd == -1)
+    {
+        fprintf (stderr, "cannot create %s: %s\n", path, unix_error_string (errno));
+        return FALSE;
+    }
+
+    while (ok && pos < size)
+    {
+        const size_t len = (size_t) MIN (size - pos, BENCH_BLOCK);
+
+        if (hole != 0 && pos % hole != 0)
+            pos = MIN (pos - pos % hole + hole, size);
+        else
+        {
+            ok = lseek (fd, (off_t) pos, SEEK_SET) == (off_t) pos
+                && write (fd, bench_block, len) == (ssize_t) len;
+            pos += len;
+        }
+    }
+
+    ok = ok && ftruncate (fd, (off_t) size) == 0;
+    if (!ok)
+        fprintf (stderr, "cannot write %s: %s\n", path, unix_error_string (errno));
+
+    close (fd);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* One huge file */
+
+static gboolean
+bench_make_huge (const char *dir, double scale, bench_size_t *size)
+{
+    char path[MC_MAXPATHLEN];
+
+    size->count = 1;
+    size->bytes = (uintmax_t) bench_scaled (1024, scale) * BENCH_BLOCK;
+
+    g_snprintf (path, sizeof (path), "%s/huge", dir);
+    return bench_make_file (path, size->bytes, 0);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* 1M tiny files, 1000 per directory */
+
+static gboolean
+bench_make_tiny (const char *dir, double scale, bench_size_t *size)
+{
+    char path[MC_MAXPATHLEN];
+    size_t count, i;
+
+    count = bench_scaled (1000000, scale);
+    size->count = count;
+    size->bytes = (uintmax_t) count * 64;
+
+    for (i = 0; i < count; i++)
+    {
+        if (i % 1000 == 0)
+        {
+            g_snprintf (path, sizeof (path), "%s/d%04zu", dir, i / 1000);
+            if (!bench_make_dir (path))
+                return FALSE;
+        }
+
+        g_snprintf (path, sizeof (path), "%s/d%04zu/f%04zu", dir, i / 1000, i % 1000);
+        if (!bench_make_file (path, 64, 0))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* 256 nested directories with small files on each level */
+
+static gboolean
+bench_make_deep (const char *dir, double scale, bench_size_t *size)
+{
+    GString *path;
+    size_t per_level, level, i;
+    gboolean ok = TRUE;
+
+    per_level = bench_scaled (16, scale);
+    size->count = 256 * per_level;
+    size->bytes = (uintmax_t) size->count * 4096;
+
+    path = g_string_new (dir);
+
+    for (level = 0; ok && level < 256; level++)
+    {
+        g_string_append (path, "/d");
+        ok = bench_make_dir (path->str);
+
+        for (i = 0; ok && i < per_level; i++)
+        {
+            char *name;
+
+            name = g_strdup_printf ("%s/f%zu", path->str, i);
+            ok = bench_make_file (name, 4096, 0);
+            g_free (name);
+        }
+    }
+
+    g_string_free (path, TRUE);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Tree made with "cp -al": each file has 10 names in different directories */
+
+static gboolean
+bench_make_hardlinks (const char *dir, double scale, bench_size_t *size)
+{
+    char path[MC_MAXPATHLEN];
+    char link_path[MC_MAXPATHLEN];
+    size_t count, i, j;
+
+    count = bench_scaled (10000, scale);
+    size->count = count * 10;
+    size->bytes = (uintmax_t) size->count * 1024;
+
+    for (j = 0; j < 10; j++)
+    {
+        g_snprintf (path, sizeof (path), "%s/snap%zu", dir, j);
+        if (!bench_make_dir (path))
+            return FALSE;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        g_snprintf (path, sizeof (path), "%s/snap0/f%zu", dir, i);
+        if (!bench_make_file (path, 1024, 0))
+            return FALSE;
+
+        for (j = 1; j < 10; j++)
+        {
+            g_snprintf (link_path, sizeof (link_path), "%s/snap%zu/f%zu", dir, j, i);
+            if (link (path, link_path) != 0)
+            {
+                fprintf (stderr, "cannot link %s: %s\n", link_path, unix_error_string (errno));
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* Sparse files of 1 GiB with 1 MiB of data every 64 MiB */
+
+static gboolean
+bench_make_sparse (const char *dir, double scale, bench_size_t *size)
+{
+    char path[MC_MAXPATHLEN];
+    size_t count, i;
+
+    count = bench_scaled (16, scale);
+    size->count = count;
+    size->bytes = (uintmax_t) count * 1024 * BENCH_BLOCK;
+
+    for (i = 0; i < count; i++)
+    {
+        g_snprintf (path, sizeof (path), "%s/sparse%zu", dir, i);
+        if (!bench_make_file (path, (uintmax_t) 1024 * BENCH_BLOCK, (uintmax_t) 64 * BENCH_BLOCK))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static const bench_workload_t bench_workloads[] =
+{
+    { "huge", TRUE, bench_make_huge },
+    { "tiny", FALSE, bench_make_tiny },
+    { "deep", FALSE, bench_make_deep },
+    { "hardlinks", FALSE, bench_make_hardlinks },
+    { "sparse", FALSE, bench_make_sparse }
+};
+/* *INDENT-ON* */
+
+static const char *bench_op_names[] = { "copy", "move", "erase" };
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get size of the system page cache.
+ *
+ * @return size in MiB, 0 if it is unknown
+ */
+
+static double
+bench_page_cache (void)
+{
+    FILE *f;
+    char line[BUF_SMALL];
+    double cached = 0;
+
+    f = fopen ("/proc/meminfo", "r");
+    if (f == NULL)
+        return 0;
+
+    while (fgets (line, sizeof (line), f) != NULL)
+    {
+        unsigned long kb;
+
+        if (sscanf (line, "Cached: %lu kB", &kb) == 1)
+        {
+            cached = (double) kb / 1024;
+            break;
+        }
+    }
+
+    fclose (f);
+    return cached;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static FileProgressStatus
+bench_do_op (const bench_workload_t *w, bench_op_t op, const char *src, const char *dst)
+{
+    file_op_context_t *ctx;
+    FileProgressStatus status;
+
+    ctx = file_op_context_new (op == BENCH_COPY ? OP_COPY : op == BENCH_MOVE ? OP_MOVE : OP_DELETE);
+    /* nobody answers the dialogs */
+    ctx->ignore_all = TRUE;
+    ctx->ask_overwrite = FALSE;
+    ctx->recursive_result = RECURSIVE_ALWAYS;
+    ctx->workers = opt_workers;
+
+    switch (op)
+    {
+    case BENCH_COPY:
+        if (!w->single_file)
+            status = copy_dir_dir (ctx, src, dst, TRUE, FALSE, FALSE, NULL);
+        else if (!bench_make_dir (dst))
+            status = FILE_ABORT;
+        else
+        {
+            char *src_file, *dst_file;
+
+            src_file = g_build_filename (src, w->name, (char *) NULL);
+            dst_file = g_build_filename (dst, w->name, (char *) NULL);
+            status = copy_file_file (ctx, src_file, dst_file);
+            g_free (dst_file);
+            g_free (src_file);
+        }
+        break;
+
+    case BENCH_MOVE:
+        status = move_dir_dir (ctx, src, dst);
+        break;
+
+    default:
+        {
+            vfs_path_t *vpath;
+
+            vpath = vfs_path_from_str (src);
+            status = erase_dir (ctx, vpath);
+            vfs_path_free (vpath, TRUE);
+        }
+        break;
+    }
+
+    file_op_context_destroy (ctx);
+    return status;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+bench_remove (const bench_workload_t *w, const char *path)
+{
+    struct stat st;
+
+    if (lstat (path, &st) == 0)
+        (void) bench_do_op (w, BENCH_ERASE, path, NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Run the operation in a child process and print its results.
+ *
+ * @return TRUE if the operation succeeded
+ */
+
+static gboolean
+bench_measure (const bench_workload_t *w, const bench_size_t *size, bench_op_t op,
+               const char *src, const char *dst)
+{
+    pid_t pid;
+    int status;
+
+    fflush (stdout);
+
+    pid = fork ();
+    if (pid == -1)
+    {
+        fprintf (stderr, "cannot fork: %s\n", unix_error_string (errno));
+        return FALSE;
+    }
+
+    if (pid == 0)
+    {
+        FileProgressStatus result;
+        struct rusage usage;
+        gint64 start;
+        double secs, cache;
+
+        bench_calls = 0;
+        cache = bench_page_cache ();
+        start = g_get_monotonic_time ();
+        result = bench_do_op (w, op, src, dst);
+        secs = (double) (g_get_monotonic_time () - start) / G_USEC_PER_SEC;
+        getrusage (RUSAGE_SELF, &usage);
+        cache = bench_page_cache () - cache;
+
+        secs = MAX (secs, 1e-6);
+        printf (opt_csv ? "%s,%s,%zu,%.1f,%.3f,%.1f,%.1f,%.1f,%.1f,%.1f\n"
+                : "%-10s %-6s %8zu %10.1f %9.3f %10.1f %9.1f %10.1f %8.1f %10.1f\n",
+                w->name, bench_op_names[op], size->count, (double) size->bytes / 1e6, secs,
+                (double) size->count / secs, (double) size->bytes / 1e6 / secs,
+                (double) bench_calls / size->count, (double) usage.ru_maxrss / 1024, cache);
+        fflush (stdout);
+        _exit (result == FILE_CONT ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (waitpid (pid, &status, 0) != pid || !WIFEXITED (status)
+        || WEXITSTATUS (status) != EXIT_SUCCESS)
+    {
+        fprintf (stderr, "%s %s failed\n", w->name, bench_op_names[op]);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+bench_run (const bench_workload_t *w, const char *work_dir, const char *target_dir)
+{
+    char *src, *copy, *moved;
+    bench_size_t size = { 0, 0 };
+    gboolean ok;
+
+    src = g_build_filename (work_dir, "src", (char *) NULL);
+    copy = g_build_filename (work_dir, "copy", (char *) NULL);
+    moved = g_build_filename (target_dir, "moved", (char *) NULL);
+
+    ok = bench_make_dir (src) && w->make (src, opt_scale, &size);
+    /* flush the generated files out of the way of the copy */
+    sync ();
+
+    ok = ok && bench_measure (w, &size, BENCH_COPY, src, copy);
+    ok = ok && bench_measure (w, &size, BENCH_MOVE, copy, moved);
+    ok = ok && bench_measure (w, &size, BENCH_ERASE, moved, NULL);
+
+    /* clean up whatever is left */
+    bench_remove (w, src);
+    bench_remove (w, copy);
+    bench_remove (w, moved);
+
+    g_free (moved);
+    g_free (copy);
+    g_free (src);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* *INDENT-OFF* */
+static GOptionEntry bench_options[] =
+{
+    { "dir", 'd', 0, G_OPTION_ARG_FILENAME, &opt_dir,
+      "Work directory, a temporary directory by default", "DIR" },
+    { "target", 't', 0, G_OPTION_ARG_FILENAME, &opt_target,
+      "Directory to move to, the work directory by default", "DIR" },
+    { "workload", 'w', 0, G_OPTION_ARG_STRING, &opt_workloads,
+      "Comma separated workloads: huge, tiny, deep, hardlinks, sparse. All by default", "LIST" },
+    { "scale", 's', 0, G_OPTION_ARG_DOUBLE, &opt_scale,
+      "Scale number and size of generated files", "FACTOR" },
+    { "workers", 'j', 0, G_OPTION_ARG_INT, &opt_workers,
+      "Number of threads to copy files in parallel", "N" },
+    { "csv", 'c', 0, G_OPTION_ARG_NONE, &opt_csv,
+      "Print results as comma separated values", NULL },
+    { "streaming", 'S', 0, G_OPTION_ARG_NONE, &opt_streaming,
+      "Copy with the streaming copy which keeps the page cache clean", NULL },
+    { "direct-io", 'D', 0, G_OPTION_ARG_INT, &opt_direct_io,
+      "Read files of this size in MiB or larger with the direct I/O when streaming, "
+      "0 to disable", "MIB" },
+    { NULL, '\0', 0, G_OPTION_ARG_NONE, NULL, NULL, NULL }
+};
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+    GOptionContext *context;
+    GError *error = NULL;
+    char *work_dir, *target_dir;
+    char *tmpl;
+    size_t i;
+    int ret = EXIT_SUCCESS;
+
+    context = g_option_context_new ("- benchmark of file operations");
+    g_option_context_add_main_entries (context, bench_options, NULL);
+    if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+        fprintf (stderr, "%s\n", error->message);
+        g_error_free (error);
+        g_option_context_free (context);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+
+    str_init_strings (NULL);
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+    bench_count_calls ();
+
+    /* no user interface */
+    verbose = FALSE;
+    nice_rotating_dash = FALSE;
+    delete_staging = FALSE;
+
+    copymove_streaming = opt_streaming;
+    if (opt_direct_io >= 0)
+        copymove_direct_io_threshold = opt_direct_io;
+
+    tmpl = g_build_filename (opt_dir != NULL ? opt_dir : g_get_tmp_dir (), "mc-bench-XXXXXX",
+                             (char *) NULL);
+    work_dir = g_mkdtemp (tmpl);
+    if (work_dir == NULL)
+    {
+        fprintf (stderr, "cannot create %s: %s\n", tmpl, unix_error_string (errno));
+        return EXIT_FAILURE;
+    }
+
+    if (opt_target == NULL)
+        target_dir = g_strdup (work_dir);
+    else
+    {
+        target_dir = g_build_filename (opt_target, "mc-bench-XXXXXX", (char *) NULL);
+        if (g_mkdtemp (target_dir) == NULL)
+        {
+            fprintf (stderr, "cannot create %s: %s\n", target_dir, unix_error_string (errno));
+            rmdir (work_dir);
+            return EXIT_FAILURE;
+        }
+    }
+
+    bench_block = g_malloc0 (BENCH_BLOCK);
+
+    printf (opt_csv ? "%s,%s,%s,%s,%s,%s,%s,%s,%s,%s\n"
+            : "%-10s %-6s %8s %10s %9s %10s %9s %10s %8s %10s\n",
+            "workload", "op", "files", "MB", "time,s", "files/s", "MB/s", "calls/file",
+            "RSS,MiB", "cache,MiB");
+
+    for (i = 0; i < G_N_ELEMENTS (bench_workloads); i++)
+    {
+        const bench_workload_t *w = &bench_workloads[i];
+
+        if (opt_workloads != NULL)
+        {
+            char **names;
+            gboolean found = FALSE;
+            size_t j;
+
+            names = g_strsplit (opt_workloads, ",", -1);
+            for (j = 0; !found && names[j] != NULL; j++)
+                found = strcmp (names[j], w->name) == 0;
+            g_strfreev (names);
+
+            if (!found)
+                continue;
+        }
+
+        if (!bench_run (w, work_dir, target_dir))
+            ret = EXIT_FAILURE;
+    }
+
+    if (opt_target != NULL)
+        rmdir (target_dir);
+    rmdir (work_dir);
+
+    g_free (bench_block);
+    g_free (target_dir);
+    g_free (tmpl);
+
+    vfs_shut ();
+    str_uninit_strings ();
+
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
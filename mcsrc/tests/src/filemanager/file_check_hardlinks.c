@@ -0,0 +1,373 @@
+/*
+   src/filemanager - tests for check_hardlinks() function
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/setup.h"          /* verbose */
+#include "src/filemanager/layout.h"     /* nice_rotating_dash */
+
+#include "src/filemanager/file.c"
+
+/* number of inodes in the hard link cache: a tree made with "cp -al" */
+#define MANY_LINKS 500000
+
+/* copied tree: each file has a name in every snapshot directory */
+#define TREE_FILES 1000
+#define TREE_SNAPSHOTS 5
+
+static char *tmp_dir = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static vfs_path_t *
+tmp_vpath (const char *name)
+{
+    return vfs_path_build_filename (tmp_dir, name, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+create_file (const char *name)
+{
+    char *path;
+
+    path = g_build_filename (tmp_dir, name, (char *) NULL);
+    ck_assert_msg (g_file_set_contents (path, "data", -1, NULL), "cannot create %s", path);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+remove_tree (const char *path)
+{
+    struct stat st;
+
+    if (lstat (path, &st) != 0)
+        return;
+
+    if (S_ISDIR (st.st_mode))
+    {
+        GDir *dir;
+        const char *name;
+
+        dir = g_dir_open (path, 0, NULL);
+        if (dir != NULL)
+        {
+            while ((name = g_dir_read_name (dir)) != NULL)
+            {
+                char *sub;
+
+                sub = g_build_filename (path, name, (char *) NULL);
+                remove_tree (sub);
+                g_free (sub);
+            }
+
+            g_dir_close (dir);
+        }
+
+        rmdir (path);
+    }
+    else
+        unlink (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create a tree made with "cp -al": TREE_SNAPSHOTS directories with the same TREE_FILES files.
+ */
+
+static void
+create_linked_tree (const char *root)
+{
+    int i, j;
+
+    ck_assert_int_eq (mkdir (root, 0755), 0);
+
+    for (j = 0; j < TREE_SNAPSHOTS; j++)
+    {
+        char *path;
+
+        path = g_strdup_printf ("%s/snap%d", root, j);
+        ck_assert_int_eq (mkdir (path, 0755), 0);
+        g_free (path);
+    }
+
+    for (i = 0; i < TREE_FILES; i++)
+    {
+        char *path;
+
+        path = g_strdup_printf ("%s/snap0/f%d", root, i);
+        ck_assert_msg (g_file_set_contents (path, "data", -1, NULL), "cannot create %s", path);
+
+        for (j = 1; j < TREE_SNAPSHOTS; j++)
+        {
+            char *link_path;
+
+            link_path = g_strdup_printf ("%s/snap%d/f%d", root, j, i);
+            ck_assert_msg (link (path, link_path) == 0, "cannot link %s", link_path);
+            g_free (link_path);
+        }
+
+        g_free (path);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mc_refresh (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    tmp_dir = g_dir_make_tmp ("mc-test-XXXXXX", NULL);
+    ck_assert_msg (tmp_dir != NULL, "cannot create temporary directory");
+
+    /* no user interface */
+    verbose = FALSE;
+    nice_rotating_dash = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    linklist = free_linklist (linklist);
+    dest_dirs = free_linklist (dest_dirs);
+
+    remove_tree (tmp_dir);
+    MC_PTR_FREE (tmp_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_check_hardlinks_make_link)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *src1, *src2, *dst1, *dst2;
+    mc_stat_t st1, st2, dst_st1, dst_st2;
+    gboolean ignore_all = FALSE;
+    hardlink_status_t status1, status2;
+
+    create_file ("src1");
+    src1 = tmp_vpath ("src1");
+    src2 = tmp_vpath ("src2");
+    dst1 = tmp_vpath ("dst1");
+    dst2 = tmp_vpath ("dst2");
+    ck_assert_int_eq (mc_link (src1, src2), 0);
+    ck_assert_int_eq (mc_stat (src1, &st1), 0);
+    ck_assert_int_eq (mc_stat (src2, &st2), 0);
+
+    /* when */
+    status1 = check_hardlinks (NULL, src1, &st1, dst1, &ignore_all);
+    /* first link is copied as a regular file */
+    create_file ("dst1");
+    status2 = check_hardlinks (NULL, src2, &st2, dst2, &ignore_all);
+
+    /* then */
+    ck_assert_int_eq (status1, HARDLINK_CACHED);
+    ck_assert_int_eq (status2, HARDLINK_OK);
+    ck_assert_int_eq (mc_stat (dst1, &dst_st1), 0);
+    ck_assert_int_eq (mc_stat (dst2, &dst_st2), 0);
+    ck_assert_int_eq (dst_st1.st_ino, dst_st2.st_ino);
+    ck_assert_int_eq (dst_st1.st_dev, dst_st2.st_dev);
+
+    vfs_path_free (src1, TRUE);
+    vfs_path_free (src2, TRUE);
+    vfs_path_free (dst1, TRUE);
+    vfs_path_free (dst2, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_dir_dir_linked_tree)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_op_context_t *ctx;
+    FileProgressStatus status;
+    char *src, *dst, *path;
+    struct stat st;
+    int i, j;
+
+    src = g_build_filename (tmp_dir, "tree", (char *) NULL);
+    /* target is inside the source, so the created directory must not be copied again */
+    dst = g_build_filename (src, "copy", (char *) NULL);
+    create_linked_tree (src);
+
+    ctx = file_op_context_new (OP_COPY);
+    ctx->ignore_all = TRUE;
+    ctx->ask_overwrite = FALSE;
+    ctx->recursive_result = RECURSIVE_ALWAYS;
+    ctx->preserve = TRUE;
+
+    /* when */
+    status = copy_dir_dir (ctx, src, dst, TRUE, FALSE, FALSE, NULL);
+    file_op_context_destroy (ctx);
+
+    /* then */
+    ck_assert_int_eq (status, FILE_CONT);
+    /* directories have several links too */
+    ck_assert_msg (g_hash_table_size (linklist) >= TREE_FILES, "files are not cached");
+
+    path = g_build_filename (dst, "copy", (char *) NULL);
+    ck_assert_msg (lstat (path, &st) != 0, "created directory %s is copied again", path);
+    g_free (path);
+
+    for (i = 0; i < TREE_FILES; i++)
+    {
+        struct stat first;
+
+        path = g_strdup_printf ("%s/snap0/f%d", dst, i);
+        ck_assert_msg (lstat (path, &first) == 0, "%s is not copied", path);
+        ck_assert_int_eq (first.st_nlink, TREE_SNAPSHOTS);
+        g_free (path);
+
+        for (j = 1; j < TREE_SNAPSHOTS; j++)
+        {
+            path = g_strdup_printf ("%s/snap%d/f%d", dst, j, i);
+            ck_assert_msg (lstat (path, &st) == 0 && st.st_ino == first.st_ino,
+                           "%s is not a hard link", path);
+            g_free (path);
+        }
+    }
+
+    g_free (dst);
+    g_free (src);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* Unit test of the cache itself: synthetic inodes stand in for a huge tree, which is copied by
+   test_copy_dir_dir_linked_tree in a smaller size and by "file_bench --workload=hardlinks" */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_linklist_many_inodes)
+/* *INDENT-ON* */
+{
+    /* given */
+    vfs_path_t *vpath;
+    const struct vfs_class *class;
+    mc_stat_t st;
+    ino_t i;
+
+    vpath = tmp_vpath ("src1");
+    class = vfs_path_get_last_path_vfs (vpath);
+
+    memset (&st, 0, sizeof (st));
+    st.st_dev = 1;
+
+    /* when */
+    for (i = 1; i <= MANY_LINKS; i++)
+    {
+        link_t *lnk;
+
+        lnk = g_new0 (link_t, 1);
+        lnk->vfs = class;
+        lnk->dev = st.st_dev;
+        lnk->ino = i;
+        add_to_linklist (&linklist, lnk);
+    }
+
+    /* then */
+    ck_assert_int_eq (g_hash_table_size (linklist), MANY_LINKS);
+
+    for (i = 1; i <= MANY_LINKS; i++)
+    {
+        const link_t *lnk;
+
+        st.st_ino = i;
+        lnk = find_in_linklist (linklist, vpath, &st);
+        ck_assert_msg (lnk != NULL && lnk->ino == i, "inode %lu is not found", (unsigned long) i);
+    }
+
+    st.st_ino = MANY_LINKS + 1;
+    mctest_assert_null (find_in_linklist (linklist, vpath, &st));
+
+    /* same inode on other device */
+    st.st_ino = 1;
+    st.st_dev = 2;
+    mctest_assert_null (find_in_linklist (linklist, vpath, &st));
+
+    vfs_path_free (vpath, TRUE);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_check_hardlinks_make_link);
+    tcase_add_test (tc_core, test_copy_dir_dir_linked_tree);
+    tcase_add_test (tc_core, test_linklist_many_inodes);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
@@ -0,0 +1,196 @@
+/*
+   src/filemanager - tests for incremental reload of watched directory
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define TEST_SUITE_NAME "/src/filemanager"
+
+#include "tests/mctest.h"
+
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/filemanager/panel.c"
+
+static const char *file_names[] = { "visible", ".hidden", "new" };
+
+static char *tmp_dir = NULL;
+static WPanel *panel = NULL;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+create_file (const char *name)
+{
+    char *path;
+
+    path = g_build_filename (tmp_dir, name, (char *) NULL);
+    ck_assert_msg (g_file_set_contents (path, "data", -1, NULL), "cannot create %s", path);
+    g_free (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+panel_has_file (const char *name)
+{
+    int i;
+
+    for (i = 0; i < panel->dir.len; i++)
+        if (strcmp (panel->dir.list[i].fname->str, name) == 0)
+            return TRUE;
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_setup_work_dir ();
+
+    tmp_dir = g_dir_make_tmp ("mc-test-XXXXXX", NULL);
+    ck_assert_msg (tmp_dir != NULL, "cannot create temporary directory");
+
+    create_file ("visible");
+    create_file (".hidden");
+
+    panels_options.show_dot_files = FALSE;
+    panels_options.show_backups = TRUE;
+
+    /* panel is not shown, so it is enough to read the directory */
+    panel = g_new0 (WPanel, 1);
+    panel->cwd_vpath = vfs_path_from_str (tmp_dir);
+    panel->sort_field = panel_get_field_by_id ("name");
+
+    panel_watch_start (panel);
+    ck_assert (dir_list_load (&panel->dir, panel->cwd_vpath, panel->sort_field->sort_routine,
+                              &panel->sort_info, &panel->filter));
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    size_t i;
+
+    panel_watch_stop (panel);
+    dir_list_free_list (&panel->dir);
+    vfs_path_free (panel->cwd_vpath, TRUE);
+    MC_PTR_FREE (panel);
+
+    for (i = 0; i < G_N_ELEMENTS (file_names); i++)
+    {
+        char *path;
+
+        path = g_build_filename (tmp_dir, file_names[i], (char *) NULL);
+        unlink (path);
+        g_free (path);
+    }
+
+    rmdir (tmp_dir);
+    MC_PTR_FREE (tmp_dir);
+
+    vfs_shut ();
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_panel_watch_show_dot_files)
+/* *INDENT-ON* */
+{
+    /* given */
+    ck_assert (panel_has_file ("visible"));
+    ck_assert (!panel_has_file (".hidden"));
+
+#ifdef ENABLE_DIR_WATCH
+    /* nothing is changed, so the list is up to date */
+    if (panel->watch.dir != NULL)
+        ck_assert (panel_watch_update (panel));
+#endif
+
+    /* when */
+    panels_options.show_dot_files = TRUE;
+
+    /* then */
+    ck_assert_msg (!panel_watch_update (panel), "hidden files must be read on reload");
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_panel_watch_new_file)
+/* *INDENT-ON* */
+{
+#ifdef ENABLE_DIR_WATCH
+    /* given */
+    if (panel->watch.dir == NULL)
+        return;                 /* inotify is not available */
+
+    /* when */
+    create_file ("new");
+
+    /* then */
+    ck_assert (panel_watch_update (panel));
+    ck_assert (panel_has_file ("new"));
+    ck_assert (!panel_has_file (".hidden"));
+    ck_assert_str_eq (panel->dir.list[panel->dir.len - 1].fname->str, "visible");
+#endif
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_panel_watch_show_dot_files);
+    tcase_add_test (tc_core, test_panel_watch_new_file);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */
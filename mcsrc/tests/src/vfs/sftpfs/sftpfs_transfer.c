@@ -0,0 +1,878 @@
+/*
+   src/vfs/sftpfs - tests for parallel copy of files over several SFTP connections
+
+   Copyright (C) 2025
+   Free Software Foundation, Inc.
+
+   This file is part of the Midnight Commander.
+
+   The Midnight Commander is free software: you can redistribute it
+   and/or modify it under the terms of the GNU General Public License as
+   published by the Free Software Foundation, either version 3 of the License,
+   or (at your option) any later version.
+
+   The Midnight Commander is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+   Tests connect to OpenSSH server started on localhost for each test. The server and keys are
+   created in the temporary directory and the server accepts the current user only. Tests pass
+   without checks if sshd or ssh-keygen is not found or the server cannot be started.
+ */
+
+#define TEST_SUITE_NAME "/src/vfs/sftpfs"
+
+#include "tests/mctest.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "src/vfs/local/local.c"
+
+#include "src/setup.h"          /* verbose */
+#include "src/filemanager/layout.h"     /* nice_rotating_dash */
+
+/* ssh config of the test server instead of ~/.ssh/config */
+static char *ssh_config = NULL;
+#define SFTPFS_SSH_CONFIG ssh_config
+
+#include "src/vfs/sftpfs/config_parser.c"
+#include "src/vfs/sftpfs/transfer.c"
+
+#include "src/filemanager/file.c"
+
+/* hosts of ssh config: all of them are the test server */
+#define HOST_PARALLEL "parallel"
+#define HOST_PAIR "pair"
+#define HOST_SINGLE "single"
+#define HOST_MANY "many"
+
+#define PARALLEL_CHANNELS 4
+#define PAIR_CHANNELS 2
+
+#define TEST_FILES 8
+#define TEST_FILE_SIZE (256 * 1024)
+/* files are copied long enough to cancel the transfer in the middle */
+#define CANCEL_FILE_SIZE (8 * 1024 * 1024)
+
+/* how long to wait for a file in microseconds */
+#define POP_TIMEOUT (30 * G_USEC_PER_SEC)
+
+static char *tmp_dir = NULL;
+static char *local_dir = NULL;
+static char *remote_dir = NULL;
+static GPid sshd_pid = 0;
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+run_program (char **argv)
+{
+    int status;
+
+    if (!g_spawn_sync (NULL, argv, NULL,
+                       G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL,
+                       NULL, NULL, &status, NULL))
+        return FALSE;
+
+    return WIFEXITED (status) && WEXITSTATUS (status) == 0;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+create_key (const char *keygen, const char *path)
+{
+    /* libssh2 reads private keys in PEM format */
+    char *argv[] = {
+        (char *) keygen, (char *) "-q", (char *) "-t", (char *) "ecdsa", (char *) "-b",
+        (char *) "256", (char *) "-m", (char *) "PEM", (char *) "-N", (char *) "", (char *) "-f",
+        (char *) path, NULL
+    };
+
+    return run_program (argv);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get port which is not used now.
+ *
+ * @return port number, 0 if there are no free ports
+ */
+
+static int
+get_free_port (void)
+{
+    struct sockaddr_in addr;
+    socklen_t len = sizeof (addr);
+    int sock, port = 0;
+
+    sock = socket (AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+        return 0;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+    if (bind (sock, (struct sockaddr *) &addr, sizeof (addr)) == 0
+        && getsockname (sock, (struct sockaddr *) &addr, &len) == 0)
+        port = ntohs (addr.sin_port);
+
+    close (sock);
+    return port;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+wait_for_port (int port)
+{
+    int i;
+
+    for (i = 0; i < 100; i++)
+    {
+        struct sockaddr_in addr;
+        int sock;
+        gboolean connected;
+
+        sock = socket (AF_INET, SOCK_STREAM, 0);
+        if (sock < 0)
+            return FALSE;
+
+        memset (&addr, 0, sizeof (addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        addr.sin_port = htons (port);
+
+        connected = connect (sock, (struct sockaddr *) &addr, sizeof (addr)) == 0;
+        close (sock);
+
+        if (connected)
+            return TRUE;
+
+        g_usleep (50 * 1000);
+    }
+
+    return FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+write_ssh_config (int port, const char *identity)
+{
+    static const struct
+    {
+        const char *host;
+        int channels;
+    } hosts[] = {
+        { HOST_PARALLEL, PARALLEL_CHANNELS },
+        { HOST_PAIR, PAIR_CHANNELS },
+        { HOST_SINGLE, 0 },
+        { HOST_MANY, 1000 }
+    };
+    GString *config;
+    size_t i;
+
+    config = g_string_new ("");
+
+    for (i = 0; i < G_N_ELEMENTS (hosts); i++)
+    {
+        g_string_append_printf (config,
+                                "Host %s\n"
+                                "    HostName 127.0.0.1\n"
+                                "    Port %d\n"
+                                "    IdentityFile %s\n"
+                                "    IdentitiesOnly True\n"
+                                "    PasswordAuthentication False\n",
+                                hosts[i].host, port, identity);
+        if (hosts[i].channels != 0)
+            g_string_append_printf (config, "    SftpChannels %d\n", hosts[i].channels);
+    }
+
+    ssh_config = g_build_filename (tmp_dir, "ssh_config", (char *) NULL);
+    ck_assert (g_file_set_contents (ssh_config, config->str, -1, NULL));
+    g_string_free (config, TRUE);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Start sshd on free port of localhost and write ssh config to connect to it.
+ *
+ * @return TRUE if the server is running, FALSE if it cannot be started
+ */
+
+static gboolean
+sshd_start (void)
+{
+    char *sshd, *keygen;
+    char *host_key, *identity, *pubkey, *authorized_keys, *config_path;
+    char *config, *data;
+    gsize len;
+    int port;
+    gboolean ok = FALSE;
+
+    sshd = g_find_program_in_path ("sshd");
+    if (sshd == NULL && g_file_test ("/usr/sbin/sshd", G_FILE_TEST_IS_EXECUTABLE))
+        sshd = g_strdup ("/usr/sbin/sshd");
+    keygen = g_find_program_in_path ("ssh-keygen");
+    port = get_free_port ();
+
+    host_key = g_build_filename (tmp_dir, "host_key", (char *) NULL);
+    identity = g_build_filename (tmp_dir, "id_ecdsa", (char *) NULL);
+    pubkey = g_strconcat (identity, ".pub", (char *) NULL);
+    authorized_keys = g_build_filename (tmp_dir, "authorized_keys", (char *) NULL);
+    config_path = g_build_filename (tmp_dir, "sshd_config", (char *) NULL);
+
+    if (sshd == NULL || keygen == NULL || port == 0 || !create_key (keygen, host_key)
+        || !create_key (keygen, identity) || !g_file_get_contents (pubkey, &data, &len, NULL))
+        goto ret;
+
+    ck_assert (g_file_set_contents (authorized_keys, data, (gssize) len, NULL));
+    g_free (data);
+
+    config = g_strdup_printf ("ListenAddress 127.0.0.1\n"
+                              "Port %d\n"
+                              "HostKey %s\n"
+                              "AuthorizedKeysFile %s\n"
+                              "PidFile none\n"
+                              "StrictModes no\n"
+                              "PasswordAuthentication no\n"
+                              "MaxStartups 100\n"
+                              "MaxSessions 100\n"
+                              "Subsystem sftp internal-sftp\n", port, host_key, authorized_keys);
+    ck_assert (g_file_set_contents (config_path, config, -1, NULL));
+    g_free (config);
+
+    {
+        /* sshd must be started with the absolute path */
+        char *argv[] = {
+            sshd, (char *) "-D", (char *) "-e", (char *) "-f", config_path, NULL
+        };
+
+        if (!g_spawn_async (NULL, argv, NULL,
+                            G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL
+                            | G_SPAWN_STDERR_TO_DEV_NULL, NULL, NULL, &sshd_pid, NULL))
+        {
+            sshd_pid = 0;
+            goto ret;
+        }
+    }
+
+    ok = wait_for_port (port);
+    if (ok)
+        write_ssh_config (port, identity);
+
+  ret:
+    g_free (config_path);
+    g_free (authorized_keys);
+    g_free (pubkey);
+    g_free (identity);
+    g_free (host_key);
+    g_free (keygen);
+    g_free (sshd);
+    return ok;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+sshd_stop (void)
+{
+    if (sshd_pid != 0)
+    {
+        kill (sshd_pid, SIGTERM);
+        waitpid (sshd_pid, NULL, 0);
+        g_spawn_close_pid (sshd_pid);
+        sshd_pid = 0;
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static void
+remove_tree (const char *path)
+{
+    struct stat st;
+
+    if (lstat (path, &st) != 0)
+        return;
+
+    if (S_ISDIR (st.st_mode))
+    {
+        GDir *dir;
+        const char *name;
+
+        dir = g_dir_open (path, 0, NULL);
+        if (dir != NULL)
+        {
+            while ((name = g_dir_read_name (dir)) != NULL)
+            {
+                char *sub;
+
+                sub = g_build_filename (path, name, (char *) NULL);
+                remove_tree (sub);
+                g_free (sub);
+            }
+
+            g_dir_close (dir);
+        }
+
+        rmdir (path);
+    }
+    else
+        unlink (path);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Create files f0, f1, ... with different content.
+ */
+
+static void
+create_files (const char *dir, int count, size_t size)
+{
+    char *data;
+    int i;
+
+    data = g_malloc (size);
+
+    for (i = 0; i < count; i++)
+    {
+        char *path;
+        size_t j;
+
+        for (j = 0; j < size; j++)
+            data[j] = (char) ((i * 31 + j) & 0xff);
+
+        path = g_strdup_printf ("%s/f%d", dir, i);
+        ck_assert_msg (g_file_set_contents (path, data, (gssize) size, NULL),
+                       "cannot create %s", path);
+        g_free (path);
+    }
+
+    g_free (data);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static gboolean
+files_are_equal (const char *path1, const char *path2)
+{
+    char *data1 = NULL, *data2 = NULL;
+    gsize len1, len2;
+    gboolean ret;
+
+    ret = g_file_get_contents (path1, &data1, &len1, NULL)
+        && g_file_get_contents (path2, &data2, &len2, NULL)
+        && len1 == len2 && memcmp (data1, data2, len1) == 0;
+
+    g_free (data1);
+    g_free (data2);
+    return ret;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Get path of local directory on the test server.
+ */
+
+static char *
+remote_path (const char *host, const char *dir)
+{
+    return g_strconcat ("sftp://", host, dir, (char *) NULL);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+static sftpfs_transfer_t *
+transfer_new (const char *host, gboolean upload)
+{
+    sftpfs_transfer_t *transfer;
+    vfs_path_t *local_vpath, *remote_vpath;
+    char *path;
+
+    path = remote_path (host, remote_dir);
+    local_vpath = vfs_path_from_str (local_dir);
+    remote_vpath = vfs_path_from_str (path);
+    g_free (path);
+
+    if (upload)
+        transfer = sftpfs_transfer_new (local_vpath, remote_vpath);
+    else
+        transfer = sftpfs_transfer_new (remote_vpath, local_vpath);
+
+    vfs_path_free (remote_vpath, TRUE);
+    vfs_path_free (local_vpath, TRUE);
+
+    return transfer;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Queue files f0, f1, ... to copy from one directory to another.
+ */
+
+static void
+push_files (sftpfs_transfer_t *transfer, const char *host, gboolean upload, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        char *local, *remote;
+        vfs_path_t *src_vpath;
+        mc_stat_t st;
+        sftpfs_transfer_job_t *job;
+
+        local = g_strdup_printf ("%s/f%d", local_dir, i);
+        remote = g_strdup_printf ("sftp://%s%s/f%d", host, remote_dir, i);
+
+        src_vpath = vfs_path_from_str (upload ? local : remote);
+        ck_assert_int_eq (mc_stat (src_vpath, &st), 0);
+        vfs_path_free (src_vpath, TRUE);
+
+        job = upload ? sftpfs_transfer_job_new (transfer, local, remote, &st, 0640)
+            : sftpfs_transfer_job_new (transfer, remote, local, &st, 0640);
+        ck_assert (sftpfs_transfer_push (transfer, job));
+
+        g_free (remote);
+        g_free (local);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Wait for all queued files and save their errors by file number.
+ */
+
+static void
+pop_files (sftpfs_transfer_t *transfer, int *errors)
+{
+    while (sftpfs_transfer_get_running (transfer) != 0)
+    {
+        sftpfs_transfer_job_t *job;
+        int i;
+
+        job = sftpfs_transfer_pop (transfer, POP_TIMEOUT);
+        mctest_assert_not_null (job);
+        ck_assert (sscanf (x_basename (job->dst_path), "f%d", &i) == 1);
+        errors[i] = job->error;
+        sftpfs_transfer_job_free (job);
+    }
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/**
+ * Check that file is the same in both directories.
+ */
+
+static void
+check_copied_file (int i, gboolean upload)
+{
+    char *local, *remote;
+    struct stat st;
+
+    local = g_strdup_printf ("%s/f%d", local_dir, i);
+    remote = g_strdup_printf ("%s/f%d", remote_dir, i);
+
+    ck_assert_msg (files_are_equal (local, remote), "f%d is copied wrong", i);
+    /* permissions of the job are set on the target */
+    ck_assert_int_eq (stat (upload ? remote : local, &st), 0);
+    ck_assert_int_eq (st.st_mode & 07777, 0640);
+
+    g_free (remote);
+    g_free (local);
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+void
+mc_refresh (void)
+{
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+int
+query_dialog (const char *header, const char *text, int flags, int count, ...)
+{
+    (void) header;
+    (void) text;
+    (void) flags;
+    (void) count;
+
+    /* "Ignore": the key of the test server is not added to ~/.ssh/known_hosts */
+    return 1;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+/* @Mock */
+char *
+vfs_get_password (const char *msg)
+{
+    (void) msg;
+
+    /* keys of the test server have no passphrase */
+    return NULL;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Before */
+static void
+setup (void)
+{
+    str_init_strings (NULL);
+
+    vfs_init ();
+    vfs_init_localfs ();
+    vfs_init_sftpfs ();
+    vfs_setup_work_dir ();
+
+    tmp_dir = g_dir_make_tmp ("mc-test-XXXXXX", NULL);
+    ck_assert_msg (tmp_dir != NULL, "cannot create temporary directory");
+
+    local_dir = g_build_filename (tmp_dir, "local", (char *) NULL);
+    remote_dir = g_build_filename (tmp_dir, "remote", (char *) NULL);
+    ck_assert_int_eq (mkdir (local_dir, 0755), 0);
+    ck_assert_int_eq (mkdir (remote_dir, 0755), 0);
+
+    if (!sshd_start ())
+        sshd_stop ();
+
+    /* no user interface */
+    verbose = FALSE;
+    nice_rotating_dash = FALSE;
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @After */
+static void
+teardown (void)
+{
+    /* connections are closed before the server */
+    vfs_shut ();
+    sshd_stop ();
+
+    remove_tree (tmp_dir);
+    MC_PTR_FREE (tmp_dir);
+    MC_PTR_FREE (local_dir);
+    MC_PTR_FREE (remote_dir);
+    MC_PTR_FREE (ssh_config);
+
+    str_uninit_strings ();
+}
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sftpfs_transfer_upload)
+/* *INDENT-ON* */
+{
+    /* given */
+    sftpfs_transfer_t *transfer;
+    int errors[TEST_FILES];
+    int i;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    create_files (local_dir, TEST_FILES, TEST_FILE_SIZE);
+    transfer = transfer_new (HOST_PARALLEL, TRUE);
+    mctest_assert_not_null (transfer);
+
+    /* when */
+    push_files (transfer, HOST_PARALLEL, TRUE, TEST_FILES);
+    pop_files (transfer, errors);
+
+    /* then */
+    /* a new channel is opened while all opened ones are busy */
+    ck_assert_int_eq (transfer->opened->len, PARALLEL_CHANNELS);
+    sftpfs_transfer_free (transfer);
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        ck_assert_msg (errors[i] == 0, "f%d: %s", i, unix_error_string (errors[i]));
+        check_copied_file (i, TRUE);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sftpfs_transfer_download)
+/* *INDENT-ON* */
+{
+    /* given */
+    sftpfs_transfer_t *transfer;
+    int errors[TEST_FILES];
+    int i;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    create_files (remote_dir, TEST_FILES, TEST_FILE_SIZE);
+    transfer = transfer_new (HOST_PARALLEL, FALSE);
+    mctest_assert_not_null (transfer);
+
+    /* when */
+    push_files (transfer, HOST_PARALLEL, FALSE, TEST_FILES);
+    pop_files (transfer, errors);
+
+    /* then */
+    ck_assert_int_eq (transfer->opened->len, PARALLEL_CHANNELS);
+    sftpfs_transfer_free (transfer);
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        ck_assert_msg (errors[i] == 0, "f%d: %s", i, unix_error_string (errors[i]));
+        check_copied_file (i, FALSE);
+    }
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sftpfs_transfer_channels)
+/* *INDENT-ON* */
+{
+    /* given */
+    sftpfs_transfer_t *single, *pair, *many;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    /* when */
+    single = transfer_new (HOST_SINGLE, TRUE);
+    pair = transfer_new (HOST_PAIR, TRUE);
+    many = transfer_new (HOST_MANY, FALSE);
+
+    /* then */
+    /* files are copied over the main connection if SftpChannels is not set */
+    mctest_assert_null (single);
+    mctest_assert_not_null (pair);
+    ck_assert_int_eq (sftpfs_transfer_get_channels (pair), PAIR_CHANNELS);
+    mctest_assert_not_null (many);
+    ck_assert_int_eq (sftpfs_transfer_get_channels (many), SFTPFS_MAX_CHANNELS);
+    /* channels are opened on demand */
+    ck_assert_int_eq (pair->opened->len, 0);
+
+    sftpfs_transfer_free (many);
+    sftpfs_transfer_free (pair);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sftpfs_transfer_target_exists)
+/* *INDENT-ON* */
+{
+    /* given */
+    sftpfs_transfer_t *transfer;
+    int errors[TEST_FILES];
+    char *existing, *data;
+    int i;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    create_files (local_dir, TEST_FILES, TEST_FILE_SIZE);
+    existing = g_strdup_printf ("%s/f3", remote_dir);
+    ck_assert (g_file_set_contents (existing, "old", -1, NULL));
+    transfer = transfer_new (HOST_PARALLEL, TRUE);
+    mctest_assert_not_null (transfer);
+
+    /* when */
+    push_files (transfer, HOST_PARALLEL, TRUE, TEST_FILES);
+    pop_files (transfer, errors);
+    sftpfs_transfer_free (transfer);
+
+    /* then */
+    /* existing file is left to the replace dialog of the owner */
+    ck_assert_int_eq (errors[3], EEXIST);
+    ck_assert (g_file_get_contents (existing, &data, NULL, NULL));
+    ck_assert_str_eq (data, "old");
+    g_free (data);
+
+    for (i = 0; i < TEST_FILES; i++)
+        if (i != 3)
+        {
+            ck_assert_msg (errors[i] == 0, "f%d: %s", i, unix_error_string (errors[i]));
+            check_copied_file (i, TRUE);
+        }
+
+    g_free (existing);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_copy_dir_dir_target_exists)
+/* *INDENT-ON* */
+{
+    /* given */
+    file_op_context_t *ctx;
+    FileProgressStatus status;
+    char *existing, *dst;
+    int i;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    create_files (local_dir, TEST_FILES, TEST_FILE_SIZE);
+    existing = g_strdup_printf ("%s/f3", remote_dir);
+    ck_assert (g_file_set_contents (existing, "old", -1, NULL));
+    dst = remote_path (HOST_PARALLEL, remote_dir);
+
+    ctx = file_op_context_new (OP_COPY);
+    ctx->ignore_all = TRUE;
+    ctx->ask_overwrite = FALSE;
+    ctx->recursive_result = RECURSIVE_ALWAYS;
+
+    /* when */
+    /* files are merged to the existing directory */
+    status = copy_dir_dir (ctx, local_dir, dst, TRUE, FALSE, FALSE, NULL);
+    file_op_context_destroy (ctx);
+
+    /* then */
+    /* file which exists is copied again by copy_file_file() and replaced */
+    ck_assert_int_eq (status, FILE_CONT);
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        char *local, *remote;
+
+        local = g_strdup_printf ("%s/f%d", local_dir, i);
+        remote = g_strdup_printf ("%s/f%d", remote_dir, i);
+        ck_assert_msg (files_are_equal (local, remote), "f%d is copied wrong", i);
+        g_free (remote);
+        g_free (local);
+    }
+
+    g_free (dst);
+    g_free (existing);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+/* @Test */
+/* *INDENT-OFF* */
+START_TEST (test_sftpfs_transfer_cancel)
+/* *INDENT-ON* */
+{
+    /* given */
+    sftpfs_transfer_t *transfer;
+    sftpfs_transfer_job_t *job;
+    int errors[TEST_FILES];
+    int i, cancelled = 0;
+
+    if (sshd_pid == 0)
+        return;                 /* OpenSSH server is not available */
+
+    create_files (local_dir, TEST_FILES, CANCEL_FILE_SIZE);
+    transfer = transfer_new (HOST_PAIR, TRUE);
+    mctest_assert_not_null (transfer);
+    push_files (transfer, HOST_PAIR, TRUE, TEST_FILES);
+
+    /* when */
+    /* cancel after the first file */
+    job = sftpfs_transfer_pop (transfer, POP_TIMEOUT);
+    mctest_assert_not_null (job);
+    ck_assert_int_eq (job->error, 0);
+    sftpfs_transfer_job_free (job);
+
+    sftpfs_transfer_cancel (transfer);
+
+    for (i = 0; i < TEST_FILES; i++)
+        errors[i] = 0;
+    pop_files (transfer, errors);
+
+    /* then */
+    ck_assert (sftpfs_transfer_is_cancelled (transfer));
+    sftpfs_transfer_free (transfer);
+
+    for (i = 0; i < TEST_FILES; i++)
+    {
+        char *remote;
+
+        remote = g_strdup_printf ("%s/f%d", remote_dir, i);
+
+        if (errors[i] == 0)
+            check_copied_file (i, TRUE);
+        else
+        {
+            ck_assert_msg (errors[i] == ECANCELED, "f%d: %s", i, unix_error_string (errors[i]));
+            ck_assert_msg (!g_file_test (remote, G_FILE_TEST_EXISTS),
+                           "cancelled file %s is left", remote);
+            cancelled++;
+        }
+
+        g_free (remote);
+    }
+
+    /* only files which were being copied at that moment can be finished */
+    ck_assert_msg (cancelled >= TEST_FILES - 1 - 2 * PAIR_CHANNELS, "%d files are cancelled",
+                   cancelled);
+}
+/* *INDENT-OFF* */
+END_TEST
+/* *INDENT-ON* */
+
+/* --------------------------------------------------------------------------------------------- */
+
+int
+main (void)
+{
+    TCase *tc_core;
+
+    tc_core = tcase_create ("Core");
+
+    /* files are copied over the network stack */
+    tcase_set_timeout (tc_core, 120);
+    tcase_add_checked_fixture (tc_core, setup, teardown);
+
+    /* Add new tests here: *************** */
+    tcase_add_test (tc_core, test_sftpfs_transfer_upload);
+    tcase_add_test (tc_core, test_sftpfs_transfer_download);
+    tcase_add_test (tc_core, test_sftpfs_transfer_channels);
+    tcase_add_test (tc_core, test_sftpfs_transfer_target_exists);
+    tcase_add_test (tc_core, test_copy_dir_dir_target_exists);
+    tcase_add_test (tc_core, test_sftpfs_transfer_cancel);
+    /* *********************************** */
+
+    return mctest_run_all (tc_core);
+}
+
+/* --------------------------------------------------------------------------------------------- */